@@ -0,0 +1,1082 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+/*
+    Benchmarks for the padring input readers.
+
+    Usage: padring_bench [benchmark] [size]
+
+    All input files are synthetic and written to the
+    system's temporary directory.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "logging.h"
+#include "mappedfile.h"
+#include "prlefreader.h"
+#include "lefloader.h"
+#include "lefindex.h"
+#include "lefdiff.h"
+#include "librarymanager.h"
+#include "padlib.h"
+#include "shapeindex.h"
+#include "keywords.h"
+#include "configreader.h"
+#include "padcfg.h"
+#include "layout.h"
+#include "padringdb.h"
+#include "threadpool.h"
+
+namespace
+{
+
+/** time a function, return the best wall clock time in seconds */
+double timeIt(const std::function<void()> &func, uint32_t runs = 3)
+{
+    double best = 1e30;
+    for(uint32_t i=0; i<runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+std::string tempFileName(const std::string &name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+/** write a LEF file with a UNITS header and 'macros' pad cells
+    that each carry a few pins and obstructions. */
+void writeSyntheticLEF(const std::string &filename, uint32_t macros,
+    const std::string &prefix = "PAD_", uint32_t revision = 0)
+{
+    std::ofstream os(filename);
+    os << "VERSION 5.7 ;\n";
+    os << "UNITS\n    DATABASE MICRONS 1000 ;\nEND UNITS\n\n";
+    os << "PROPERTYDEFINITIONS\n    MACRO padType STRING ;\nEND PROPERTYDEFINITIONS\n\n";
+    os << "LAYER MET1\n    TYPE ROUTING ;\n    DIRECTION HORIZONTAL ;\n    PITCH 0.2 ;\n    WIDTH 0.1 ;\nEND MET1\n\n";
+    os << "VIA VIA12 DEFAULT\n    LAYER MET1 ;\n        RECT -0.1 -0.1 0.1 0.1 ;\n    LAYER MET2 ;\n        RECT -0.1 -0.1 0.1 0.1 ;\nEND VIA12\n\n";
+
+    for(uint32_t m=0; m<macros; m++)
+    {
+        const bool filler = (m % 10) == 0;
+        os << "MACRO " << prefix << m << "\n";
+        os << "    CLASS " << (filler ? "PAD SPACER" : "PAD INOUT") << " ;\n";
+        os << "    FOREIGN " << prefix << m << " 0 0 ;\n";
+        os << "    ORIGIN 0.000 0.000 ;\n";
+        // each revision changes the height of every 20th macro
+        const bool revised = (revision != 0) && ((m % 20) == (revision % 20));
+        os << "    SIZE " << (filler ? 1 + (m % 5) : 80) << ".000 BY " << (revised ? 150 + revision : 150) << ".000 ;\n";
+        os << "    SYMMETRY X Y R90 ;\n";
+        os << "    SITE io_site ;\n";
+        if (!filler)
+        {
+            for(uint32_t p=0; p<8; p++)
+            {
+                os << "    PIN D[" << p << "]\n";
+                os << "        DIRECTION INOUT ;\n";
+                os << "        USE SIGNAL ;\n";
+                os << "        PORT\n";
+                os << "        LAYER MET1 ;\n";
+                os << "            RECT " << p*10 << ".000 149.540 " << p*10 + 1 << ".800 150.000 ;\n";
+                os << "            RECT " << p*10 << ".000 0.000 " << p*10 + 1 << ".800 0.460 ;\n";
+                os << "        END\n";
+                os << "    END D[" << p << "]\n";
+            }
+        }
+        os << "END " << prefix << m << "\n\n";
+    }
+    os << "END LIBRARY\n";
+}
+
+/** write a technology LEF: a few layers followed by 'vias' VIA
+    and VIARULE definitions, which the reader skips. */
+void writeTechLEF(const std::string &filename, uint32_t vias)
+{
+    std::ofstream os(filename);
+    os << "VERSION 5.7 ;\n";
+    os << "UNITS\n    DATABASE MICRONS 1000 ;\nEND UNITS\n\n";
+    for(uint32_t l=1; l<=8; l++)
+    {
+        os << "LAYER MET" << l << "\n    TYPE ROUTING ;\n    DIRECTION HORIZONTAL ;\n";
+        os << "    PITCH 0.2 ;\n    WIDTH 0.1 ;\nEND MET" << l << "\n\n";
+    }
+
+    for(uint32_t v=0; v<vias; v++)
+    {
+        const uint32_t l = 1 + (v % 7);
+        os << "VIA VIA" << l << (l+1) << "_" << v << " DEFAULT\n";
+        os << "    RESISTANCE 1.5 ;\n";
+        for(uint32_t k=0; k<3; k++)
+        {
+            os << "    LAYER " << ((k == 1) ? "VIA" : "MET") << l + (k == 2) << " ;\n";
+            os << "        RECT -0.065 -0.065 0.065 0.065 ;\n";
+            os << "        RECT -0.100 -0.065 0.100 0.065 ;\n";
+        }
+        os << "END VIA" << l << (l+1) << "_" << v << "\n\n";
+
+        if ((v % 4) == 0)
+        {
+            os << "VIARULE GEN" << v << " GENERATE\n";
+            os << "    LAYER MET" << l << " ;\n        ENCLOSURE 0.005 0.03 ;\n";
+            os << "    LAYER VIA" << l << " ;\n        RECT -0.05 -0.05 0.05 0.05 ;\n";
+            os << "        SPACING 0.17 BY 0.17 ;\n";
+            os << "END GEN" << v << "\n\n";
+        }
+    }
+    os << "END LIBRARY\n";
+}
+
+/** parse a technology LEF and compare to a plain memchr pass over it */
+void benchTechLEF(uint32_t vias)
+{
+    auto filename = tempFileName("padring_bench_tech.lef");
+    writeTechLEF(filename, vias);
+    const double megabytes = std::filesystem::file_size(filename) / (1024.0*1024.0);
+
+    size_t lines = 0;
+    double tScan = timeIt([&]()
+        {
+            MappedFile file;
+            file.open(filename);
+            lines = 0;
+            const char *p   = file.data();
+            const char *end = p + file.size();
+            while((p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr)
+            {
+                lines++;
+                p++;
+            }
+        });
+
+    double tStream = timeIt([&]()
+        {
+            PRLEFReader reader;
+            std::ifstream lefstream(filename, std::ifstream::in);
+            reader.parse(lefstream);
+        });
+
+    double tMapped = timeIt([&]()
+        {
+            PRLEFReader reader;
+            reader.parseFile(filename);
+        });
+
+    printf("Technology LEF: %u vias, %zu lines, %.1f MB\n", vias, lines, megabytes);
+    printf("  memchr  : %8.1f ms  %8.1f MB/s\n", tScan*1e3, megabytes / tScan);
+    printf("  istream : %8.1f ms  %8.1f MB/s\n", tStream*1e3, megabytes / tStream);
+    printf("  mmap    : %8.1f ms  %8.1f MB/s\n", tMapped*1e3, megabytes / tMapped);
+
+    std::filesystem::remove(filename);
+}
+
+/** compare the chunked istream LEF reader to the memory-mapped one */
+void benchLEFReader(uint32_t macros)
+{
+    auto filename = tempFileName("padring_bench.lef");
+    writeSyntheticLEF(filename, macros);
+    const double megabytes = std::filesystem::file_size(filename) / (1024.0*1024.0);
+
+    size_t cells = 0;
+    double tStream = timeIt([&]()
+        {
+            PRLEFReader reader;
+            std::ifstream lefstream(filename, std::ifstream::in);
+            reader.parse(lefstream);
+            cells = reader.m_cells.size();
+        });
+
+    double tMapped = timeIt([&]()
+        {
+            PRLEFReader reader;
+            reader.parseFile(filename);
+            cells = reader.m_cells.size();
+        });
+
+    printf("LEF reader: %zu cells, %.1f MB\n", cells, megabytes);
+    printf("  istream : %8.1f ms  %8.1f MB/s\n", tStream*1e3, megabytes / tStream);
+    printf("  mmap    : %8.1f ms  %8.1f MB/s\n", tMapped*1e3, megabytes / tMapped);
+
+    std::filesystem::remove(filename);
+}
+
+/** load several LEF files serially and with one thread per core */
+void benchLEFLoader(uint32_t macros)
+{
+    const uint32_t fileCount = 8;
+    std::vector<std::string> filenames;
+    double megabytes = 0.0;
+    for(uint32_t i=0; i<fileCount; i++)
+    {
+        filenames.push_back(tempFileName("padring_bench_" + std::to_string(i) + ".lef"));
+        writeSyntheticLEF(filenames.back(), macros / fileCount);
+        megabytes += std::filesystem::file_size(filenames.back()) / (1024.0*1024.0);
+    }
+
+    setLogLevel(LOG_ERROR);     // don't report the replaced cells
+    double tSerial = timeIt([&]()
+        {
+            PRLEFReader reader;
+            LEFLoader loader(reader);
+            loader.setJobs(1);
+            loader.load(filenames);
+        });
+
+    double tParallel = timeIt([&]()
+        {
+            PRLEFReader reader;
+            LEFLoader loader(reader);
+            loader.setJobs(0);
+            loader.load(filenames);
+        });
+    setLogLevel(LOG_INFO);
+
+    printf("LEF loader: %u files, %.1f MB\n", fileCount, megabytes);
+    printf("  serial              : %8.1f ms\n", tSerial*1e3);
+    printf("  parallel (%2u jobs)  : %8.1f ms\n", ThreadPool::defaultThreadCount(), tParallel*1e3);
+
+    for(auto const &filename : filenames)
+    {
+        std::filesystem::remove(filename);
+    }
+}
+
+/** load one large LEF file serially and split over all cores */
+void benchLEFSplit(uint32_t macros)
+{
+    auto filename = tempFileName("padring_bench_split.lef");
+    writeSyntheticLEF(filename, macros);
+    const double megabytes = std::filesystem::file_size(filename) / (1024.0*1024.0);
+
+    size_t serialCells = 0;
+    double tSerial = timeIt([&]()
+        {
+            PRLEFReader reader;
+            LEFLoader loader(reader);
+            loader.setJobs(1);
+            loader.load({filename});
+            serialCells = reader.m_cells.size();
+        });
+
+    size_t splitCells = 0;
+    double tSplit = timeIt([&]()
+        {
+            PRLEFReader reader;
+            LEFLoader loader(reader);
+            loader.setJobs(0);
+            loader.load({filename});
+            splitCells = reader.m_cells.size();
+        });
+
+    printf("LEF split: %zu/%zu cells, %.1f MB\n", splitCells, serialCells, megabytes);
+    printf("  serial              : %8.1f ms\n", tSerial*1e3);
+    printf("  split (%2u jobs)     : %8.1f ms\n", ThreadPool::defaultThreadCount(), tSplit*1e3);
+
+    std::filesystem::remove(filename);
+}
+
+/** compare parsing a LEF file to loading its .padlib cache */
+void benchPadLib(uint32_t macros)
+{
+    auto filename  = tempFileName("padring_bench_cache.lef");
+    auto cachename = tempFileName("padring_bench_cache.padlib");
+    writeSyntheticLEF(filename, macros);
+    const double megabytes = std::filesystem::file_size(filename) / (1024.0*1024.0);
+
+    size_t cells = 0;
+    double tParse = timeIt([&]()
+        {
+            PRLEFReader reader;
+            reader.parseFile(filename);
+            cells = reader.m_cells.size();
+        });
+
+    double tWrite = timeIt([&]()
+        {
+            PadLib::fileState_t state;
+            PadLib::fileStatus(filename, state.m_size, state.m_mtime);
+            MappedFile file;
+            file.open(filename);
+            state.m_hash = PadLib::hash(file.data(), file.size());
+
+            PRLEFReader reader;
+            reader.parse(file.data(), file.size());
+            PadLib::write(cachename, {filename}, {state}, reader);
+        }, 1) - tParse;
+
+    size_t cachedCells = 0;
+    double tRead = timeIt([&]()
+        {
+            PRLEFReader reader;
+            PadLib::read(cachename, {filename}, reader);
+            cachedCells = reader.m_cells.size();
+        });
+
+    printf("LEF cache: %zu/%zu cells, %.1f MB LEF, %.1f MB cache\n", cachedCells, cells,
+        megabytes, std::filesystem::file_size(cachename) / (1024.0*1024.0));
+    printf("  parse LEF    : %8.1f ms\n", tParse*1e3);
+    printf("  write cache  : %8.1f ms\n", tWrite*1e3);
+    printf("  read cache   : %8.1f ms\n", tRead*1e3);
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove(cachename);
+}
+
+/** compare parsing a whole library to indexing it and parsing
+    only the cells used by a 40-pad design plus the fillers */
+void benchLazy(uint32_t macros)
+{
+    auto filename = tempFileName("padring_bench_lazy.lef");
+    writeSyntheticLEF(filename, macros);
+
+    // pads used by the design, fillers are every 10th macro
+    std::vector<std::string> pads;
+    for(uint32_t m=1; (m<macros) && (pads.size()<40); m+=macros/40 + 1)
+    {
+        pads.push_back("PAD_" + std::to_string(m));
+    }
+
+    size_t cells = 0;
+    double tFull = timeIt([&]()
+        {
+            PRLEFReader reader;
+            reader.parseFile(filename);
+            for(auto const &pad : pads)
+            {
+                reader.getCellByName(pad);
+            }
+            cells = reader.m_cells.size();
+        });
+
+    size_t parsed = 0;
+    double tLazy = timeIt([&]()
+        {
+            PRLEFReader reader;
+            reader.indexFile(filename);
+            for(auto const &pad : pads)
+            {
+                reader.getCellByName(pad);
+            }
+            reader.materializeFillers();
+            parsed = reader.m_cells.size();
+        });
+
+    // the first load writes the sidecar index, the timed ones use it
+    auto indexed = [&]()
+        {
+            PRLEFReader reader;
+            LEFLoader loader(reader);
+            loader.setLazy(true);
+            loader.setUseIndex(true);
+            loader.load({filename});
+            for(auto const &pad : pads)
+            {
+                reader.getCellByName(pad);
+            }
+            reader.materializeFillers();
+        };
+    setLogLevel(LOG_ERROR);
+    indexed();
+    double tIndexed = timeIt(indexed);
+    setLogLevel(LOG_INFO);
+
+    printf("Lazy LEF: %zu pads, %zu of %zu cells parsed\n", pads.size(), parsed, cells);
+    printf("  full parse   : %8.1f ms\n", tFull*1e3);
+    printf("  lazy         : %8.1f ms\n", tLazy*1e3);
+    printf("  lazy + index : %8.1f ms\n", tIndexed*1e3);
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove(LEFIndex::indexFileName(filename));
+}
+
+/** build a shape index over a ring of 'items' placed cells, mostly
+    fillers, and time box and nearest-neighbour queries on it */
+void benchShapeIndex(uint32_t items)
+{
+    auto filename = tempFileName("padring_bench_shapes.lef");
+    writeSyntheticLEF(filename, 2);     // PAD_0 is a 1 micron filler, PAD_1 a pad with pins
+    PRLEFReader reader;
+    reader.parseFile(filename);
+    std::filesystem::remove(filename);
+
+    PRLEFReader::LEFCellInfo_t *filler = reader.getCellByName("PAD_0");
+    PRLEFReader::LEFCellInfo_t *pad = reader.getCellByName("PAD_1");
+
+    // a pad after every 50 fillers, the same sequence on every edge
+    const uint32_t perEdge = items / 4;
+    const double edgeLength = perEdge * (filler->m_sx + pad->m_sx / 50.0) + 2*150.0;
+    const char *locations[4] = {"S", "N", "W", "E"};
+    std::deque<LayoutItem> placed;
+    for(uint32_t edge=0; edge<4; edge++)
+    {
+        double pos = 150.0;
+        for(uint32_t i=0; i<perEdge; i++)
+        {
+            const bool isPad = (i % 50) == 49;
+            placed.emplace_back(isPad ? LayoutItem::TYPE_CELL : LayoutItem::TYPE_FILLER);
+            LayoutItem &item = placed.back();
+            item.m_lefinfo  = isPad ? pad : filler;
+            item.m_cellname = item.m_lefinfo->m_name;
+            item.m_location = locations[edge];
+            const bool horizontal = (edge < 2);
+            item.m_x = horizontal ? pos : ((edge == 2) ? 0.0 : edgeLength);
+            item.m_y = horizontal ? ((edge == 0) ? 0.0 : edgeLength) : pos;
+            pos += item.m_lefinfo->m_sx;
+        }
+    }
+
+    ShapeIndex index;
+    double tBuild = timeIt([&]()
+        {
+            index = ShapeIndex();
+            for(auto const &item : placed)
+            {
+                index.addItem(&item, reader);
+            }
+            index.build();
+        });
+
+    // the outline of every placed cell, as the overlap check does
+    std::vector<ShapeIndex::box_t> boxes;
+    for(uint32_t i=0; i<index.size(); i++)
+    {
+        if (index.shape(i).m_kind == ShapeIndex::SHAPE_OUTLINE)
+        {
+            boxes.push_back(index.shape(i).m_box);
+        }
+    }
+
+    size_t hits = 0;
+    double tQuery = timeIt([&]()
+        {
+            hits = 0;
+            for(auto const &box : boxes)
+            {
+                index.query(box, [&hits](const ShapeIndex::shape_t &) { hits++; return true; });
+            }
+        });
+
+    size_t found = 0;
+    double tNearest = timeIt([&]()
+        {
+            found = 0;
+            for(auto const &box : boxes)
+            {
+                auto result = index.nearest(box.m_x1 - 0.5, box.m_y1 - 0.5, 4, 1.0e30,
+                    [](const ShapeIndex::shape_t &shape) { return shape.m_kind == ShapeIndex::SHAPE_PIN; });
+                found += result.size();
+            }
+        });
+
+    double tOverlaps = timeIt([&]()
+        {
+            index.findOverlaps();
+        });
+
+    printf("Shape index: %zu cells, %zu shapes\n", placed.size(), index.size());
+    printf("  build          : %8.1f ms\n", tBuild*1e3);
+    printf("  box query      : %8.2f us/query, %.1f hits\n", tQuery*1e6 / boxes.size(),
+        static_cast<double>(hits) / boxes.size());
+    printf("  4 nearest pins : %8.2f us/query\n", tNearest*1e6 / boxes.size());
+    printf("  overlap check  : %8.1f ms\n", tOverlaps*1e3);
+}
+
+/** resident set size of this process in kilobytes,
+    0 if it cannot be determined */
+size_t residentKB()
+{
+    std::ifstream is("/proc/self/status");
+    std::string line;
+    while(std::getline(is, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+        {
+            return static_cast<size_t>(atol(line.c_str() + 6));
+        }
+    }
+    return 0;
+}
+
+/** check the parsed cells on one thread and on all cores */
+void benchCheck(uint32_t macros)
+{
+    auto filename = tempFileName("padring_bench.lef");
+    writeSyntheticLEF(filename, macros);
+
+    PRLEFReader reader;
+    reader.parseFile(filename);
+
+    PRLEFReader::integrityReport_t report;
+    double tSerial = timeIt([&]()
+        {
+            report = reader.checkCells(1.0, 1);
+        });
+
+    double tParallel = timeIt([&]()
+        {
+            report = reader.checkCells(1.0, 0);
+        });
+
+    printf("Cell checks: %zu cells, %zu without CLASS\n", report.m_checked,
+        report.m_count[PRLEFReader::integrityReport_t::ISSUE_NO_CLASS]);
+    printf("  1 thread   : %8.2f ms\n", tSerial*1e3);
+    printf("  %2u threads : %8.2f ms\n", ThreadPool::defaultThreadCount(), tParallel*1e3);
+
+    std::filesystem::remove(filename);
+}
+
+/** memory held by the cell database of a library with
+    names as long as those of real pad libraries */
+void benchMemory(uint32_t macros)
+{
+    auto filename = tempFileName("padring_bench_memory.lef");
+    writeSyntheticLEF(filename, macros, "foundry_io_lib__pad_");
+
+    size_t before = residentKB();
+    size_t after  = 0;
+    size_t cells  = 0;
+    size_t rects  = 0;
+    size_t geometryKB = 0;
+    {
+        PRLEFReader reader;
+        LEFLoader loader(reader);
+        loader.setJobs(1);
+        loader.load({filename});
+        cells = reader.m_cells.size();
+        rects = reader.m_geometry.rectCount();
+        geometryKB = reader.m_geometry.bytesReserved() / 1024;
+        after = residentKB();
+    }
+    // hand freed heap memory back to the system so
+    // leaked cells show up in the resident size.
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    size_t freed = residentKB();
+
+    printf("Cell database memory: %zu cells, %zu rectangles\n", cells, rects);
+    printf("  resident     : %8zu KB (%.0f bytes/cell)\n", after - before,
+        (after - before) * 1024.0 / std::max<size_t>(cells, 1));
+    printf("  geometry     : %8zu KB\n", geometryKB);
+    printf("  after free   : %8zu KB\n", (freed > before) ? freed - before : 0);
+
+    std::filesystem::remove(filename);
+}
+
+/** memory of several revisions of a library, each in its
+    own reader and together in a LibraryManager */
+void benchLibraries(uint32_t macros)
+{
+    const uint32_t revisions = 4;
+    std::vector<std::string> filenames;
+    for(uint32_t r=0; r<revisions; r++)
+    {
+        filenames.push_back(tempFileName("padring_bench_rev" + std::to_string(r) + ".lef"));
+        writeSyntheticLEF(filenames.back(), macros, "foundry_io_lib__pad_", r);
+    }
+
+    size_t separateKB = 0;
+    {
+        size_t before = residentKB();
+        std::vector<std::unique_ptr<PRLEFReader> > readers;
+        for(auto const &filename : filenames)
+        {
+            readers.push_back(std::make_unique<PRLEFReader>());
+            LEFLoader loader(*readers.back());
+            loader.setJobs(1);
+            loader.load({filename});
+        }
+        separateKB = residentKB() - before;
+    }
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+
+    size_t sharedKB = 0;
+    size_t records  = 0;
+    size_t shared   = 0;
+    double tSwitch  = 0.0;
+    {
+        size_t before = residentKB();
+        PRLEFReader store;
+        LibraryManager manager(store);
+        for(uint32_t r=0; r<revisions; r++)
+        {
+            manager.load("rev" + std::to_string(r), {filenames[r]}, 1);
+        }
+        // the readers the files were parsed into are gone
+#ifdef __GLIBC__
+        malloc_trim(0);
+#endif
+        sharedKB = residentKB() - before;
+        records  = manager.recordCount();
+        shared   = manager.sharedCellCount("rev1");
+
+        uint32_t next = 0;
+        tSwitch = timeIt([&]()
+            {
+                manager.activate("rev" + std::to_string(next++ % revisions));
+            });
+    }
+
+    printf("Libraries: %u revisions of %u cells, %zu distinct records, %zu cells of rev1 shared\n",
+        revisions, macros, records, shared);
+    printf("  separate readers : %8zu KB\n", separateKB);
+    printf("  library manager  : %8zu KB\n", sharedKB);
+    printf("  switch library   : %8.2f us\n", tSwitch*1e6);
+
+    for(auto const &filename : filenames)
+    {
+        std::filesystem::remove(filename);
+    }
+}
+
+/** compare two revisions of a library */
+void benchDiff(uint32_t macros)
+{
+    auto oldName = tempFileName("padring_bench_old.lef");
+    auto newName = tempFileName("padring_bench_new.lef");
+    writeSyntheticLEF(oldName, macros, "PAD_", 0);
+    writeSyntheticLEF(newName, macros, "PAD_", 1);
+
+    PRLEFReader oldLib;
+    PRLEFReader newLib;
+    LEFLoader(oldLib).load({oldName});
+    LEFLoader(newLib).load({newName});
+
+    LEFDiff::result_t result;
+    double tDiff = timeIt([&]()
+        {
+            result = LEFDiff::compare(oldLib, newLib);
+        });
+
+    printf("LEF diff: %u cells, %zu changed\n", macros, result.m_changed.size());
+    printf("  compare : %8.1f ms  %8.1f ns/cell\n", tDiff*1e3, tDiff*1e9 / std::max<uint32_t>(macros, 1));
+
+    std::filesystem::remove(oldName);
+    std::filesystem::remove(newName);
+}
+
+/** counts the pads of a configuration, one callback per pad */
+class PadCounter : public ConfigReader
+{
+public:
+    size_t m_pads = 0;
+
+    virtual void onCorner(const std::string &instance, const std::string &location,
+        const std::string &cellname) override {}
+    virtual void onPad(const std::string &instance, const std::string &location,
+        const std::string &cellname, bool flipped) override
+    {
+        m_pads++;
+    }
+    virtual void onArea(double x, double y) override {}
+    virtual void onGrid(double grid) override {}
+    virtual void onSpace(double space) override {}
+    virtual void onDesignName(const std::string &designName) override {}
+};
+
+/** counts the pads of a configuration, one callback per batch */
+class BatchPadCounter : public PadCounter
+{
+public:
+    virtual void onPads(const padRecord_t *pads, size_t count) override
+    {
+        m_pads += count;
+    }
+};
+
+/** parse a configuration file with 'lines' PAD statements */
+void benchConfig(uint32_t lines)
+{
+    std::string config = "DESIGN BENCH;\nAREA 100000 100000;\nGRID 0.005;\n";
+    config += "CORNER C1 NW CORNER;\nCORNER C2 NE CORNER;\nCORNER C3 SE CORNER;\nCORNER C4 SW CORNER;\n";
+    const char *sides[] = {"N", "E", "S", "W"};
+    for(uint32_t i=0; i<lines; i++)
+    {
+        config += "PAD io_" + std::to_string(i) + " " + sides[i % 4] +
+            ((i % 8) == 0 ? " FLIP" : "") + " PAD_" + std::to_string(i % 100) + ";\n";
+        if ((i % 64) == 63)
+        {
+            config += "SPACE 10;   # keep the pads apart\n";
+        }
+    }
+
+    size_t pads = 0;
+    double tStream = timeIt([&]()
+        {
+            std::istringstream stream(config);
+            BatchPadCounter reader;
+            reader.parse(stream);
+            pads = reader.m_pads;
+        });
+
+    double tSingle = timeIt([&]()
+        {
+            PadCounter reader;
+            reader.parse(config.data(), config.size());
+        });
+
+    double tBatch = timeIt([&]()
+        {
+            BatchPadCounter reader;
+            reader.parse(config.data(), config.size());
+        });
+
+    std::string compiled;
+    double tCompile = timeIt([&]()
+        {
+            PadCfg::compile(config.data(), config.size(), compiled);
+        });
+
+    double tCompiled = timeIt([&]()
+        {
+            BatchPadCounter reader;
+            reader.parse(compiled.data(), compiled.size());
+        });
+
+    printf("Config: %zu pads, %.1f MB, compiled %.1f MB\n", pads, config.size() / 1.0e6, compiled.size() / 1.0e6);
+    printf("  istream        : %8.1f ms  %6.2f M lines/s\n", tStream*1e3, lines / tStream / 1e6);
+    printf("  buffer, onPad  : %8.1f ms  %6.2f M lines/s\n", tSingle*1e3, lines / tSingle / 1e6);
+    printf("  buffer, onPads : %8.1f ms  %6.2f M lines/s\n", tBatch*1e3, lines / tBatch / 1e6);
+    printf("  compile        : %8.1f ms\n", tCompile*1e3);
+    printf("  compiled       : %8.1f ms  %6.2f M lines/s\n", tCompiled*1e3, lines / tCompiled / 1e6);
+}
+
+/** load a LEF library and a configuration that places
+    'pads' of its cells, one after the other and overlapped */
+void benchResolve(uint32_t pads)
+{
+    auto lefName = tempFileName("padring_bench_resolve.lef");
+    writeSyntheticLEF(lefName, pads);
+
+    std::string config = "AREA 100000000 100000000;\n";
+    const char *sides[] = {"N", "E", "S", "W"};
+    for(uint32_t i=0; i<pads; i++)
+    {
+        config += "PAD io_" + std::to_string(i) + " " + sides[i % 4] + " PAD_" + std::to_string(i) + ";\n";
+    }
+
+    auto load = [&](bool overlapped)
+        {
+            PadringDB padring;
+            LEFLoader loader(padring.m_lefreader);
+            loader.setJobs(1);
+            if (overlapped)
+            {
+                std::thread configThread([&]() { padring.parse(config.data(), config.size()); });
+                loader.load({lefName});
+                configThread.join();
+            }
+            else
+            {
+                loader.load({lefName});
+                padring.parse(config.data(), config.size());
+            }
+            padring.resolveCells();
+        };
+
+    double tSequential = timeIt([&]() { load(false); });
+    double tOverlapped = timeIt([&]() { load(true); });
+
+    printf("Resolve: %u pads and cells, %u cores\n", pads, std::thread::hardware_concurrency());
+    printf("  LEF, then config : %8.1f ms\n", tSequential*1e3);
+    printf("  overlapped       : %8.1f ms\n", tOverlapped*1e3);
+
+    std::filesystem::remove(lefName);
+}
+
+/** parse 'configs' configurations that include the same block of pads */
+void benchInclude(uint32_t configs)
+{
+    const uint32_t blockPads = 1000;
+    auto blockName = tempFileName("padring_bench_block.cfg");
+    {
+        std::ofstream os(blockName);
+        for(uint32_t i=0; i<blockPads; i++)
+        {
+            os << "PAD lane_" << i << " N IOPAD_" << (i % 8) << " ;\n";
+        }
+    }
+
+    std::string config = "AREA 10000 10000;\nINCLUDE \"" + blockName + "\";\nPAD TEST S IOPAD;\n";
+    const std::string configName = tempFileName("padring_bench_chip.config");
+
+    size_t pads = 0;
+    auto parseAll = [&](bool cached)
+        {
+            ConfigReader::clearIncludeCache();
+            pads = 0;
+            for(uint32_t i=0; i<configs; i++)
+            {
+                if (!cached)
+                {
+                    ConfigReader::clearIncludeCache();
+                }
+                BatchPadCounter reader;
+                reader.parse(config.data(), config.size(), configName);
+                pads += reader.m_pads;
+            }
+        };
+
+    double tParsed = timeIt([&]() { parseAll(false); });
+    double tCached = timeIt([&]() { parseAll(true); });
+
+    printf("Include: %u configurations, %zu pads\n", configs, pads);
+    printf("  parsed every time : %8.1f ms\n", tParsed*1e3);
+    printf("  parsed once       : %8.1f ms\n", tCached*1e3);
+
+    std::filesystem::remove(blockName);
+}
+
+/** lay out an edge with a bus of 'pads' pads, given pad by pad and as one run */
+void benchBusRun(uint32_t pads)
+{
+    const double padWidth = 50.0;
+    auto makeEdge = [&](Layout &edge, bool asRun)
+        {
+            edge.setDieSize(pads * padWidth * 2.0);
+            uint32_t items = asRun ? 1 : pads;
+            for(uint32_t i=0; i<items; i++)
+            {
+                LayoutItem *item = new LayoutItem(LayoutItem::TYPE_CELL);
+                item->m_size = padWidth;
+                item->m_location = "N";
+                if (asRun)
+                {
+                    item->m_instance  = "GPIO";
+                    item->m_count     = pads;
+                    item->m_busStride = 1;
+                }
+                else
+                {
+                    item->m_instance = "GPIO[" + std::to_string(i) + "]";
+                }
+                edge.addItem(item);
+            }
+            edge.doLayout();
+        };
+
+    size_t itemsLines = 0;
+    size_t itemsRun   = 0;
+    size_t expandedRun = 0;
+    double tLines = timeIt([&]()
+        {
+            Layout edge(Layout::DIR_HORIZONTAL);
+            makeEdge(edge, false);
+            itemsLines = std::distance(edge.begin(), edge.end());
+        });
+
+    double tRun = timeIt([&]()
+        {
+            Layout edge(Layout::DIR_HORIZONTAL);
+            makeEdge(edge, true);
+            itemsRun = std::distance(edge.begin(), edge.end());
+        });
+
+    double tExpand = timeIt([&]()
+        {
+            Layout edge(Layout::DIR_HORIZONTAL);
+            makeEdge(edge, true);
+            std::deque<LayoutItem> storage;
+            expandedRun = edge.expandItems(storage).size();
+        });
+
+    printf("Bus run: %u pads, %zu bytes per layout item\n", pads, sizeof(LayoutItem));
+    printf("  pad by pad    : %8zu items  %8.2f ms\n", itemsLines, tLines*1e3);
+    printf("  run           : %8zu items  %8.2f ms\n", itemsRun, tRun*1e3);
+    printf("  run, expanded : %8zu items  %8.2f ms\n", expandedRun, tExpand*1e3);
+}
+
+/** the string compare chains the readers used before Keywords */
+keyword_t compareChain(std::string_view txt)
+{
+    if (txt == "MACRO") return KW_MACRO;
+    else if (txt == "LAYER") return KW_LAYER;
+    else if (txt == "VIA") return KW_VIA;
+    else if (txt == "VIARULE") return KW_VIARULE;
+    else if (txt == "UNITS") return KW_UNITS;
+    else if (txt == "PROPERTYDEFINITIONS") return KW_PROPERTYDEFINITIONS;
+    else if (txt == "PIN") return KW_PIN;
+    else if (txt == "CLASS") return KW_CLASS;
+    else if (txt == "ORIGIN") return KW_ORIGIN;
+    else if (txt == "FOREIGN") return KW_FOREIGN;
+    else if (txt == "SIZE") return KW_SIZE;
+    else if (txt == "SYMMETRY") return KW_SYMMETRY;
+    else if (txt == "SITE") return KW_SITE;
+    else if (txt == "DIRECTION") return KW_DIRECTION;
+    else if (txt == "USE") return KW_USE;
+    else if (txt == "PORT") return KW_PORT;
+    else if (txt == "END") return KW_END;
+    return KW_NONE;
+}
+
+/** map identifiers of a macro-heavy LEF to keywords */
+void benchKeywords(uint32_t count)
+{
+    const std::vector<std::string> words =
+    {
+        "MACRO", "PAD_IN_1V8", "CLASS", "PAD", "INOUT", "FOREIGN", "SIZE", "BY",
+        "SYMMETRY", "X", "Y", "R90", "SITE", "io_site", "PIN", "D", "DIRECTION",
+        "USE", "SIGNAL", "PORT", "LAYER", "MET1", "RECT", "END", "OBS", "PAD_IN_1V8"
+    };
+
+    // pseudo-random order so the branch predictor
+    // cannot learn the sequence
+    std::vector<std::string_view> tokens;
+    tokens.reserve(count*10);
+    uint32_t rnd = 12345;
+    for(uint32_t i=0; i<count*10; i++)
+    {
+        rnd = rnd*1664525 + 1013904223;
+        tokens.push_back(words[(rnd >> 8) % words.size()]);
+    }
+
+    uint64_t sum = 0;
+    double tChain = timeIt([&]()
+        {
+            for(auto const &tok : tokens)
+            {
+                sum += compareChain(tok);
+            }
+        });
+
+    double tHash = timeIt([&]()
+        {
+            for(auto const &tok : tokens)
+            {
+                sum += Keywords::lookup(tok);
+            }
+        });
+
+    printf("Keywords: %zu identifiers (checksum %lu)\n", tokens.size(), static_cast<unsigned long>(sum));
+    printf("  compare chain: %8.2f ns/identifier\n", tChain*1e9 / tokens.size());
+    printf("  perfect hash : %8.2f ns/identifier\n", tHash*1e9 / tokens.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string which = (argc > 1) ? argv[1] : "all";
+    uint32_t size = (argc > 2) ? static_cast<uint32_t>(atoi(argv[2])) : 20000;
+
+    if ((which == "all") || (which == "lef"))
+    {
+        benchLEFReader(size);
+    }
+
+    if ((which == "all") || (which == "tech"))
+    {
+        benchTechLEF(size);
+    }
+
+    if ((which == "all") || (which == "loader"))
+    {
+        benchLEFLoader(size);
+    }
+
+    if ((which == "all") || (which == "split"))
+    {
+        benchLEFSplit(size);
+    }
+
+    if ((which == "all") || (which == "cache"))
+    {
+        benchPadLib(size);
+    }
+
+    if ((which == "all") || (which == "lazy"))
+    {
+        benchLazy(size);
+    }
+
+    if ((which == "all") || (which == "shapes"))
+    {
+        benchShapeIndex(size);
+    }
+
+    if ((which == "all") || (which == "check"))
+    {
+        benchCheck(size);
+    }
+
+    if ((which == "all") || (which == "libraries"))
+    {
+        benchLibraries(size);
+    }
+
+    if ((which == "all") || (which == "diff"))
+    {
+        benchDiff(size);
+    }
+
+    if ((which == "all") || (which == "config"))
+    {
+        benchConfig(size);
+    }
+
+    if ((which == "all") || (which == "resolve"))
+    {
+        benchResolve(size);
+    }
+
+    if ((which == "all") || (which == "include"))
+    {
+        benchInclude(size);
+    }
+
+    if ((which == "all") || (which == "bus"))
+    {
+        benchBusRun(size);
+    }
+
+    if ((which == "all") || (which == "keywords"))
+    {
+        benchKeywords(size);
+    }
+
+    if ((which == "all") || (which == "memory"))
+    {
+        benchMemory(size);
+    }
+
+    return 0;
+}
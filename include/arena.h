@@ -0,0 +1,119 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef arena_h
+#define arena_h
+
+#include <cstddef>
+#include <stdint.h>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/** A bump allocator. Memory is handed out from large blocks
+    and only released, all at once, when the arena is destroyed.
+    Objects created in an arena are never destructed.
+*/
+class Arena
+{
+public:
+    Arena(size_t blockSize = 64*1024) : m_blockSize(blockSize),
+        m_ptr(nullptr), m_end(nullptr), m_bytes(0) {}
+
+    Arena(const Arena &) = delete;
+    Arena& operator=(const Arena &) = delete;
+
+    /** get 'bytes' bytes of memory aligned to 'align',
+        which must be a power of two. */
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+    {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(m_ptr) + align - 1) & ~(uintptr_t)(align - 1);
+        if ((m_ptr == nullptr) || (p + bytes > reinterpret_cast<uintptr_t>(m_end)))
+        {
+            return allocateSlow(bytes, align);
+        }
+        m_ptr = reinterpret_cast<char*>(p + bytes);
+        return reinterpret_cast<void*>(p);
+    }
+
+    /** construct an object in the arena */
+    template<class T, class... Args> T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+            "arena objects are never destructed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /** take over the memory of another arena. Objects
+        allocated from it stay valid for our lifetime. */
+    void adopt(Arena &other);
+
+    /** number of bytes in the blocks of the arena */
+    size_t bytesReserved() const
+    {
+        return m_bytes;
+    }
+
+protected:
+    void* allocateSlow(size_t bytes, size_t align);
+
+    size_t  m_blockSize;    ///< size of a regular block
+    char    *m_ptr;         ///< next free byte in the current block
+    char    *m_end;         ///< end of the current block
+    size_t  m_bytes;        ///< bytes in all blocks
+    std::vector<std::unique_ptr<char[]> > m_blocks;
+};
+
+/** Stores each distinct string once, in an arena.
+    The views returned by intern() are NUL terminated and
+    stay valid as long as the arena, so two strings from the
+    same pool are equal when their data pointers are. The
+    empty string is returned as a default constructed view.
+*/
+class StringPool
+{
+public:
+    StringPool(Arena &arena) : m_arena(arena) {}
+
+    StringPool(const StringPool &) = delete;
+    StringPool& operator=(const StringPool &) = delete;
+
+    /** get the pooled copy of a string */
+    std::string_view intern(std::string_view str);
+
+    /** add the strings of another pool, without copying them.
+        Our arena must have adopted the arena of the other pool. */
+    void merge(const StringPool &other);
+
+    /** number of distinct strings */
+    size_t size() const
+    {
+        return m_strings.size();
+    }
+
+protected:
+    Arena                                   &m_arena;
+    std::unordered_set<std::string_view>    m_strings;
+};
+
+#endif
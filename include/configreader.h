@@ -24,6 +24,7 @@
 #include<vector>
 #include<array>
 #include<string>
+#include<string_view>
 #include<iostream>
 
 #include "linereader.h"
@@ -54,7 +55,7 @@
 class ConfigReader
 {
 public:
-    ConfigReader() : m_padCount(0) {}
+    ConfigReader() : m_ptr(nullptr), m_end(nullptr), m_lineNum(0), m_padCount(0) {}
     
     virtual ~ConfigReader() {}
 
@@ -75,8 +76,50 @@ public:
         TOK_ERR
     };
 
+    /** a PAD statement as delivered to onPads().
+        the names point into the configuration text
+        and are only valid during the callback. */
+    struct padRecord_t
+    {
+        std::string_view m_instance;    ///< instance name, or the bus name of a range
+        std::string_view m_location;    ///< one of N,S,W,E
+        std::string_view m_cellname;
+        bool             m_flipped;
+        uint32_t         m_line;        ///< line of the PAD, or of the INCLUDE it came from; 0 if compiled
+
+        bool             m_bus;         ///< true for a bus range, i.e. GPIO[0:255]
+        uint32_t         m_busFirst;    ///< index of the first pad of a bus range
+        int32_t          m_busStride;   ///< index step, negative for descending ranges
+        uint32_t         m_count;       ///< number of pads, 1 unless a bus range
+
+        /** instance name of the n-th pad of the record */
+        std::string instanceName(uint32_t n) const
+        {
+            if (!m_bus)
+            {
+                return std::string(m_instance);
+            }
+            return std::string(m_instance) + "[" +
+                std::to_string(static_cast<int64_t>(m_busFirst) + static_cast<int64_t>(n)*m_busStride) + "]";
+        }
+    };
+
+    /** maximum number of PAD statements handed to onPads() at once */
+    static constexpr size_t c_padBatchSize = 1024;
+
+    /** read the whole stream into memory and parse it */
     bool parse(std::istream &configfile);
 
+    /** parse a configuration that is already in memory, either
+        text or compiled by PadCfg. the memory must stay valid
+        while parsing. the file name is used in error messages
+        and to find the files named by INCLUDE statements. */
+    bool parse(const char *data, size_t bytes, const std::string &fileName = "");
+
+    /** forget the included files parsed so far, so they are
+        read again the next time they are included. */
+    static void clearIncludeCache();
+
     /** callback for a corner */
     virtual void onCorner(
         const std::string &instance,
@@ -99,6 +142,22 @@ public:
         std::cout << "PAD " << instance << " " << location << " " << cellname << "\n";
     }
 
+    /** callback for a run of consecutive PAD statements, in file order.
+        pending pads are always delivered before any other callback.
+        the default implementation calls onPad for each of them and
+        for each pad of a bus range. */
+    virtual void onPads(const padRecord_t *pads, size_t count)
+    {
+        for(size_t i=0; i<count; i++)
+        {
+            for(uint32_t n=0; n<pads[i].m_count; n++)
+            {
+                onPad(pads[i].instanceName(n), std::string(pads[i].m_location),
+                    std::string(pads[i].m_cellname), pads[i].m_flipped);
+            }
+        }
+    }
+
     /** callback for die area in microns */
     virtual void onArea(double x, double y) 
     {
@@ -142,15 +201,19 @@ public:
     }
 
 protected:
+    friend class PadCfg;
+    class IncludeGuard;
+
     bool isWhitespace(char c) const;
     bool isAlpha(char c) const;
     bool isDigit(char c) const;
     bool isAlphaNumeric(char c) const;
     bool isSpecialIdentChar(char c) const;
 
-    bool inArray(const std::string &value, const std::array<std::string, 4> &array);
+    bool inArray(std::string_view value, const std::array<std::string_view, 4> &array);
 
     bool parsePad();
+    bool parseBusRange(padRecord_t &pad);
     bool parseCorner();
     bool parseArea();
     bool parseGrid();
@@ -158,14 +221,20 @@ protected:
     bool parseOffset();
     bool parseFiller();
     bool parseDesignName();
+    bool parseInclude();
+
+    /** hand the collected PAD statements to onPads() */
+    void flushPads();
 
-    token_t      tokenize(std::string &tokstr);
-    char         m_tokchar;
+    token_t      tokenize(std::string_view &tokstr);
 
     void error(const std::string &errstr);
 
-    std::istream *m_is;
+    std::string   m_fileName;   ///< name of the file being parsed, if known
+    const char   *m_ptr;        ///< next character to tokenize
+    const char   *m_end;        ///< end of the configuration text
     uint32_t      m_lineNum;
+    std::vector<padRecord_t> m_pads;    ///< PAD statements not yet delivered
     uint32_t      m_padCount;   ///< number of pad cells excluding corners
 };
 
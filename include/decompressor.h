@@ -0,0 +1,170 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef decompressor_h
+#define decompressor_h
+
+#include <stddef.h>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/** compressed file formats, recognised by their magic bytes */
+enum compression_t
+{
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+};
+
+/** determine the compression format from the first bytes of a file */
+compression_t detectCompression(const char *data, size_t bytes);
+
+/** human readable name of a compression format */
+const char* compressionName(compression_t type);
+
+/** true if padring was built with support for the format */
+bool isCompressionSupported(compression_t type);
+
+/** A stream buffer that decompresses gzip or zstd data read
+    from another stream. Input and output are processed in
+    fixed-size chunks, so memory use does not depend on the
+    size of the file.
+*/
+class DecompressingBuffer : public std::streambuf
+{
+public:
+    DecompressingBuffer(std::istream &source, compression_t type);
+    virtual ~DecompressingBuffer();
+
+    DecompressingBuffer(const DecompressingBuffer&) = delete;
+    DecompressingBuffer& operator=(const DecompressingBuffer&) = delete;
+
+    /** true if the compressed data was damaged or
+        the decoder could not be set up */
+    bool failed() const
+    {
+        return m_failed;
+    }
+
+    static constexpr size_t c_chunkSize = 64*1024;  ///< bytes per read and per decoded chunk
+
+protected:
+    virtual int_type underflow() override;
+
+    /** decode the next chunk into m_out, returns
+        the number of bytes produced, 0 at the end */
+    size_t decodeChunk();
+
+    /** read more compressed input, false at end of file */
+    bool readInput();
+
+    std::istream        &m_source;
+    compression_t       m_type;
+    std::vector<char>   m_in;       ///< compressed input
+    std::vector<char>   m_out;      ///< decompressed output
+    size_t              m_inPos;    ///< consumed bytes in m_in
+    size_t              m_inSize;   ///< valid bytes in m_in
+    bool                m_failed;
+    bool                m_finished; ///< end of the last frame/member seen
+    void                *m_decoder; ///< z_stream or ZSTD_DStream
+};
+
+/** An input file that is decompressed on the fly when
+    it is gzip or zstd compressed. Uncompressed files are
+    read as they are.
+*/
+class InputFile : public std::istream
+{
+public:
+    InputFile();
+    InputFile(const std::string &filename);
+    virtual ~InputFile();
+
+    /** open a file, returns false if it cannot be read or
+        its compression format is not supported. */
+    bool open(const std::string &filename);
+
+    /** true if a file was opened */
+    bool isOpen() const
+    {
+        return m_file.is_open();
+    }
+
+    /** true if the compressed data was damaged */
+    bool failed() const
+    {
+        return m_decompressor && m_decompressor->failed();
+    }
+
+    /** compression format of the file */
+    compression_t compression() const
+    {
+        return m_compression;
+    }
+
+protected:
+    std::ifstream                           m_file;
+    std::unique_ptr<DecompressingBuffer>    m_decompressor;
+    compression_t                           m_compression;
+};
+
+/** read a whole, possibly compressed, file into memory.
+    returns false if it cannot be read. */
+bool readDecompressed(const std::string &filename, std::vector<char> &data);
+
+/** decompress a gzip or zstd compressed buffer that is already
+    in memory. returns false if the data is damaged or the format
+    is not supported. */
+bool decompressBuffer(const char *src, size_t bytes, std::vector<char> &data);
+
+/** An input stream over a block of memory. The memory is
+    not copied and must outlive the stream.
+*/
+class MemoryStream : public std::istream
+{
+public:
+    MemoryStream(const char *data, size_t bytes) : std::istream(nullptr), m_buffer(data, bytes)
+    {
+        rdbuf(&m_buffer);
+    }
+
+    virtual ~MemoryStream()
+    {
+        rdbuf(nullptr);
+    }
+
+protected:
+    class Buffer : public std::streambuf
+    {
+    public:
+        Buffer(const char *data, size_t bytes)
+        {
+            char *p = const_cast<char*>(data);
+            setg(p, p, p + bytes);
+        }
+    };
+
+    Buffer m_buffer;
+};
+
+#endif
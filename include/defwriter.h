@@ -49,7 +49,8 @@ public:
 
 protected:
 
-    /** convert to DEF database units / coordinates.
+    /** convert to DEF database units / coordinates,
+        rounded to the nearest integer.
         this function will issue a warning when
         m_databaseUnits has not been set and set it
         to 1000.
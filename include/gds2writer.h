@@ -55,7 +55,7 @@ protected:
 
 
     // returns the number of bytes written
-    uint32_t writeString(const std::string &str);
+    uint32_t writeString(std::string_view str);
 
     GDS2Writer(FILE *f, const std::string &designName);
 
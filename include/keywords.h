@@ -0,0 +1,171 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef keywords_h
+#define keywords_h
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+/** statement keywords of the LEF and config files */
+enum keyword_t : uint8_t
+{
+    KW_NONE = 0,    ///< not a keyword
+
+    // LEF
+    KW_CLASS,
+    KW_DATABASE,
+    KW_DIRECTION,
+    KW_END,
+    KW_FOREIGN,
+    KW_LAYER,
+    KW_MACRO,
+    KW_MASK,
+    KW_MAXWIDTH,
+    KW_MICRONS,
+    KW_OBS,
+    KW_OFFSET,
+    KW_ORIGIN,
+    KW_PIN,
+    KW_PITCH,
+    KW_PORT,
+    KW_PROPERTYDEFINITIONS,
+    KW_RECT,
+    KW_SITE,
+    KW_SIZE,
+    KW_SYMMETRY,
+    KW_TYPE,
+    KW_UNITS,
+    KW_USE,
+    KW_VIA,
+    KW_VIARULE,
+    KW_WIDTH,
+
+    // config
+    KW_AREA,
+    KW_CORNER,
+    KW_DESIGN,
+    KW_FILLER,
+    KW_GRID,
+    KW_INCLUDE,
+    KW_PAD,
+    KW_SPACE,
+
+    KW_COUNT
+};
+
+/** Maps identifier text to a keyword_t with a perfect hash
+    that is generated at compile time. The hash only looks at
+    the length and three characters of the text, so a lookup
+    costs one multiplication and one string compare.
+*/
+namespace Keywords
+{
+
+inline constexpr std::array<std::string_view, KW_COUNT> c_names =
+{
+    "",
+    "CLASS", "DATABASE", "DIRECTION", "END", "FOREIGN", "LAYER",
+    "MACRO", "MASK", "MAXWIDTH", "MICRONS", "OBS", "OFFSET", "ORIGIN",
+    "PIN", "PITCH", "PORT", "PROPERTYDEFINITIONS", "RECT", "SITE",
+    "SIZE", "SYMMETRY", "TYPE", "UNITS", "USE", "VIA", "VIARULE",
+    "WIDTH",
+    "AREA", "CORNER", "DESIGN", "FILLER", "GRID", "INCLUDE", "PAD", "SPACE"
+};
+
+inline constexpr uint32_t c_tableBits = 7;
+inline constexpr size_t   c_tableSize = 1 << c_tableBits;
+
+struct table_t
+{
+    uint32_t m_seed;
+    std::array<uint8_t, c_tableSize> m_slots;  ///< keyword in each slot, KW_NONE if empty
+    size_t   m_minLength;
+    size_t   m_maxLength;
+};
+
+/** multiplicative hash of the length and three characters */
+constexpr uint32_t hash(std::string_view txt, uint32_t seed)
+{
+    const uint32_t key = static_cast<uint32_t>(txt.size() & 0xFF) |
+        (static_cast<uint32_t>(static_cast<uint8_t>(txt[0])) << 8) |
+        (static_cast<uint32_t>(static_cast<uint8_t>(txt[txt.size()/2])) << 16) |
+        (static_cast<uint32_t>(static_cast<uint8_t>(txt[txt.size()-1])) << 24);
+    return (key * seed) >> (32 - c_tableBits);
+}
+
+/** find the first seed that places all keywords in different slots */
+constexpr table_t makeTable()
+{
+    table_t table{0, {}, c_names[1].size(), 0};
+    for(size_t kw=1; kw<KW_COUNT; kw++)
+    {
+        table.m_minLength = std::min(table.m_minLength, c_names[kw].size());
+        table.m_maxLength = std::max(table.m_maxLength, c_names[kw].size());
+    }
+
+    for(uint32_t seed=1; seed<1000000; seed+=2)
+    {
+        table.m_seed  = seed;
+        table.m_slots = {};
+        bool perfect = true;
+        for(size_t kw=1; perfect && (kw<KW_COUNT); kw++)
+        {
+            auto &slot = table.m_slots[hash(c_names[kw], seed)];
+            perfect = (slot == KW_NONE);
+            slot = static_cast<uint8_t>(kw);
+        }
+
+        if (perfect)
+        {
+            return table;
+        }
+    }
+
+    table.m_seed = 0;
+    return table;
+}
+
+inline constexpr table_t c_table = makeTable();
+
+static_assert(c_table.m_seed != 0, "no perfect hash found for the keywords, increase c_tableBits");
+
+/** return the keyword for the text, or KW_NONE */
+inline keyword_t lookup(std::string_view txt)
+{
+    if ((txt.size() < c_table.m_minLength) || (txt.size() > c_table.m_maxLength))
+    {
+        return KW_NONE;
+    }
+
+    const uint8_t id = c_table.m_slots[hash(txt, c_table.m_seed)];
+    return (c_names[id] == txt) ? static_cast<keyword_t>(id) : KW_NONE;
+}
+
+/** the text of a keyword */
+constexpr std::string_view name(keyword_t kw)
+{
+    return c_names[kw];
+}
+
+} // namespace
+
+#endif
@@ -22,8 +22,12 @@
 
 #include "prlefreader.h"
 
+#include <stdint.h>
 #include <string>
+#include <string_view>
 #include <list>
+#include <deque>
+#include <vector>
 
 class LayoutItem
 {
@@ -41,22 +45,63 @@ public:
         m_ltype(ltype),
         m_size(-1),
         m_x(-1.0), m_y(-1.0),
-        m_flipped(false)
+        m_flipped(false),
+        m_count(1),
+        m_busFirst(0),
+        m_busStride(0),
+        m_flexSize(0.0),
+        m_flexError(0.0)
     {        
     }
 
     virtual ~LayoutItem() {}
 
+    /** how the cell of an item is placed. The cell is
+        mirrored in the x axis when m_flip is set, then
+        rotated counter-clockwise by m_rotation degrees
+        and moved to (m_x, m_y), like a GDS2 SREF. */
+    struct placement_t
+    {
+        double      m_x;        ///< origin in microns
+        double      m_y;        ///< origin in microns
+        uint32_t    m_rotation; ///< 0, 90, 180 or 270 degrees
+        bool        m_flip;
+    };
+
+    /** get the placement of the cell from the position,
+        location and m_flipped. */
+    placement_t getPlacement() const;
+
+    /** true if the item is a run of bus pads that
+        has not been expanded into its cells. */
+    bool isRun() const
+    {
+        return m_count > 1;
+    }
+
+    /** instance name of the n-th cell of a run */
+    std::string runInstance(uint32_t n) const
+    {
+        return m_instance + "[" +
+            std::to_string(static_cast<int64_t>(m_busFirst) + static_cast<int64_t>(n)*m_busStride) + "]";
+    }
+
     PRLEFReader::LEFCellInfo_t *m_lefinfo;  ///< for CELLs and CORNERs, LEF info.
 
-    std::string m_instance; ///< instance name
-    std::string m_cellname; ///< cell name
-    std::string m_location; ///< location of cell
-    double      m_size;     ///< size of the item (-1 if unknown)
-    double      m_x;        ///< x-position of item (-1 if unknown)
-    double      m_y;        ///< y-position of item (-1 if unknown)
-    bool        m_flipped;  ///< when true, unplaced/unrotated cell is filled along y axis.
-    LayoutItemType m_ltype;
+    std::string         m_instance; ///< instance name
+    std::string_view    m_cellname; ///< cell name, owned by the LEF database
+    std::string_view    m_location; ///< location of cell
+    double              m_size;     ///< size of the item (-1 if unknown)
+    double              m_x;        ///< x-position of item (-1 if unknown)
+    double              m_y;        ///< y-position of item (-1 if unknown)
+    bool                m_flipped;  ///< when true, unplaced/unrotated cell is filled along y axis.
+    LayoutItemType      m_ltype;
+
+    uint32_t            m_count;     ///< number of cells of a bus run, 1 otherwise
+    uint32_t            m_busFirst;  ///< bus index of the first cell of a run
+    int32_t             m_busStride; ///< bus index step between the cells of a run
+    double              m_flexSize;  ///< mean FLEXSPACE size inside a run, set by the layout
+    double              m_flexError; ///< grid rounding error before the first FLEXSPACE of a run
 };
 
 
@@ -79,7 +124,9 @@ public:
 
     /** Add a layout item.
         Inserts a FLEXSPACE item if the previously
-        inserted item was a cell.
+        inserted item was a cell. A run of bus pads
+        is added as a single CELL item; the FLEXSPACEs
+        between its cells are implied.
     */
     void addItem(LayoutItem *item)
     {
@@ -158,6 +205,12 @@ public:
     /** dump layout */
     void dump();
 
+    /** get the laid out items with the bus runs expanded
+        into their cells and the FLEXSPACEs between them.
+        The expanded items are stored in 'storage', which
+        must outlive the returned list. */
+    std::vector<LayoutItem*> expandItems(std::deque<LayoutItem> &storage) const;
+
     typedef std::list<LayoutItem*>::iterator item_iterator;
 
     /** begin iterator for LayoutItems */
@@ -176,7 +229,7 @@ protected:
         return item->m_y;
     }
 
-    void setItemPos(LayoutItem *item, double pos)
+    void setItemPos(LayoutItem *item, double pos) const
     {
         if (item == nullptr)
         {
@@ -193,7 +246,7 @@ protected:
         }
     }
 
-    void setItemEdgePos(LayoutItem *item)
+    void setItemEdgePos(LayoutItem *item) const
     {
         if (item == nullptr)
         {
@@ -212,6 +265,10 @@ protected:
 
     void prepareForLayout();
 
+    /** size a FLEXSPACE that starts at 'pos' so the next item
+        lands on the grid. returns the position after it. */
+    double placeFlexSpace(double pos, double meanSize, double &error, double &size) const;
+
     bool   m_insertFlexSpacer;
     double m_dieSize;   ///< die size in the direction of layout
 
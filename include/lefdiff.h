@@ -0,0 +1,97 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef lefdiff_h
+#define lefdiff_h
+
+#include <stdint.h>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "prlefreader.h"
+
+/** Compares the cells of two LEF libraries, for instance
+    two revisions of a foundry IO library.
+
+    Each cell is reduced to a 64-bit hash of its size, class,
+    foreign name, symmetry, pins and obstructions, so a cell
+    that did not change costs one lookup and one hash per
+    library. Only the cells with different hashes are compared
+    field by field to report what changed. The coordinates are
+    compared in microns, so libraries with different database
+    units can be compared.
+*/
+class LEFDiff
+{
+public:
+    /** what changed in a cell, or'ed together */
+    enum change_t : uint32_t
+    {
+        CHANGE_SIZE      = 1,
+        CHANGE_CLASS     = 2,
+        CHANGE_FOREIGN   = 4,
+        CHANGE_SYMMETRY  = 8,
+        CHANGE_PINS      = 16,
+        CHANGE_OBS       = 32
+    };
+
+    struct changedCell_t
+    {
+        const PRLEFReader::LEFCellInfo_t *m_old;
+        const PRLEFReader::LEFCellInfo_t *m_new;
+        uint32_t m_changes;
+    };
+
+    /** the outcome of compare(), each list is sorted by name */
+    struct result_t
+    {
+        std::vector<const PRLEFReader::LEFCellInfo_t*> m_added;
+        std::vector<const PRLEFReader::LEFCellInfo_t*> m_removed;
+        std::vector<changedCell_t> m_changed;
+        size_t m_unchanged = 0;
+
+        bool identical() const
+        {
+            return m_added.empty() && m_removed.empty() && m_changed.empty();
+        }
+    };
+
+    /** compare the parsed cells of two libraries */
+    static result_t compare(const PRLEFReader &oldLib, const PRLEFReader &newLib);
+
+    /** hash of everything compare() looks at */
+    static uint64_t hashCell(const PRLEFReader &lib, const PRLEFReader::LEFCellInfo_t &cell);
+
+    /** write the result as text, one line per cell:
+        '+' for added, '-' for removed and '~' for changed
+        cells, followed by what changed. */
+    static void write(std::ostream &os, const result_t &result);
+
+protected:
+    /** hashCell() with the hashes of the layer names of the library */
+    static uint64_t hashCell(const PRLEFReader &lib, const std::vector<uint64_t> &layers,
+        const PRLEFReader::LEFCellInfo_t &cell);
+
+    /** find the changes between two cells with different hashes */
+    static uint32_t changes(const PRLEFReader &oldLib, const PRLEFReader::LEFCellInfo_t &oldCell,
+        const PRLEFReader &newLib, const PRLEFReader::LEFCellInfo_t &newCell);
+};
+
+#endif
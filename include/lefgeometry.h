@@ -0,0 +1,168 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef lefgeometry_h
+#define lefgeometry_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class StringPool;
+
+/** The pin and obstruction rectangles of a LEF library.
+
+    The rectangles of all macros are stored column-wise in a
+    single block of memory: the layer id and the lower left and
+    upper right corners in integer database units, relative to
+    the macro origin. A pin refers to a contiguous range of
+    rectangles. Layer and pin names are views of interned
+    strings and must outlive the geometry.
+*/
+class LEFGeometry
+{
+public:
+    LEFGeometry() : m_size(0), m_capacity(0) {}
+
+    LEFGeometry(const LEFGeometry &) = delete;
+    LEFGeometry& operator=(const LEFGeometry &) = delete;
+
+    struct pin_t
+    {
+        std::string_view    m_name;         ///< pin name, including the bus index
+        uint32_t            m_firstRect;
+        uint32_t            m_rectCount;
+    };
+
+    /** get the id of a layer, adding it when it is new */
+    uint16_t layerId(std::string_view layerName);
+
+    /** name of a layer id */
+    std::string_view layerName(uint16_t id) const
+    {
+        return m_layerNames.at(id);
+    }
+
+    size_t layerCount() const
+    {
+        return m_layerNames.size();
+    }
+
+    /** add a rectangle, the corners may be given in any order.
+        Returns false if a coordinate does not fit in 32 bits. */
+    bool addRect(uint16_t layer, int64_t x1, int64_t y1, int64_t x2, int64_t y2);
+
+    /** number of rectangles */
+    uint32_t rectCount() const
+    {
+        return m_size;
+    }
+
+    /** the columns, valid until the next rectangle is added */
+    const uint16_t* layers() const { return layerColumn(); }
+    const int32_t*  x1() const { return column(0); }
+    const int32_t*  y1() const { return column(1); }
+    const int32_t*  x2() const { return column(2); }
+    const int32_t*  y2() const { return column(3); }
+
+    /** add a pin without rectangles, returns its index */
+    uint32_t addPin(std::string_view pinName)
+    {
+        m_pins.push_back({pinName, m_size, 0});
+        return static_cast<uint32_t>(m_pins.size() - 1);
+    }
+
+    pin_t& pin(uint32_t index)
+    {
+        return m_pins[index];
+    }
+
+    const pin_t& pin(uint32_t index) const
+    {
+        return m_pins[index];
+    }
+
+    uint32_t pinCount() const
+    {
+        return static_cast<uint32_t>(m_pins.size());
+    }
+
+    /** where the data of another geometry ended up after append() */
+    struct offsets_t
+    {
+        uint32_t    m_rects;
+        uint32_t    m_pins;
+    };
+
+    /** add all rectangles and pins of another geometry.
+        Its layer and pin names are interned in 'strings'. */
+    offsets_t append(const LEFGeometry &other, StringPool &strings);
+
+    /** make room for a number of rectangles in total */
+    void reserve(uint32_t rects)
+    {
+        if (rects > m_capacity)
+        {
+            reallocate(rects);
+        }
+    }
+
+    /** release the memory reserved for rectangles
+        and pins that have not been added. */
+    void shrinkToFit()
+    {
+        reallocate(m_size);
+        m_pins.shrink_to_fit();
+    }
+
+    /** bytes reserved for rectangles and pins */
+    size_t bytesReserved() const
+    {
+        return m_capacity * c_bytesPerRect + m_pins.capacity() * sizeof(pin_t);
+    }
+
+protected:
+    static constexpr size_t c_bytesPerRect = 4*sizeof(int32_t) + sizeof(uint16_t);
+
+    int32_t* column(uint32_t index) const
+    {
+        return reinterpret_cast<int32_t*>(m_block.get() + 4*index*static_cast<size_t>(m_capacity));
+    }
+
+    uint16_t* layerColumn() const
+    {
+        return reinterpret_cast<uint16_t*>(m_block.get() + 16*static_cast<size_t>(m_capacity));
+    }
+
+    void reallocate(uint32_t capacity);
+
+    std::unique_ptr<char[]> m_block;    ///< x1, y1, x2, y2 and layer columns of m_capacity entries each
+    uint32_t                m_size;
+    uint32_t                m_capacity;
+
+    std::vector<pin_t>      m_pins;
+
+    std::vector<std::string_view>                   m_layerNames;
+    std::unordered_map<std::string_view, uint16_t>  m_layerIds;
+};
+
+#endif
@@ -0,0 +1,298 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef lefgrammar_h
+#define lefgrammar_h
+
+#include <stdint.h>
+#include <array>
+#include <utility>
+#include <string_view>
+
+#include "keywords.h"
+#include "lefreader.h"
+
+/** The simple statements of the LEF subset padring reads,
+    as a table that is checked at compile time.
+
+    A statement is a keyword followed by a pattern of arguments,
+    usually ending in a semicolon. LEFReader::parseStatement()
+    matches the pattern and passes the numbers and text it
+    collected to the action of the statement, which calls the
+    callback. Statements that contain other statements, like
+    MACRO, PIN and OBS, are parsed by LEFReader itself.
+
+    To read a new statement, add an entry to c_statements.
+*/
+namespace LEFGrammar
+{
+
+enum element_t : uint8_t
+{
+    EL_END = 0,         ///< end of the pattern
+    EL_NUMBER,          ///< a number
+    EL_NUMBER_DBU,      ///< a number, also converted to database units
+    EL_SKIP_NUMBER,     ///< a number that is not used
+    EL_WORD,            ///< an identifier, which becomes the text
+    EL_WORDS,           ///< one or more identifiers, each followed by a space in the text
+    EL_ANY_WORDS,       ///< like EL_WORDS, but zero identifiers are allowed
+    EL_SKIP_WORD,       ///< an identifier that is not used
+    EL_LITERAL,         ///< the identifier given as literal
+    EL_APPEND_LITERAL,  ///< like EL_LITERAL, appended to the text after a space
+    EL_SKIP_TO_SEMICOL, ///< anything up to and including a semicolon on the same line
+    EL_SEMICOL,         ///< a semicolon
+    EL_EOL,             ///< the end of the line
+    EL_OPTIONAL,        ///< the elements up to the matching EL_OPTIONAL_END are optional
+    EL_OPTIONAL_END
+};
+
+struct arg_t
+{
+    constexpr arg_t(element_t type = EL_END, std::string_view literal = {})
+        : m_type(type), m_literal(literal) {}
+
+    element_t           m_type;
+    std::string_view    m_literal;  ///< text of EL_LITERAL and EL_APPEND_LITERAL
+};
+
+/** where a statement may appear */
+enum context_t : uint8_t
+{
+    CTX_MACRO,      ///< inside MACRO
+    CTX_PIN,        ///< inside PIN
+    CTX_GEOMETRY,   ///< inside PORT and OBS
+    CTX_LAYER,      ///< inside a technology LAYER
+    CTX_UNITS,      ///< inside UNITS
+    CTX_COUNT
+};
+
+/** what a statement has collected for its action */
+struct values_t
+{
+    std::string_view    m_text;     ///< EL_WORD and EL_WORDS text
+    double              m_number[4] = {};
+    int64_t             m_dbu[4] = {};  ///< EL_NUMBER_DBU in database units
+    bool                m_hasDBU;   ///< true if the database units are known
+};
+
+using action_t = void (*)(LEFReader &reader, const values_t &values);
+
+inline constexpr size_t c_maxArgs = 10;
+
+struct statement_t
+{
+    context_t   m_context;
+    keyword_t   m_keyword;
+    uint32_t    m_callbacks;    ///< callback group of the action, 0 if always called
+    std::array<arg_t, c_maxArgs> m_args;
+    action_t    m_action;       ///< only called when the callback group is wanted
+};
+
+inline constexpr statement_t c_statements[] =
+{
+    // MACRO
+    {CTX_MACRO, KW_CLASS, LEFReader::CB_CLASS, {EL_WORDS, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onClass(v.m_text); }},
+    {CTX_MACRO, KW_ORIGIN, 0, {EL_NUMBER, EL_NUMBER, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onOrigin(v.m_number[0], v.m_number[1]); }},
+    {CTX_MACRO, KW_FOREIGN, LEFReader::CB_FOREIGN,
+        {EL_WORD, EL_OPTIONAL, EL_NUMBER, EL_NUMBER,
+            EL_OPTIONAL, EL_SKIP_WORD, EL_OPTIONAL_END, EL_OPTIONAL_END, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onForeign(v.m_text, v.m_number[0], v.m_number[1]); }},
+    {CTX_MACRO, KW_SIZE, 0, {EL_NUMBER, arg_t(EL_LITERAL, "BY"), EL_NUMBER, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onSize(v.m_number[0], v.m_number[1]); }},
+    {CTX_MACRO, KW_SYMMETRY, LEFReader::CB_SYMMETRY, {EL_ANY_WORDS, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onSymmetry(v.m_text); }},
+    {CTX_MACRO, KW_SITE, LEFReader::CB_SITE, {EL_WORD, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onSite(v.m_text); }},
+
+    // PIN
+    {CTX_PIN, KW_DIRECTION, LEFReader::CB_PINDIRECTION,
+        {EL_WORD, EL_OPTIONAL, arg_t(EL_APPEND_LITERAL, "TRISTATE"), EL_OPTIONAL_END, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onPinDirection(v.m_text); }},
+    {CTX_PIN, KW_USE, LEFReader::CB_PINUSE, {EL_WORD, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onPinUse(v.m_text); }},
+
+    // PORT and OBS
+    {CTX_GEOMETRY, KW_LAYER, LEFReader::CB_GEOMETRY, {EL_WORD, EL_SKIP_TO_SEMICOL},
+        [](LEFReader &r, const values_t &v) { r.onGeometryLayer(v.m_text); }},
+    {CTX_GEOMETRY, KW_RECT, LEFReader::CB_GEOMETRY,
+        {EL_OPTIONAL, arg_t(EL_LITERAL, "MASK"), EL_SKIP_NUMBER, EL_OPTIONAL_END,
+            EL_NUMBER_DBU, EL_NUMBER_DBU, EL_NUMBER_DBU, EL_NUMBER_DBU, EL_SEMICOL},
+        [](LEFReader &r, const values_t &v)
+        {
+            r.onRect(v.m_number[0], v.m_number[1], v.m_number[2], v.m_number[3]);
+            if (v.m_hasDBU)
+            {
+                r.onRectDBU(v.m_dbu[0], v.m_dbu[1], v.m_dbu[2], v.m_dbu[3]);
+            }
+        }},
+
+    // technology LAYER
+    {CTX_LAYER, KW_TYPE, LEFReader::CB_LAYER, {EL_WORD, EL_SEMICOL, EL_EOL},
+        [](LEFReader &r, const values_t &v) { r.onLayerType(v.m_text); }},
+    {CTX_LAYER, KW_DIRECTION, LEFReader::CB_LAYER, {EL_WORD, EL_SEMICOL, EL_EOL},
+        [](LEFReader &r, const values_t &v) { r.onLayerDirection(v.m_text); }},
+    {CTX_LAYER, KW_PITCH, LEFReader::CB_LAYER, {EL_NUMBER, EL_SEMICOL, EL_EOL},
+        [](LEFReader &r, const values_t &v) { r.onLayerPitch(v.m_number[0]); }},
+    {CTX_LAYER, KW_OFFSET, LEFReader::CB_LAYER, {EL_NUMBER, EL_SEMICOL, EL_EOL},
+        [](LEFReader &r, const values_t &v) { r.onLayerOffset(v.m_number[0]); }},
+    {CTX_LAYER, KW_WIDTH, LEFReader::CB_LAYER, {EL_NUMBER, EL_SEMICOL, EL_EOL},
+        [](LEFReader &r, const values_t &v) { r.onLayerWidth(v.m_number[0]); }},
+    {CTX_LAYER, KW_MAXWIDTH, LEFReader::CB_LAYER, {EL_NUMBER, EL_SEMICOL, EL_EOL},
+        [](LEFReader &r, const values_t &v) { r.onLayerMaxWidth(v.m_number[0]); }},
+
+    // UNITS
+    {CTX_UNITS, KW_DATABASE, 0, {arg_t(EL_LITERAL, "MICRONS"), EL_NUMBER, EL_SEMICOL, EL_EOL},
+        [](LEFReader &r, const values_t &v)
+        {
+            r.setDatabaseUnits(v.m_number[0]);
+            r.onDatabaseUnitsMicrons(v.m_number[0]);
+        }}
+};
+
+inline constexpr size_t c_statementCount = sizeof(c_statements) / sizeof(c_statements[0]);
+
+/** index of the EL_OPTIONAL_END that closes the EL_OPTIONAL at 'begin' */
+constexpr size_t optionalEnd(const statement_t &statement, size_t begin)
+{
+    int depth = 0;
+    for(size_t i=begin; i<c_maxArgs; i++)
+    {
+        depth += (statement.m_args[i].m_type == EL_OPTIONAL) ? 1 : 0;
+        depth -= (statement.m_args[i].m_type == EL_OPTIONAL_END) ? 1 : 0;
+        if (depth == 0)
+        {
+            return i;
+        }
+    }
+    return c_maxArgs;
+}
+
+/** index in values_t of the number at 'element' */
+constexpr size_t numberIndex(const statement_t &statement, size_t element)
+{
+    size_t index = 0;
+    for(size_t i=0; i<element; i++)
+    {
+        const element_t type = statement.m_args[i].m_type;
+        index += ((type == EL_NUMBER) || (type == EL_NUMBER_DBU)) ? 1 : 0;
+    }
+    return index;
+}
+
+/** true if the statement passes text to its action */
+constexpr bool hasText(const statement_t &statement)
+{
+    for(auto const &arg : statement.m_args)
+    {
+        const element_t type = arg.m_type;
+        if ((type == EL_WORD) || (type == EL_WORDS) || (type == EL_ANY_WORDS) || (type == EL_APPEND_LITERAL))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** statement index + 1 of each keyword in each context, 0 if none */
+using dispatch_t = std::array<std::array<uint8_t, KW_COUNT>, CTX_COUNT>;
+
+/** check that the patterns are well formed */
+constexpr bool isValid(const statement_t &statement)
+{
+    int depth = 0;
+    uint32_t numbers = 0;
+    element_t last = EL_END;
+    size_t count = 0;
+    for(auto const &arg : statement.m_args)
+    {
+        if (arg.m_type == EL_END)
+        {
+            break;
+        }
+        count++;
+
+        switch(arg.m_type)
+        {
+        case EL_OPTIONAL:
+            depth++;
+            break;
+        case EL_OPTIONAL_END:
+            depth--;
+            break;
+        case EL_NUMBER:
+        case EL_NUMBER_DBU:
+            numbers++;
+            break;
+        case EL_LITERAL:
+        case EL_APPEND_LITERAL:
+            if (arg.m_literal.empty())
+            {
+                return false;
+            }
+            break;
+        default:
+            ;
+        }
+
+        if (depth < 0)
+        {
+            return false;
+        }
+        last = arg.m_type;
+    }
+
+    // a pattern must not end in an optional part or a
+    // list of words: the token after it would be lost.
+    return (depth == 0) && (numbers <= 4) && (count < c_maxArgs) && (last != EL_END) &&
+        (last != EL_OPTIONAL_END) && (last != EL_WORDS) && (last != EL_ANY_WORDS);
+}
+
+constexpr dispatch_t makeDispatch()
+{
+    dispatch_t dispatch{};
+    for(size_t i=0; i<c_statementCount; i++)
+    {
+        auto const &statement = c_statements[i];
+        auto &slot = dispatch[statement.m_context][statement.m_keyword];
+        if ((slot != 0) || !isValid(statement))
+        {
+            return dispatch_t{};
+        }
+        slot = static_cast<uint8_t>(i + 1);
+    }
+    return dispatch;
+}
+
+inline constexpr dispatch_t c_dispatch = makeDispatch();
+
+static_assert(c_dispatch[CTX_MACRO][KW_SIZE] != 0,
+    "a LEF statement is defined twice or has a malformed pattern");
+
+/** the statement of a keyword in a context, or nullptr */
+inline const statement_t* find(context_t context, keyword_t keyword)
+{
+    const uint8_t index = c_dispatch[context][keyword];
+    return (index == 0) ? nullptr : &c_statements[index - 1];
+}
+
+} // namespace
+
+#endif
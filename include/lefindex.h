@@ -0,0 +1,117 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+#ifndef lefindex_h
+#define lefindex_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "lefscanner.h"
+#include "mappedfile.h"
+#include "padlib.h"
+
+/** Sidecar index of a LEF file (.pidx file).
+
+    The index holds the sections that LEFScanner finds in a
+    LEF file: the name, byte range and line number of each
+    MACRO and of the header sections such as UNITS. With it,
+    a LEF file can be mapped and its macros parsed on demand
+    without reading the rest of the file.
+
+    Like the PadLib cache, the index records the size,
+    modification time and content hash of the LEF file and
+    is only used while they match. For a compressed LEF file
+    the offsets refer to the decompressed data.
+
+    The file is written in native byte order next to the
+    LEF file; it is not a portable exchange format.
+*/
+class LEFIndex
+{
+public:
+    /** the index file name for a LEF file */
+    static std::string indexFileName(const std::string &lefFile)
+    {
+        return lefFile + ".pidx";
+    }
+
+    /** read the index of a LEF file whose (decompressed) data is
+        'bytes' long. 'state' holds the size and modification time
+        of the LEF file before it was read into 'stored', as it is
+        stored; 'stored' is only hashed when the modification time
+        differs from the indexed one. Returns false if the index is
+        missing, damaged or out of date with respect to the LEF file. */
+    bool read(const std::string &lefFile, const PadLib::fileState_t &state,
+        const MappedFile &stored, size_t bytes);
+
+    /** the sections of the index. The names point into the
+        index file and are valid while this object exists. */
+    const std::vector<LEFScanner::section_t>& sections() const
+    {
+        return m_sections;
+    }
+
+    /** write the index of a LEF file, given the state of the
+        file before it was read and the sections found by
+        LEFScanner in its 'bytes' long (decompressed) data. */
+    static bool write(const std::string &lefFile, const PadLib::fileState_t &state,
+        size_t bytes, const std::vector<LEFScanner::section_t> &sections);
+
+protected:
+    static constexpr uint32_t c_version   = 2;
+    static constexpr uint32_t c_byteOrder = 0x01020304;
+
+    struct header_t
+    {
+        char        m_magic[8];         ///< "PADIDX" followed by two zeros
+        uint32_t    m_version;
+        uint32_t    m_byteOrder;        ///< c_byteOrder in the writer's byte order
+        uint32_t    m_sectionCount;
+        uint32_t    m_reserved;
+        uint64_t    m_lefSize;          ///< size of the LEF file on disk
+        int64_t     m_lefMtime;         ///< modification time in file clock ticks
+        uint64_t    m_lefHash;          ///< PadLib::hash of the LEF file as stored
+        uint64_t    m_dataBytes;        ///< size of the (decompressed) LEF data
+        uint64_t    m_stringBytes;      ///< size of the string table
+    };
+
+    /** a string in the string table */
+    struct string_t
+    {
+        uint32_t    m_offset;
+        uint32_t    m_length;
+    };
+
+    struct sectionRecord_t
+    {
+        uint32_t    m_type;             ///< LEFScanner::sectionType_t
+        uint32_t    m_line;
+        uint64_t    m_begin;
+        uint64_t    m_end;
+        string_t    m_name;
+        string_t    m_class;
+    };
+
+    MappedFile                          m_file;
+    std::vector<LEFScanner::section_t>  m_sections;
+};
+
+#endif
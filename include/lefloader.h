@@ -0,0 +1,158 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef lefloader_h
+#define lefloader_h
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "padlib.h"
+#include "prlefreader.h"
+
+class Prefetcher;
+
+/** Loads a list of LEF files into a cell database.
+
+    Files are loaded in list order: a cell defined in a later
+    file replaces the one from an earlier file. With more than
+    one job, the files are parsed concurrently into separate
+    readers and merged in list order, which gives the same cells
+    and messages as loading them one after the other.
+
+    Large files are additionally split at MACRO boundaries
+    so a single file can be parsed by several threads.
+
+    Uncompressed files are mapped, compressed files are
+    decompressed in chunks while they are parsed.
+
+    When a cache file is set, the cells are taken from it if it
+    is up to date. Otherwise the LEF files are parsed and the
+    cache is rebuilt; it records a hash of the stored file
+    contents that were actually parsed.
+
+    In lazy mode the files are only indexed, see
+    PRLEFReader::indexFile(). The cache is not used then.
+    Optionally, the sections of each file are kept in a
+    sidecar index, see LEFIndex, so later runs do not have
+    to scan the files.
+
+    With a Prefetcher, the files are taken from it as soon
+    as each one has been read.
+*/
+class LEFLoader
+{
+public:
+    LEFLoader(PRLEFReader &database) : m_db(database), m_jobs(0),
+        m_splitSize(1024*1024), m_lazy(false), m_useIndex(false), m_prefetcher(nullptr) {}
+
+    virtual ~LEFLoader() {}
+
+    /** set the number of parser threads.
+        0 uses all hardware threads, 1 loads serially. */
+    void setJobs(uint32_t jobs)
+    {
+        m_jobs = jobs;
+    }
+
+    /** files larger than this number of bytes are split
+        into several parts when loading in parallel.
+        0 disables splitting. */
+    void setSplitSize(size_t bytes)
+    {
+        m_splitSize = bytes;
+    }
+
+    /** use a .padlib cache file, see PadLib */
+    void setCacheFile(const std::string &filename)
+    {
+        m_cacheFile = filename;
+    }
+
+    /** only parse the macros that are asked for */
+    void setLazy(bool lazy)
+    {
+        m_lazy = lazy;
+    }
+
+    /** in lazy mode, read and write a .pidx sidecar
+        index for each LEF file */
+    void setUseIndex(bool useIndex)
+    {
+        m_useIndex = useIndex;
+    }
+
+    /** read the files through a prefetcher that has been
+        started on them, nullptr opens them directly */
+    void setPrefetcher(Prefetcher *prefetcher)
+    {
+        m_prefetcher = prefetcher;
+    }
+
+    /** load the LEF files, returns false if a file
+        could not be read. */
+    bool load(const std::vector<std::string> &filenames);
+
+protected:
+    /** a part of a LEF file that can be parsed on its own */
+    struct range_t
+    {
+        size_t      m_begin;    ///< offset of the first byte
+        size_t      m_end;      ///< offset past the last byte
+        uint32_t    m_line;     ///< line number at m_begin
+    };
+
+    /** split LEF data into ranges at MACRO statements */
+    std::vector<range_t> splitFile(const char *data, size_t bytes, uint32_t jobs) const;
+
+    /** get the UNITS DATABASE MICRONS that precede the
+        first MACRO of LEF data, 0 if there are none */
+    static double findDatabaseUnits(const char *data, size_t bytes);
+
+    bool loadSerial(const std::vector<std::string> &filenames);
+    bool loadLazy(const std::vector<std::string> &filenames);
+
+    /** open a file as it is stored, through the prefetcher if
+        there is one. If 'state' is not nullptr, it receives the
+        size and modification time of the file before it was
+        read and the hash of the stored contents. */
+    bool readFile(const std::string &filename, MappedFile &file, PadLib::fileState_t *state);
+
+    /** index the macros of a file in lazy mode. 'stored' holds
+        the file as it is stored and 'state' its size and
+        modification time before it was read; the hash is only
+        taken when the index is rewritten. returns false if the
+        file cannot be decompressed. */
+    bool indexFile(const std::string &filename, std::unique_ptr<MappedFile> stored,
+        PadLib::fileState_t state);
+    bool loadParallel(const std::vector<std::string> &filenames, uint32_t jobs);
+
+    PRLEFReader &m_db;
+    uint32_t     m_jobs;
+    size_t       m_splitSize;
+    std::string  m_cacheFile;
+    bool         m_lazy;
+    bool         m_useIndex;
+    Prefetcher  *m_prefetcher;
+    std::vector<PadLib::fileState_t> m_states;  ///< state of each parsed file, for the cache
+};
+
+#endif
@@ -23,10 +23,19 @@
 #include<list>
 #include<vector>
 #include<string>
+#include<string_view>
 #include<iostream>
 #include<regex>
 
 #include "linereader.h"
+#include "numberparser.h"
+
+namespace LEFGrammar
+{
+    struct arg_t;
+    struct statement_t;
+    struct values_t;
+};
 
 /** reads a blif stream and generates callbacks for every relevant
     item, such as .input .output etc.
@@ -34,7 +43,8 @@
 class LEFReader
 {
 public:
-    LEFReader() {}
+    LEFReader() : m_begin(nullptr), m_ptr(nullptr), m_end(nullptr), m_is(nullptr),
+        m_lineNum(0), m_errorCount(0), m_callbacks(CB_ALL), m_databaseUnits(0.0) {}
 
     virtual ~LEFReader() {}
 
@@ -55,46 +65,125 @@ public:
         TOK_ERR
     };
 
+    /** parse LEF data from a stream. The stream is read in
+        fixed-size chunks. */
     void parse(std::istream &leffile);
 
+    /** parse LEF data held in memory. The buffer must remain
+        valid until parse returns. firstLine is the line number
+        of the first character, used in error messages.
+    */
+    void parse(const char *data, size_t bytes, uint32_t firstLine = 1);
+
+    /** memory-map a LEF file and parse it without copying.
+        gzip and zstd compressed files are decompressed in
+        chunks while parsing.
+        Returns false if the file cannot be opened or decoded.
+    */
+    bool parseFile(const std::string &filename);
+
+    /** parse the contents of a LEF file as they are stored.
+        gzip and zstd compressed data is decompressed in
+        chunks while parsing, see parseFile().
+        Returns false if the data cannot be decoded.
+    */
+    bool parseFileData(const char *data, size_t bytes);
+
+    /** set the database units used for the *DBU callbacks
+        before parsing data that has no UNITS section itself,
+        e.g. a cell LEF that follows a technology LEF. */
+    void setDatabaseUnits(double unitsPerMicron)
+    {
+        m_databaseUnits = unitsPerMicron;
+    }
+
+    /** number of errors found since this reader was created.
+        After an error the parser skips to the next top-level
+        statement, so every error is counted once. */
+    uint32_t errorCount() const
+    {
+        return m_errorCount;
+    }
+
+    /** callback groups. A subclass declares the groups it handles
+        with setCallbacks; the text of the other groups is skipped
+        without being copied or converted. */
+    enum callback_t : uint32_t
+    {
+        CB_MACRO        = 1 << 0,   ///< onMacro
+        CB_CLASS        = 1 << 1,   ///< onClass
+        CB_FOREIGN      = 1 << 2,   ///< onForeign
+        CB_SYMMETRY     = 1 << 3,   ///< onSymmetry
+        CB_SITE         = 1 << 4,   ///< onSite
+        CB_PIN          = 1 << 5,   ///< onPin
+        CB_PINDIRECTION = 1 << 6,   ///< onPinDirection
+        CB_PINUSE       = 1 << 7,   ///< onPinUse
+        CB_GEOMETRY     = 1 << 8,   ///< onObstruction, onGeometryLayer, onRect, onRectDBU
+        CB_LAYER        = 1 << 9,   ///< onLayer and the other onLayer* callbacks
+        CB_ALL          = 0xFFFFFFFF
+    };
+
+    /* The text callbacks get string_views that are only valid
+       during the call. LEFStringReader provides callbacks
+       taking std::string instead.
+
+       onOrigin, onSize, onEndParse and
+       onDatabaseUnitsMicrons are always called.
+    */
+
     /** callback for each LEF macro */
-    virtual void onMacro(const std::string &macroName) {}
+    virtual void onMacro(std::string_view macroName) {}
 
     /** callback for CLASS within a macro */
-    virtual void onClass(const std::string &className) {}
+    virtual void onClass(std::string_view className) {}
 
     /** callback for ORIGIN within a macro */
     virtual void onOrigin(double x, double y) {}
 
-    /** callback for ORIGIN within a macro */
-    virtual void onForeign(const std::string &foreignName, double x, double y) {}
+    /** callback for FOREIGN within a macro */
+    virtual void onForeign(std::string_view foreignName, double x, double y) {}
 
     /** callback for SIZE within a macro */
     virtual void onSize(double sx, double sy) {}
 
     /** callback for SYMMETRY within a macro */
-    virtual void onSymmetry(const std::string &symmetry) {}
+    virtual void onSymmetry(std::string_view symmetry) {}
 
     /** callback for SITE within a macro */
-    virtual void onSite(const std::string &site) {}
+    virtual void onSite(std::string_view site) {}
 
     /** callback for PIN within a macro */
-    virtual void onPin(const std::string &pinName) {}
+    virtual void onPin(std::string_view pinName) {}
 
     /** callback for PIN direction */
-    virtual void onPinDirection(const std::string &direction) {}
+    virtual void onPinDirection(std::string_view direction) {}
 
     /** callback for PIN use */
-    virtual void onPinUse(const std::string &use) {}
+    virtual void onPinUse(std::string_view use) {}
+
+    /** callback for OBS within a macro. The geometry that
+        follows, up to the END of the OBS, is an obstruction. */
+    virtual void onObstruction() {}
+
+    /** callback for LAYER within a PORT or OBS */
+    virtual void onGeometryLayer(std::string_view layerName) {}
+
+    /** callback for RECT within a PORT or OBS, in microns */
+    virtual void onRect(double x1, double y1, double x2, double y2) {}
+
+    /** callback for RECT within a PORT or OBS in integer
+        database units. Only called when the database units
+        are known, after onRect. */
+    virtual void onRectDBU(int64_t x1, int64_t y1, int64_t x2, int64_t y2) {}
 
     /** callback when done parsing */
     virtual void onEndParse() {}
 
     /** callback for layer */
-    virtual void onLayer(const std::string &layerName) {}
+    virtual void onLayer(std::string_view layerName) {}
 
     /** callback for layer type */
-    virtual void onLayerType(const std::string &layerType) {}
+    virtual void onLayerType(std::string_view layerType) {}
 
     /** callback for layer pitch */
     virtual void onLayerPitch(double pitch) {}
@@ -103,7 +192,7 @@ public:
     virtual void onLayerOffset(double offset) {}
 
     /** callback for layer routing direction */
-    virtual void onLayerDirection(const std::string &direction) {}
+    virtual void onLayerDirection(std::string_view direction) {}
 
     /** callback for layer trace width */
     virtual void onLayerWidth(double width) {}
@@ -115,54 +204,153 @@ public:
     virtual void onDatabaseUnitsMicrons(double unitsPerMicron) {}
 
 protected:
+    /** select the callback groups, a combination of callback_t
+        values. All groups are called by default. */
+    void setCallbacks(uint32_t callbacks)
+    {
+        m_callbacks = callbacks;
+    }
+
+    /** true if the callbacks of the group are wanted */
+    bool wants(callback_t group) const
+    {
+        return (m_callbacks & group) != 0;
+    }
+
     bool isWhitespace(char c) const;
     bool isAlpha(char c) const;
     bool isDigit(char c) const;
     bool isAlphaNumeric(char c) const;
 
+    /** parse the arguments of a statement from the LEFGrammar
+        table, its keyword has been read. Calls the action of the
+        statement if its callbacks are wanted. */
+    bool parseStatement(const LEFGrammar::statement_t &statement);
+
+    /** the parser of statement I of the LEFGrammar table */
+    template<size_t I> bool parseStatement();
+
+    /** parse the arguments of statement I from element E on */
+    template<size_t I, size_t E> bool parseElements(LEFGrammar::values_t &values, bool wanted);
+
+    /** true if the current token can start the element */
+    bool matches(const LEFGrammar::arg_t &arg) const;
+
+    /** report a statement with an unexpected token, returns false */
+    bool statementError(const LEFGrammar::statement_t &statement, const std::string &expected);
+
     bool parseMacro();
-    bool parseClass();
-    bool parseOrigin();
-    bool parseForeign();
-    bool parseSize();
-    bool parseSymmetry();
-    bool parseSite();
     bool parsePin();
     bool parsePinName(std::string &outName);
-    bool parseDirection();
-    bool parseUse();
 
     bool parsePort();
-    bool parsePortLayer();
-    bool parsePortLayerItem();
-    bool parseRect();
+    bool parseObs();
+    bool parseGeometry();
 
     bool parseLayer();
     bool parseLayerItem();
-    bool parseLayerType();
-    bool parseLayerPitch();
-    bool parseLayerWidth();
-    bool parseLayerMaxWidth();
-    bool parseLayerDirection();
-    bool parseLayerOffset();
 
     bool parseVia();
     bool parseViaRule();
 
+    /** after a parse error: skip to the start of the next line that
+        begins a top-level statement (MACRO, LAYER, VIA, VIARULE, UNITS
+        or PROPERTYDEFINITIONS), or to the end of the input. */
+    void resync();
+
+    /** true if only whitespace precedes m_ptr on the current line */
+    bool atLineStart() const;
+
+    /** true if the line [begin, end) begins a top-level statement */
+    static bool isStatementStart(const char *begin, const char *end);
+
+    /** make [m_ptr, limit) hold complete lines only, reading more
+        input if there are none. At the end of the input, the final
+        unterminated line is included. returns false if no input is left. */
+    bool completeLines(const char *&limit);
+
+    /** skip the raw input up to and including 'END <name>' without
+        tokenizing it, keeping the line count up to date.
+        returns false if the end of the input was reached first. */
+    bool skipToEnd(const std::string &name);
+
+    /** number of lines in [begin, end), counted the way the tokenizer does */
+    static size_t countLines(const char *begin, const char *end);
+
     bool parseUnits();
 
     bool parsePropertyDefintions();
 
+    /** get the next token. tokstr points into the input buffer and
+        is only valid until the next call to tokenize. */
+    token_t tokenize(std::string_view &tokstr);
+
+    /** get the next token and copy its text into tokstr */
     token_t tokenize(std::string &tokstr);
-    char         m_tokchar;
+
+    /** return the current character without consuming it, or -1
+        at the end of the input. 'keep' is the start of the token
+        being scanned; it is moved along when the stream buffer
+        is refilled. */
+    int peekChar(const char *&keep)
+    {
+        if ((m_ptr == m_end) && !fillBuffer(keep))
+        {
+            return -1;
+        }
+        return static_cast<unsigned char>(*m_ptr);
+    }
+
+    /** read the next chunk from the input stream into m_chunk,
+        retaining everything from 'keep' onwards.
+        returns false when no more data is available. */
+    bool fillBuffer(const char *&keep);
+
+    /** true if all input has been consumed */
+    bool atEOF()
+    {
+        const char *keep = m_end;
+        return (peekChar(keep) < 0);
+    }
+
+    /** parse loop shared by all input modes */
+    void doParse();
+
+    /** scan a number token from 'start', which is its minus
+        sign or first digit, and collect its value if it is a
+        fixed-point number. */
+    token_t scanNumber(const char *&start, std::string_view &tokstr);
 
     LEFReader::token_t m_curtok;
-    std::string        m_tokstr;
+    std::string_view   m_tokstr;
+
+    NumberParser::fixed_t m_tokFixed;       ///< value of the last number token
+    bool                  m_tokIsFixed = false; ///< m_tokFixed is valid
 
     void error(const std::string &errstr);
 
-    std::istream *m_is;
+    /** convert the current token to a number,
+        reports an error if it is not valid. */
+    bool tokenToNumber(double &value);
+
+    /** convert the current token to a number and, when the
+        database units are known, to database units. */
+    bool tokenToNumber(double &value, int64_t &dbu);
+
+    const char   *m_begin;      ///< start of the buffered input
+    const char   *m_ptr;        ///< current read position
+    const char   *m_end;        ///< end of the buffered input
+    std::istream *m_is;         ///< input stream or nullptr when parsing from memory
+    std::vector<char> m_chunk;  ///< stream read buffer
+
+    static constexpr size_t c_chunkSize = 64*1024;  ///< stream read size in bytes
     uint32_t      m_lineNum;
+    uint32_t      m_errorCount;     ///< number of errors, see errorCount()
+    uint32_t      m_callbacks;      ///< wanted callback groups, see callback_t
+    std::string   m_text;           ///< reused copy of the text passed to a callback
+
+    static constexpr uint32_t c_maxReportedErrors = 100;    ///< errors logged before going quiet
+    double        m_databaseUnits;  ///< UNITS DATABASE MICRONS, 0 if not known
 };
 
 
@@ -0,0 +1,66 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef lefscanner_h
+#define lefscanner_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+#include <vector>
+
+/** Finds the top-level sections of a LEF file without
+    tokenizing it. The scan is line based: a section starts
+    with its keyword as the first word on a line and ends
+    at the line starting with 'END <name>'.
+*/
+class LEFScanner
+{
+public:
+    enum sectionType_t
+    {
+        SEC_MACRO,
+        SEC_UNITS,
+        SEC_LAYER,
+        SEC_VIA,
+        SEC_VIARULE,
+        SEC_SITE,
+        SEC_PROPERTYDEFINITIONS
+    };
+
+    struct section_t
+    {
+        sectionType_t       m_type;
+        std::string_view    m_name;     ///< name, points into the scanned buffer
+        size_t              m_begin;    ///< offset of the first character of the section
+        size_t              m_end;      ///< offset just past the END line
+        uint32_t            m_line;     ///< line number of the first line
+        std::string_view    m_class;    ///< MACRO only: the words following CLASS
+    };
+
+    /** scan a LEF buffer and return its sections in file order.
+        Unterminated sections are not reported. With headerOnly,
+        the scan stops at the first MACRO.
+
+        Line numbers count each CR and LF, like LEFReader does.
+    */
+    static std::vector<section_t> scan(const char *data, size_t bytes, bool headerOnly = false);
+};
+
+#endif
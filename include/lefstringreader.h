@@ -0,0 +1,139 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef lefstringreader_h
+#define lefstringreader_h
+
+#include <string>
+#include <string_view>
+#include "lefreader.h"
+
+/** LEFReader with the std::string callbacks of earlier
+    versions. Each text callback copies its argument and
+    forwards it to the std::string version. Derive from
+    LEFReader directly to avoid the copies.
+
+    An override of a std::string callback hides the
+    std::string_view version of the same name, which
+    -Woverloaded-virtual reports. A subclass brings it
+    back with a using-declaration for each callback it
+    overrides, e.g. 'using LEFStringReader::onMacro;'.
+*/
+class LEFStringReader : public LEFReader
+{
+public:
+    /** callback for each LEF macro */
+    virtual void onMacro(const std::string &macroName) {}
+
+    /** callback for CLASS within a macro */
+    virtual void onClass(const std::string &className) {}
+
+    /** callback for FOREIGN within a macro */
+    virtual void onForeign(const std::string &foreignName, double x, double y) {}
+
+    /** callback for SYMMETRY within a macro */
+    virtual void onSymmetry(const std::string &symmetry) {}
+
+    /** callback for SITE within a macro */
+    virtual void onSite(const std::string &site) {}
+
+    /** callback for PIN within a macro */
+    virtual void onPin(const std::string &pinName) {}
+
+    /** callback for PIN direction */
+    virtual void onPinDirection(const std::string &direction) {}
+
+    /** callback for PIN use */
+    virtual void onPinUse(const std::string &use) {}
+
+    /** callback for LAYER within a PORT or OBS */
+    virtual void onGeometryLayer(const std::string &layerName) {}
+
+    /** callback for layer */
+    virtual void onLayer(const std::string &layerName) {}
+
+    /** callback for layer type */
+    virtual void onLayerType(const std::string &layerType) {}
+
+    /** callback for layer routing direction */
+    virtual void onLayerDirection(const std::string &direction) {}
+
+protected:
+    void onMacro(std::string_view macroName) override
+    {
+        onMacro(std::string(macroName));
+    }
+
+    void onClass(std::string_view className) override
+    {
+        onClass(std::string(className));
+    }
+
+    void onForeign(std::string_view foreignName, double x, double y) override
+    {
+        onForeign(std::string(foreignName), x, y);
+    }
+
+    void onSymmetry(std::string_view symmetry) override
+    {
+        onSymmetry(std::string(symmetry));
+    }
+
+    void onSite(std::string_view site) override
+    {
+        onSite(std::string(site));
+    }
+
+    void onPin(std::string_view pinName) override
+    {
+        onPin(std::string(pinName));
+    }
+
+    void onPinDirection(std::string_view direction) override
+    {
+        onPinDirection(std::string(direction));
+    }
+
+    void onPinUse(std::string_view use) override
+    {
+        onPinUse(std::string(use));
+    }
+
+    void onGeometryLayer(std::string_view layerName) override
+    {
+        onGeometryLayer(std::string(layerName));
+    }
+
+    void onLayer(std::string_view layerName) override
+    {
+        onLayer(std::string(layerName));
+    }
+
+    void onLayerType(std::string_view layerType) override
+    {
+        onLayerType(std::string(layerType));
+    }
+
+    void onLayerDirection(std::string_view direction) override
+    {
+        onLayerDirection(std::string(direction));
+    }
+};
+
+#endif
@@ -0,0 +1,154 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef librarymanager_h
+#define librarymanager_h
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "prlefreader.h"
+
+/** Holds several cell libraries, for instance the same pad
+    library for different process corners or revisions, in
+    a single cell database.
+
+    All libraries live in one store: a PRLEFReader whose
+    arena, string pool and geometry they share. A cell that
+    is identical in several libraries, including its pins and
+    obstructions, is stored once and shared by all of them,
+    so the memory of similar libraries grows with their
+    differences. Each library only adds a map from the cell
+    names to its records.
+
+    One library is active at a time: its cells are the m_cells
+    of the store, so everything that uses the store, like
+    PadringDB, sees the active library. Shared records must not
+    be changed through m_cells; use editCell(), which copies a
+    record before it is changed.
+
+    Memory is not released when a library is replaced, it is
+    freed with the store.
+*/
+class LibraryManager
+{
+public:
+    /** the store should not hold cells of its own, they
+        are hidden while a library is active. */
+    LibraryManager(PRLEFReader &store) : m_store(store) {}
+
+    virtual ~LibraryManager() {}
+
+    /** load LEF files as a library, replacing a library
+        of the same name. Returns false if a file cannot be
+        read; the library is then not changed. */
+    bool load(const std::string &library, const std::vector<std::string> &filenames,
+        uint32_t jobs = 0);
+
+    /** add the cells of a reader as a library, replacing a
+        library of the same name. The reader is not changed,
+        indexed cells that were not parsed are not added. */
+    void add(const std::string &library, const PRLEFReader &reader);
+
+    /** make a library the active one.
+        Returns false if the library is unknown. */
+    bool activate(const std::string &library);
+
+    /** name of the active library, empty if none is active */
+    const std::string& active() const
+    {
+        return m_active;
+    }
+
+    /** names of all libraries, sorted */
+    std::vector<std::string> libraries() const;
+
+    /** get a cell of the active library for changing it. A
+        record that is shared with other libraries is copied
+        first. The geometry ranges stay shared, the geometry
+        itself cannot be changed. Returns nullptr if the
+        cell is unknown. */
+    PRLEFReader::LEFCellInfo_t* editCell(std::string_view name);
+
+    /** number of cell records in the store */
+    size_t recordCount() const
+    {
+        return m_refs.size();
+    }
+
+    /** number of cells of a library that are shared
+        with at least one other library */
+    size_t sharedCellCount(const std::string &library) const;
+
+protected:
+    using cellMap_t = std::unordered_map<std::string_view, PRLEFReader::LEFCellInfo_t*>;
+
+    struct library_t
+    {
+        cellMap_t   m_cells;
+        double      m_databaseUnits = 0.0;
+    };
+
+    /** the cell map of a library, which is in the
+        store while the library is active */
+    cellMap_t& cellsOf(const std::string &library);
+    const cellMap_t& cellsOf(const std::string &library) const;
+
+    /** find a record of the store that is equal to a cell of
+        another reader, or copy the cell into the store */
+    PRLEFReader::LEFCellInfo_t* share(const PRLEFReader &reader,
+        const PRLEFReader::LEFCellInfo_t &cell);
+
+    /** check whether a record of the store equals a cell of another reader */
+    bool isEqual(const PRLEFReader::LEFCellInfo_t &record, const PRLEFReader &reader,
+        const PRLEFReader::LEFCellInfo_t &cell) const;
+
+    /** copy a cell of another reader, with its geometry, into the store */
+    PRLEFReader::LEFCellInfo_t* copy(const PRLEFReader &reader,
+        const PRLEFReader::LEFCellInfo_t &cell);
+
+    /** release a library's references to its records */
+    void release(const cellMap_t &cells);
+
+    /** a record of the store */
+    struct record_t
+    {
+        uint32_t    m_refs;             ///< number of libraries using the record
+        double      m_databaseUnits;    ///< units of its geometry
+    };
+
+    PRLEFReader &m_store;
+    std::string m_active;
+    cellMap_t   m_storeCells;   ///< cells the store held before a library became active
+
+    std::unordered_map<std::string, library_t> m_libraries;
+
+    /** the records of each cell name, one per distinct definition */
+    std::unordered_map<std::string_view, std::vector<PRLEFReader::LEFCellInfo_t*> > m_versions;
+
+    std::unordered_map<const PRLEFReader::LEFCellInfo_t*, record_t> m_refs;
+
+    /** store layer id of each layer of the reader being added */
+    std::vector<uint16_t> m_layerMap;
+};
+
+#endif
@@ -21,6 +21,7 @@
 #define logging_h
 
 #include <string>
+#include <vector>
 
 typedef enum {LOG_VERBOSE = 1, LOG_DEBUG = 2, LOG_INFO = 3, LOG_WARN = 4, 
     LOG_ERROR = 8, LOG_QUIET = 255} logtype_t;
@@ -34,4 +35,51 @@ void doLog(uint32_t t, const std::string &txt);
 /** set the log level ... */
 void setLogLevel(uint32_t level);
 
+/** Records doLog output of a single thread instead of
+    printing it, so that work done on several threads can
+    be reported later in a deterministic order.
+*/
+class LogCapture
+{
+public:
+    LogCapture() : m_previous(nullptr) {}
+
+    /** start capturing the calling thread's log output */
+    void start();
+
+    /** stop capturing on the calling thread */
+    void stop();
+
+    /** number of captured messages */
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    /** emit captured messages [first, last) through doLog */
+    void replay(size_t first, size_t last) const;
+
+    /** emit all captured messages through doLog */
+    void replay() const
+    {
+        replay(0, m_entries.size());
+    }
+
+    /** record a message, called by doLog */
+    void add(uint32_t t, const std::string &txt)
+    {
+        m_entries.push_back({t, txt});
+    }
+
+protected:
+    struct entry_t
+    {
+        uint32_t    m_level;
+        std::string m_text;
+    };
+
+    std::vector<entry_t> m_entries;
+    LogCapture          *m_previous;    ///< capture that was active before start()
+};
+
 #endif
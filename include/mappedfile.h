@@ -0,0 +1,89 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef mappedfile_h
+#define mappedfile_h
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** a read-only view of a whole file.
+    On POSIX systems the file is memory-mapped, elsewhere
+    (or when mmap fails) its contents are read into memory.
+*/
+class MappedFile
+{
+public:
+    MappedFile() : m_data(nullptr), m_size(0), m_open(false), m_mapped(false) {}
+
+    virtual ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /** map a file into memory. returns false if the file
+        cannot be opened. */
+    bool open(const std::string &filename);
+
+    /** like open, but a gzip or zstd compressed file is
+        decompressed into memory. */
+    bool openDecompressed(const std::string &filename);
+
+    /** take over file contents that were read elsewhere */
+    void assign(std::vector<char> &&contents);
+
+    /** take over 'bytes' bytes of file contents that were read elsewhere */
+    void assign(std::unique_ptr<char[]> contents, size_t bytes);
+
+    /** release the mapping */
+    void close();
+
+    /** true if a file is mapped */
+    bool isOpen() const
+    {
+        return m_open;
+    }
+
+    /** first byte of the file contents */
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    /** size of the file in bytes */
+    size_t size() const
+    {
+        return m_size;
+    }
+
+protected:
+    const char          *m_data;    ///< start of file contents
+    size_t               m_size;    ///< size in bytes
+    bool                 m_open;    ///< true if a file is open
+    bool                 m_mapped;  ///< true if m_data is an mmap'd region
+    std::vector<char>    m_copy;    ///< file contents when mmap is not available
+    std::unique_ptr<char[]> m_buffer;   ///< file contents handed over by assign()
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef numberparser_h
+#define numberparser_h
+
+#include <stdint.h>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string_view>
+
+/** Locale-independent number parsing without allocations
+    or exceptions, used by the LEF and config readers.
+*/
+namespace NumberParser
+{
+
+/** a number of the form [-]digits[.digits] */
+struct fixed_t
+{
+    int64_t  m_mantissa;    ///< all digits, without the dot
+    uint32_t m_fracDigits;  ///< digits after the dot
+    bool     m_negative;
+};
+
+/** the powers of ten that are exact doubles */
+constexpr double c_pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+    1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+/** split a number of the form [-]digits[.digits] with at most
+    18 digits into its mantissa and fraction digits.
+    returns false for all other text, including exponents. */
+inline bool toFixed(std::string_view txt, fixed_t &fixed)
+{
+    size_t pos = 0;
+    fixed.m_negative = (pos < txt.size()) && (txt[pos] == '-');
+    pos += fixed.m_negative ? 1 : 0;
+
+    int64_t mantissa = 0;
+    uint32_t digits = 0;
+    uint32_t fracDigits = 0;
+    bool seenDot = false;
+    for(; pos < txt.size(); pos++)
+    {
+        const char c = txt[pos];
+        if ((c >= '0') && (c <= '9'))
+        {
+            if (++digits > 18)
+            {
+                return false;
+            }
+            mantissa = mantissa*10 + (c - '0');
+            fracDigits += seenDot ? 1 : 0;
+        }
+        else if ((c == '.') && !seenDot)
+        {
+            seenDot = true;
+        }
+        else
+        {
+            return false;   // exponent or garbage
+        }
+    }
+
+    fixed.m_mantissa   = mantissa;
+    fixed.m_fracDigits = fracDigits;
+    return (digits > 0);
+}
+
+/** the value of a fixed-point number. returns false if it cannot
+    be computed exactly: a mantissa below 2^53 and a power of ten are
+    both exact doubles, so their quotient is correctly rounded, which
+    is the value std::from_chars returns. */
+inline bool fixedToDouble(const fixed_t &fixed, double &value)
+{
+    if (fixed.m_mantissa >= (int64_t(1) << 53))
+    {
+        return false;
+    }
+    value = static_cast<double>(fixed.m_mantissa) / c_pow10[fixed.m_fracDigits];
+    value = fixed.m_negative ? -value : value;
+    return true;
+}
+
+/** a fixed-point number in microns in integer database units,
+    rounded half away from zero. returns false if unitsPerMicron
+    is not an integer or the result does not fit. */
+inline bool fixedToDBU(const fixed_t &fixed, double unitsPerMicron, int64_t &dbu)
+{
+    const int64_t units = static_cast<int64_t>(unitsPerMicron);
+    if ((units <= 0) || (static_cast<double>(units) != unitsPerMicron) ||
+        (fixed.m_mantissa > std::numeric_limits<int64_t>::max() / units))
+    {
+        return false;
+    }
+
+    // mantissa * units / 10^fracDigits
+    const int64_t scaled  = fixed.m_mantissa * units;
+    const int64_t divisor = static_cast<int64_t>(c_pow10[fixed.m_fracDigits]);
+    const int64_t value   = (scaled + divisor/2) / divisor;
+    dbu = fixed.m_negative ? -value : value;
+    return true;
+}
+
+/** parse a complete decimal number.
+    returns false if the text is not a number. */
+inline bool toDouble(std::string_view txt, double &value)
+{
+    // most LEF and config numbers are short fixed-point numbers,
+    // which are converted without std::from_chars.
+    fixed_t fixed;
+    if (toFixed(txt, fixed) && fixedToDouble(fixed, value))
+    {
+        return true;
+    }
+
+    const char *first = txt.data();
+    const char *last  = txt.data() + txt.size();
+    auto result = std::from_chars(first, last, value);
+    return (result.ec == std::errc()) && (result.ptr == last);
+}
+
+/** parse a decimal number in microns and convert it to integer
+    database units. Numbers with at most 18 significant digits are
+    scaled exactly when unitsPerMicron is an integer, so '149.54'
+    at 1000 units per micron is 149540 and not 149539.99999.
+    Other numbers are converted through a double and rounded.
+    returns false if the text is not a number. */
+inline bool toDBU(std::string_view txt, double unitsPerMicron, int64_t &dbu)
+{
+    fixed_t fixed;
+    if (toFixed(txt, fixed) && fixedToDBU(fixed, unitsPerMicron, dbu))
+    {
+        return true;
+    }
+
+    double value;
+    if (!toDouble(txt, value))
+    {
+        return false;
+    }
+    dbu = std::llround(value * unitsPerMicron);
+    return true;
+}
+
+/** the value of a fixed-point number and, if unitsPerMicron is
+    positive, the number in database units as toDBU computes them.
+    returns false if the value is not exact; the text must then be
+    parsed with toDouble and toDBU. */
+inline bool fixedToNumber(const fixed_t &fixed, double unitsPerMicron, double &value, int64_t &dbu)
+{
+    if (!fixedToDouble(fixed, value))
+    {
+        return false;
+    }
+
+    if ((unitsPerMicron > 0.0) && !fixedToDBU(fixed, unitsPerMicron, dbu))
+    {
+        dbu = std::llround(value * unitsPerMicron);
+    }
+    return true;
+}
+
+/** parse a decimal number as toDouble and, if unitsPerMicron is
+    positive, also convert it to database units as toDBU, reading
+    the text only once. returns false if the text is not a number. */
+inline bool toNumber(std::string_view txt, double unitsPerMicron, double &value, int64_t &dbu)
+{
+    fixed_t fixed;
+    if (toFixed(txt, fixed) && fixedToNumber(fixed, unitsPerMicron, value, dbu))
+    {
+        return true;
+    }
+
+    return toDouble(txt, value) &&
+        ((unitsPerMicron <= 0.0) || toDBU(txt, unitsPerMicron, dbu));
+}
+
+} // namespace
+
+#endif
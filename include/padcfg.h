@@ -0,0 +1,125 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef padcfg_h
+#define padcfg_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <iostream>
+#include <string>
+
+class ConfigReader;
+
+/** Compiled (binary) form of a padring configuration file (.padcfg).
+
+    The file holds the statements of a configuration in their
+    original order, so loading it delivers the same callbacks
+    to a ConfigReader as parsing the text, without tokenizing.
+    Cell names, locations and other repeated names are stored
+    once in a string table; instance names are stored with
+    their pad so they can be handed out without copying.
+
+    Like the .padlib cache, the file is written in native byte
+    order; it is not a portable exchange format. Use decompile()
+    to turn it back into text.
+*/
+class PadCfg
+{
+public:
+    /** compile a text configuration, with its INCLUDEs spliced in.
+        returns false and logs the errors if the text cannot be
+        parsed. the file name is used like in ConfigReader::parse. */
+    static bool compile(const char *text, size_t bytes, std::string &compiled,
+        const std::string &fileName = "");
+
+    /** compile a text configuration file into a .padcfg file */
+    static bool compileFile(const std::string &configFile, const std::string &compiledFile);
+
+    /** write a compiled configuration as text */
+    static bool decompile(const char *data, size_t bytes, std::ostream &os);
+
+    /** write a .padcfg file as a text configuration file */
+    static bool decompileFile(const std::string &compiledFile, const std::string &configFile);
+
+    /** true if the data starts like a compiled configuration */
+    static bool isCompiled(const char *data, size_t bytes);
+
+    /** deliver the statements of a compiled configuration
+        to the callbacks of a reader */
+    static bool read(const char *data, size_t bytes, ConfigReader &reader);
+
+protected:
+    static constexpr uint32_t c_version   = 2;
+    static constexpr uint32_t c_byteOrder = 0x01020304;
+
+    struct header_t
+    {
+        char        m_magic[8];         ///< "PADCFG" followed by two zeros
+        uint32_t    m_version;
+        uint32_t    m_byteOrder;        ///< c_byteOrder in the writer's byte order
+        uint32_t    m_stringCount;
+        uint32_t    m_statementCount;
+        uint64_t    m_stringBytes;      ///< size of the string table
+        uint64_t    m_statementBytes;   ///< size of the statements
+        uint64_t    m_checksum;         ///< PadLib::hash of everything after the header
+    };
+
+    /** a string in the string table */
+    struct string_t
+    {
+        uint32_t    m_offset;
+        uint32_t    m_length;
+    };
+
+    /** the statements follow the string table, each one is
+        a statement_t byte and its arguments, unaligned:
+
+        DESIGN  : string id
+        AREA    : width, height (double)
+        GRID    : grid (double)
+        CORNER  : instance, location, cell (string ids)
+        PAD     : flags (uint8), location (uint8, index into "NESW"),
+                  cell (string id), instance (uint16 length and text),
+                  and for a bus range: first (uint32), stride (int32)
+                  and count (uint32).
+        SPACE   : space (double)
+        OFFSET  : offset (double)
+        FILLER  : prefix (string id)
+    */
+    enum statement_t : uint8_t
+    {
+        ST_DESIGN = 1,
+        ST_AREA,
+        ST_GRID,
+        ST_CORNER,
+        ST_PAD,
+        ST_SPACE,
+        ST_OFFSET,
+        ST_FILLER
+    };
+
+    static constexpr uint8_t c_padFlip = 1;
+    static constexpr uint8_t c_padBus  = 2;
+
+    class Compiler;
+    class TextWriter;
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef padlib_h
+#define padlib_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "prlefreader.h"
+
+/** Binary cache of a PRLEFReader cell table (.padlib file).
+
+    The cache stores the cells, their pin and obstruction
+    geometry and the database units obtained from a list of LEF
+    files, together with the size, modification time and content
+    hash of each file.
+
+    A cache is used only when it was built from the same
+    list of files. A file whose size differs is always stale.
+    A file with a different modification time is hashed and
+    is still accepted when its contents are unchanged. The
+    hash is taken over the file as it is stored, so a
+    compressed file does not have to be decompressed.
+
+    The contents of the cache are protected by a checksum,
+    and the cache is written under a temporary name that
+    is unique to the writer, so concurrent runs sharing a
+    cache never read or replace a half-written file.
+
+    The file is written in native byte order and is meant
+    to be memory-mapped; it is not a portable exchange format.
+*/
+class PadLib
+{
+public:
+    /** load the cells from a cache file into the database.
+        Returns false, without touching the database, if the
+        cache is missing, damaged or out of date with respect
+        to the given LEF files. */
+    static bool read(const std::string &cacheFile,
+        const std::vector<std::string> &lefFiles, PRLEFReader &db);
+
+    /** the state of a LEF file when it was parsed */
+    struct fileState_t
+    {
+        uint64_t    m_size;     ///< size of the file on disk
+        int64_t     m_mtime;    ///< modification time in file clock ticks
+        uint64_t    m_hash;     ///< hash of the stored contents
+    };
+
+    /** write the cells of the database to a cache file.
+        'states' holds the state of each LEF file, taken
+        before it was read, see fileStatus() and hash(). */
+    static bool write(const std::string &cacheFile,
+        const std::vector<std::string> &lefFiles,
+        const std::vector<fileState_t> &states, const PRLEFReader &db);
+
+    /** 64-bit content hash used to detect changed LEF files */
+    static uint64_t hash(const char *data, size_t bytes);
+
+    /** get the size and modification time of a file */
+    static bool fileStatus(const std::string &filename, uint64_t &size, int64_t &mtime);
+
+    /** a name for a temporary file next to 'filename' that
+        no other process or thread uses */
+    static std::string tempFileName(const std::string &filename);
+
+    /** check a file against a recorded size, modification time
+        and content hash. The file is only hashed when its size
+        matches and its modification time does not. */
+    static bool isUnchanged(const std::string &filename, uint64_t size, int64_t mtime, uint64_t contentHash);
+
+protected:
+    static constexpr uint32_t c_version   = 7;
+    static constexpr uint32_t c_byteOrder = 0x01020304;
+
+    struct header_t
+    {
+        char        m_magic[8];         ///< "PADLIB" followed by two zeros
+        uint32_t    m_version;
+        uint32_t    m_byteOrder;        ///< c_byteOrder in the writer's byte order
+        uint32_t    m_fileCount;
+        uint32_t    m_cellCount;
+        uint32_t    m_layerCount;
+        uint32_t    m_pinCount;
+        uint32_t    m_rectCount;
+        uint32_t    m_reserved;
+        uint64_t    m_stringBytes;      ///< size of the string table
+        double      m_databaseUnits;
+        uint64_t    m_checksum;         ///< hash() of everything after the header
+    };
+
+    /** a string in the string table */
+    struct string_t
+    {
+        uint32_t    m_offset;
+        uint32_t    m_length;
+    };
+
+    struct fileRecord_t
+    {
+        string_t    m_name;
+        uint64_t    m_size;
+        int64_t     m_mtime;    ///< modification time in file clock ticks
+        uint64_t    m_hash;
+    };
+
+    struct cellRecord_t
+    {
+        string_t    m_name;
+        string_t    m_foreign;
+        string_t    m_symmetry;
+        string_t    m_class;
+        double      m_sx;
+        double      m_sy;
+        uint32_t    m_flags;
+        uint32_t    m_reserved;
+        uint32_t    m_firstPin;
+        uint32_t    m_pinCount;
+        uint32_t    m_firstObs;
+        uint32_t    m_obsCount;
+    };
+
+    struct pinRecord_t
+    {
+        string_t    m_name;
+        uint32_t    m_firstRect;
+        uint32_t    m_rectCount;
+    };
+
+    /** the rectangles are stored as x1, y1, x2, y2 and layer
+        columns, like in LEFGeometry */
+    static constexpr size_t c_bytesPerRect = 4*sizeof(int32_t) + sizeof(uint16_t);
+
+    static constexpr uint32_t c_flagFiller   = 1;
+    static constexpr uint32_t c_flagHasClass = 2;
+    static constexpr uint32_t c_flagHasForeign = 4;
+
+    /** check a cached file record against the file on disk */
+    static bool isCurrent(const std::string &filename, const fileRecord_t &record);
+};
+
+#endif
@@ -20,6 +20,11 @@
 #ifndef padringdb_h
 #define padringdb_h
 
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
 #include "configreader.h"
 #include "prlefreader.h"
 #include "layout.h"
@@ -33,6 +38,8 @@ public:
         m_south(Layout::DIR_HORIZONTAL),
         m_east(Layout::DIR_VERTICAL),
         m_west(Layout::DIR_VERTICAL),
+        m_dieHeight(0.0),
+        m_dieWidth(0.0),
         m_grid(1.0) 
     {
         m_south.setEdgePos(0.0);
@@ -40,107 +47,53 @@ public:
         m_designName = "PADRING";
     }
 
-    /** callback for a corner */
-    virtual void onCorner(
-        const std::string &instance,
-        const std::string &location,
-        const std::string &cellname) override
+    virtual ~PadringDB()
     {
-        PRLEFReader::LEFCellInfo_t *cell = m_lefreader.getCellByName(cellname);
-        if (cell == nullptr)
-        {
-            doLog(LOG_ERROR,"Cannot find cell %s in the LEF database\n", cellname.c_str());
-            return;
-        }
-
-        LayoutItem *item_x = new LayoutItem(LayoutItem::TYPE_CORNER);
-        item_x->m_instance = instance;
-        item_x->m_cellname = cellname;
-        item_x->m_location = location;
-        item_x->m_size = cell->m_sx;
-        item_x->m_lefinfo = cell;
-
-        LayoutItem *item_y = new LayoutItem(LayoutItem::TYPE_CORNER);
-        item_y->m_instance = instance;
-        item_y->m_cellname = cellname;
-        item_y->m_location = location;
-        item_y->m_size = cell->m_sy;
-        item_y->m_lefinfo = cell;
-
-        // Corner cells should be symmetrical
-        // i.e. width = height.
-        if (location == "NE")
-        {
-            // ROT 180
-            m_north.setLastCorner(item_x);
-            m_east.setLastCorner(item_y);
-        }
-        else if (location == "NW")
-        {
-            // ROT 90
-            m_north.setFirstCorner(item_y);
-            m_west.setLastCorner(item_x);
-        }
-        else if (location == "SE")
-        {
-            // ROT 270
-            m_south.setLastCorner(item_y);
-            m_east.setFirstCorner(item_x);            
-        }
-        else if (location == "SW")
+        for(auto const &statement : m_statements)
         {
-            // ROT 0
-            m_south.setFirstCorner(item_x);
-            m_west.setFirstCorner(item_y);
+            delete statement.m_item;
         }
     }
 
-    /** callback for a pad */
-    virtual void onPad(
+    /** callback for a corner. the corner is placed
+        by resolveCells(). */
+    virtual void onCorner(
         const std::string &instance,
         const std::string &location,
-        const std::string &cellname,
-        bool flipped) override
+        const std::string &cellname) override
     {
-        PRLEFReader::LEFCellInfo_t *cell = m_lefreader.getCellByName(cellname);
-        if (cell == nullptr)
-        {
-            doLog(LOG_ERROR,"Cannot find cell %s in the LEF database\n", cellname.c_str());
-            return;
-        }
-
-        LayoutItem *item = new LayoutItem(LayoutItem::TYPE_CELL);
+        LayoutItem *item = new LayoutItem(LayoutItem::TYPE_CORNER);
         item->m_instance = instance;
-        item->m_cellname = cellname;
-        item->m_location = location;
-        item->m_size = cell->m_sx;
-        item->m_lefinfo = cell;
-        item->m_flipped = flipped;
-
-        // Corner cells should be symmetrical
-        // i.e. width = height.
-        if (location == "N")
-        {
-            m_north.addItem(item);
-        }
-        else if (location == "W")
-        {
-            m_west.addItem(item);
-        }
-        else if (location == "S")
-        {
-            m_south.addItem(item);
-        }
-        else if (location == "E")
-        {
-            m_east.addItem(item);
-        }
-        else
+        item->m_location = locationName(location);
+        m_statements.push_back({item, cellId(cellname), m_lineNum});
+    }
+
+    /** callback for a run of pads. the pads are placed
+        by resolveCells(). */
+    virtual void onPads(const padRecord_t *pads, size_t count) override
+    {
+        for(size_t i=0; i<count; i++)
         {
-            doLog(LOG_ERROR, "Incorrect location on PAD %s\n", cellname.c_str());
+            const padRecord_t &pad = pads[i];
+
+            // a bus range stays a single run item until
+            // the layout is written.
+            LayoutItem *item = new LayoutItem(LayoutItem::TYPE_CELL);
+            if (pad.m_count > 1)
+            {
+                item->m_instance  = pad.m_instance;
+                item->m_count     = pad.m_count;
+                item->m_busFirst  = pad.m_busFirst;
+                item->m_busStride = pad.m_busStride;
+            }
+            else
+            {
+                item->m_instance = pad.instanceName(0);
+            }
+            item->m_location = locationName(pad.m_location);
+            item->m_flipped  = pad.m_flipped;
+            m_statements.push_back({item, cellId(pad.m_cellname), pad.m_line});
         }
-
-        m_lastLocation = location;
     }
 
     /** callback for die area in microns */
@@ -175,23 +128,7 @@ public:
     {
         LayoutItem *item = new LayoutItem(LayoutItem::TYPE_FIXEDSPACE);
         item->m_size = space;
-
-        if (m_lastLocation == "N")
-        {
-            m_north.addItem(item);
-        }
-        else if (m_lastLocation == "W")
-        {
-            m_west.addItem(item);
-        }
-        else if (m_lastLocation == "S")
-        {
-            m_south.addItem(item);
-        }
-        else if (m_lastLocation == "E")
-        {
-            m_east.addItem(item);
-        }
+        m_statements.push_back({item, c_noCell, m_lineNum});
     }
 
     /** callback for offset in microns */
@@ -205,6 +142,13 @@ public:
         m_designName = designName;
     }
 
+    /** look up the cells of the CORNER and PAD statements in the
+        LEF database and place them, and the SPACEs, in the order
+        of the configuration. Statements whose cell is missing are
+        dropped and reported together. Returns false if a cell
+        is missing. */
+    bool resolveCells();
+
     void doLayout()
     {
         m_north.doLayout();
@@ -225,9 +169,47 @@ public:
     std::string m_designName;
 
     std::string m_fillerPrefix;
-    std::string m_lastLocation;
 
     PRLEFReader m_lefreader;
+
+protected:
+    static constexpr uint32_t c_noCell = UINT32_MAX;
+
+    /** a CORNER, PAD or SPACE statement waiting for resolveCells() */
+    struct statement_t
+    {
+        LayoutItem  *m_item;    ///< TYPE_CORNER, TYPE_CELL or TYPE_FIXEDSPACE
+        uint32_t    m_cell;     ///< index into m_cellNames, c_noCell for a SPACE
+        uint32_t    m_line;     ///< line in the configuration, 0 if unknown
+    };
+
+    /** handle of a cell name, the same for each use of a cell */
+    uint32_t cellId(std::string_view cellname)
+    {
+        auto iter = m_cellIds.find(cellname);
+        if (iter != m_cellIds.end())
+        {
+            return iter->second;
+        }
+        const uint32_t id = static_cast<uint32_t>(m_cellNames.size());
+        m_cellNames.push_back(m_names.intern(cellname));
+        m_cellIds.emplace(m_cellNames.back(), id);
+        return id;
+    }
+
+    /** a location as a view that outlives the configuration */
+    static std::string_view locationName(std::string_view location);
+
+    void placeCorner(LayoutItem *item);
+    void placePad(LayoutItem *item);
+    void placeSpace(LayoutItem *item);
+
+    std::vector<statement_t>    m_statements;   ///< in configuration order
+    Arena                       m_nameArena;
+    StringPool                  m_names{m_nameArena};
+    std::vector<std::string_view> m_cellNames;  ///< by cell name handle
+    std::unordered_map<std::string_view, uint32_t> m_cellIds;
+    std::string_view            m_lastLocation; ///< location of the last placed pad
 };
 
 #endif
@@ -0,0 +1,149 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+#ifndef prefetcher_h
+#define prefetcher_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class MappedFile;
+class ThreadPool;
+
+/** Reads a set of input files concurrently, so the first file
+    can be parsed while the others are still being read.
+
+    Only compressed files are kept in memory, and only in their
+    compressed form. Uncompressed files are read through a small
+    buffer to bring them into the page cache; they are mapped
+    when they are opened.
+
+    On Linux, all reads are submitted to a single io_uring and
+    completed by a background thread. When io_uring is not available,
+    each file is read with pread on a small thread pool instead.
+*/
+class Prefetcher
+{
+public:
+    Prefetcher();
+
+    /** waits for all outstanding reads */
+    virtual ~Prefetcher();
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    /** start reading the files. Can be called only once.
+        With allowRing false, the pread fallback is used even
+        when io_uring is available. */
+    void start(const std::vector<std::string> &filenames, bool allowRing = true);
+
+    /** wait until a file has been read and hand its contents to
+        'file', decompressing it into memory when necessary. Files
+        that were not prefetched, or could not be read, are opened
+        directly. returns false if the file cannot be read. */
+    bool open(const std::string &filename, MappedFile &file);
+
+    /** like open, but the file is handed over as it is stored:
+        an uncompressed file is mapped, a compressed file is handed
+        over without decompressing it. */
+    bool openRaw(const std::string &filename, MappedFile &file);
+
+    /** the read method: "io_uring", "pread" or "none" */
+    const char* method() const
+    {
+        return m_method;
+    }
+
+    /** milliseconds from start() to the first file handed out by open(),
+        i.e. the moment the first parser could begin. negative if no
+        prefetched file was opened. */
+    double firstFileTime() const;
+
+    /** milliseconds from start() until all files were read */
+    double allFilesTime();
+
+protected:
+    using clock = std::chrono::steady_clock;
+
+    struct file_t
+    {
+        std::string         m_name;
+        std::unique_ptr<char[]> m_data;         ///< the whole file if compressed, else a read buffer
+        size_t              m_capacity = 0;     ///< size of m_data
+        size_t              m_size  = 0;        ///< file size
+        size_t              m_done  = 0;        ///< bytes read so far
+        int                 m_fd    = -1;
+        bool                m_known = false;    ///< the first bytes have been checked for compression
+        bool                m_compressed = false;
+        bool                m_ready = false;    ///< reading has finished
+        bool                m_ok    = false;    ///< the whole file was read
+        bool                m_taken = false;    ///< handed out by open()
+    };
+
+    /** allocate the read buffer of a file once its size is known */
+    static void allocate(file_t &file);
+
+    /** where the next read of a file goes, and its length */
+    static char* readTarget(file_t &file, size_t &bytes);
+
+    /** account for 'bytes' bytes read to readTarget() */
+    static void received(file_t &file, size_t bytes);
+
+    /** mark a file as finished, called with m_mutex unlocked */
+    void finish(file_t &file, bool ok);
+
+    /** read a file with open/fstat/pread */
+    void readFile(file_t &file);
+
+#ifdef __linux__
+    /** set up an io_uring, returns false if the kernel does not support it */
+    bool startRing();
+
+    /** background thread that submits and completes the io_uring reads */
+    void ringLoop();
+
+    class Ring;
+    std::unique_ptr<Ring>       m_ring;
+#endif
+
+    const char                  *m_method;
+    std::vector<file_t>         m_files;
+    std::unordered_map<std::string, size_t> m_index;    ///< filename to m_files index
+    size_t                      m_pending;              ///< files not yet finished
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_cv;
+    std::thread                 m_thread;               ///< io_uring completion thread
+    std::unique_ptr<ThreadPool> m_pool;                 ///< pread fallback
+
+    clock::time_point           m_start;
+    clock::time_point           m_firstFile;
+    clock::time_point           m_allFiles;
+    bool                        m_firstFileSet;
+};
+
+#endif
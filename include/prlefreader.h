@@ -20,57 +20,250 @@
 #ifndef prlefreader_h
 #define prlefreader_h
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
+#include "arena.h"
+#include "lefgeometry.h"
 #include "lefreader.h"
+#include "lefscanner.h"
+#include "mappedfile.h"
 
-/** LEF Reader + cell database */
+class LogCapture;
+
+/** LEF Reader + cell database.
+
+    The cells and their names live in an arena owned by the
+    reader and are freed together with it. Cell pointers stay
+    valid until then, even when a cell is replaced.
+*/
 class PRLEFReader : public LEFReader
 {
 public:
     PRLEFReader();
 
     /** callback for each LEF macro */
-    virtual void onMacro(const std::string &macroName) override;
+    virtual void onMacro(std::string_view macroName) override;
 
     /** callback for CLASS within a macro */
-    virtual void onClass(const std::string &className) override;
+    virtual void onClass(std::string_view className) override;
 
     /** callback for FOREIGN within a macro */
-    virtual void onForeign(const std::string &foreignName, double x, double y) override;
+    virtual void onForeign(std::string_view foreignName, double x, double y) override;
 
     /** callback for SIZE within a macro */
     virtual void onSize(double sx, double sy) override;
 
     /** callback for SYMMETRY within a macro */
-    virtual void onSymmetry(const std::string &symmetry) override;
+    virtual void onSymmetry(std::string_view symmetry) override;
+
+    /** callback for PIN within a macro */
+    virtual void onPin(std::string_view pinName) override;
+
+    /** callback for OBS within a macro */
+    virtual void onObstruction() override;
+
+    /** callback for LAYER within a PORT or OBS */
+    virtual void onGeometryLayer(std::string_view layerName) override;
+
+    /** callback for RECT within a PORT or OBS in database units */
+    virtual void onRectDBU(int64_t x1, int64_t y1, int64_t x2, int64_t y2) override;
 
 
     /** callback for UNITS DATABASE MICRONS */
     virtual void onDatabaseUnitsMicrons(double unitsPerMicron) override;
 
-    void doIntegrityChecks();
+    /** callback at the end of the LEF data */
+    virtual void onEndParse() override;
+
+    /** Do not log cell additions and replacements while parsing.
+        Instead, remember where they happened in the given log
+        capture so merge() can report them later. Used when several
+        readers parse in parallel. */
+    void deferCellLog(const LogCapture *capture)
+    {
+        m_deferredLog = capture;
+    }
+
+    /** Move all cells of another reader into this one, as if
+        its LEF data had been parsed after ours. Cells that already
+        exist are replaced. The log of the other reader is replayed
+        with the cell addition/replacement messages in place.
+    */
+    void merge(PRLEFReader &other, const LogCapture &otherLog);
 
+    /** a cell in the database. The strings are interned
+        in the string pool of the reader, the pins and
+        obstructions are ranges in m_geometry. */
     class LEFCellInfo_t
     {
     public:
-        LEFCellInfo_t() : m_sx(0.0), m_sy(0.0) {}
-
-        std::string     m_name;     ///< LEF cell name
-        std::string     m_foreign;  ///< foreign name
-        double          m_sx;       ///< size in microns
-        double          m_sy;       ///< size in microns
-        std::string     m_symmetry; ///< symmetry string taken from LEF.
-        bool            m_isFiller;
+        LEFCellInfo_t() : m_sx(0.0), m_sy(0.0), m_isFiller(false), m_hasClass(false),
+            m_hasForeign(false), m_firstPin(0), m_pinCount(0), m_firstObs(0), m_obsCount(0) {}
+
+        std::string_view    m_name;     ///< LEF cell name
+        std::string_view    m_foreign;  ///< foreign name, the cell name if there is no FOREIGN
+        double              m_sx;       ///< size in microns
+        double              m_sy;       ///< size in microns
+        std::string_view    m_symmetry; ///< symmetry string taken from LEF.
+        std::string_view    m_class;    ///< the words following CLASS
+        bool                m_isFiller;
+        bool                m_hasClass; ///< a CLASS statement was seen
+        bool                m_hasForeign;   ///< a FOREIGN statement was seen
+        uint32_t            m_firstPin; ///< first pin in m_geometry
+        uint32_t            m_pinCount;
+        uint32_t            m_firstObs; ///< first obstruction rectangle in m_geometry
+        uint32_t            m_obsCount;
     };
 
-    LEFCellInfo_t *getCellByName(const std::string &name) const;
+    /** create an empty cell in the arena of the database.
+        It is not added to the cells. */
+    LEFCellInfo_t *createCell(std::string_view name)
+    {
+        LEFCellInfo_t *cell = m_arena.create<LEFCellInfo_t>();
+        cell->m_name = m_strings.intern(name);
+        return cell;
+    }
+
+    /** get the pooled copy of a string */
+    std::string_view intern(std::string_view str)
+    {
+        return m_strings.intern(str);
+    }
+
+    /** Index the macros of a LEF file without parsing them.
+        The UNITS are read immediately, each macro is parsed
+        when getCellByName() first asks for it. Macros in later
+        files, or parsed later, replace indexed ones.
+        Returns false if the file cannot be read. */
+    bool indexFile(const std::string &filename);
+
+    /** like indexFile(), for a file that is already in memory.
+        The reader keeps the file. */
+    void indexFile(std::unique_ptr<MappedFile> file);
+
+    /** like indexFile(), with sections that were found earlier,
+        see LEFIndex. The offsets are relative to the file data,
+        the names may point anywhere. */
+    void indexFile(std::unique_ptr<MappedFile> file,
+        const std::vector<LEFScanner::section_t> &sections);
+
+    /** parse all indexed macros that can be filler cells:
+        those whose name starts with the prefix or, without
+        a prefix, those with a SPACER class. */
+    void materializeFillers(const std::string &prefix = "");
+
+    /** get a cell, parsing it first if it was only indexed.
+        returns nullptr if the cell is unknown. */
+    LEFCellInfo_t *getCellByName(std::string_view name);
+
+    /** number of parsed and indexed cells */
+    size_t getCellCount() const
+    {
+        return m_cells.size() + m_lazyMacros.size();
+    }
+
+    /** the outcome of checkCells() */
+    struct integrityReport_t
+    {
+        enum issue_t
+        {
+            ISSUE_ZERO_SIZE,
+            ISSUE_NO_FOREIGN,
+            ISSUE_NO_CLASS,
+            ISSUE_OFF_GRID,
+            ISSUE_COUNT
+        };
+
+        size_t  m_checked = 0;                  ///< number of cells checked
+        size_t  m_count[ISSUE_COUNT] = {};      ///< number of cells with each issue
+        std::vector<std::string_view> m_examples[ISSUE_COUNT]; ///< first few cell names, sorted
+    };
+
+    /** Check all parsed cells in one pass over the cell table,
+        using 'jobs' threads (0: all cores): zero sizes, missing
+        FOREIGN and CLASS statements and widths that are not a
+        multiple of the grid. The cells named in 'corners' are
+        placed on both axes, so their height is checked as well.
+        A grid of 0 skips the grid check. Indexed cells are
+        checked once they have been parsed. */
+    integrityReport_t checkCells(double grid, uint32_t jobs = 0,
+        const std::vector<std::string_view> &corners = {}) const;
+
+    /** log the issues found by checkCells() */
+    static void logReport(const integrityReport_t &report);
+
     LEFCellInfo_t *m_parseCell;   ///< current cell being parsed
 
-    std::unordered_map<std::string, LEFCellInfo_t*> m_cells;
+    /** the cells, keyed by their interned name */
+    std::unordered_map<std::string_view, LEFCellInfo_t*> m_cells;
 
     double m_lefDatabaseUnits;      ///< database units in microns
+
+    /** pin and obstruction rectangles of all cells, in database
+        units. Only filled when the LEF units are known. */
+    LEFGeometry m_geometry;
+
+protected:
+    /** log the addition of a cell to the database */
+    void logCellAdded(std::string_view macroName, bool replaced) const;
+
+    /** complete the cell that was parsed last: a cell
+        without FOREIGN is placed under its own name */
+    void finishCell();
+
+    /** point the strings of a cell that was created by
+        another reader to our pooled copies */
+    void reintern(LEFCellInfo_t *cell);
+
+    Arena       m_arena;    ///< holds the cells and the pooled strings
+    StringPool  m_strings;
+
+    /** move the geometry of another reader into ours
+        and rebase the ranges of its cells */
+    void mergeGeometry(PRLEFReader &other);
+
+    /** where the rectangles of the current macro go */
+    enum geometryTarget_t
+    {
+        GEOM_NONE,
+        GEOM_PIN,
+        GEOM_OBS
+    };
+
+    geometryTarget_t    m_geomTarget;
+    uint32_t            m_geomPin;      ///< pin index for GEOM_PIN
+    int32_t             m_geomLayer;    ///< layer id, -1 before the first LAYER
+
+    /** a MACRO that was seen while the cell log was deferred */
+    struct macroEvent_t
+    {
+        std::string_view    m_name;     ///< interned macro name
+        size_t              m_logPos;   ///< number of log messages before the macro
+    };
+
+    const LogCapture            *m_deferredLog;
+    std::vector<macroEvent_t>   m_macroEvents;
+
+    /** parse an indexed macro and add it to the cells */
+    LEFCellInfo_t *materialize(std::string_view macroName);
+
+    /** location of an indexed macro */
+    struct lazyMacro_t
+    {
+        const char  *m_data;    ///< 'MACRO' keyword in a mapped file
+        size_t      m_bytes;    ///< bytes up to and including the END line
+        uint32_t    m_line;     ///< line number of the MACRO keyword
+        bool        m_isFiller; ///< has a SPACER class
+        double      m_databaseUnits;    ///< units in effect where the macro is defined
+    };
+
+    /** indexed macros, keyed by their interned name */
+    std::unordered_map<std::string_view, lazyMacro_t>   m_lazyMacros;
+    std::vector<std::unique_ptr<MappedFile> >           m_lazyFiles;    ///< keeps the indexed data mapped
 };
 
 #endif
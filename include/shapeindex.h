@@ -0,0 +1,254 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+#ifndef shapeindex_h
+#define shapeindex_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "layout.h"
+#include "prlefreader.h"
+
+/** A static spatial index over the placed shapes of a padring:
+    the outline of every LayoutItem and, when the LEF geometry
+    is known, its pin and obstruction rectangles.
+
+    The shapes are added first and build() then packs them into
+    an R-tree: the shapes are sorted along a Hilbert curve and
+    grouped bottom-up into nodes of c_nodeSize entries. The tree
+    cannot be changed after it was built, but it is compact and
+    both box and nearest-neighbour queries visit only a handful
+    of nodes.
+
+    All coordinates are in microns.
+*/
+class ShapeIndex
+{
+public:
+    ShapeIndex() : m_leafNodes(0) {}
+
+    struct box_t
+    {
+        double m_x1, m_y1;  ///< lower left
+        double m_x2, m_y2;  ///< upper right
+
+        /** true if the boxes overlap or touch */
+        bool intersects(const box_t &other) const
+        {
+            return (m_x1 <= other.m_x2) && (other.m_x1 <= m_x2) &&
+                (m_y1 <= other.m_y2) && (other.m_y1 <= m_y2);
+        }
+
+        /** squared distance from a point to the box, 0 inside */
+        double distance2(double x, double y) const
+        {
+            const double dx = std::max({m_x1 - x, 0.0, x - m_x2});
+            const double dy = std::max({m_y1 - y, 0.0, y - m_y2});
+            return dx*dx + dy*dy;
+        }
+
+        /** grow the box to include another */
+        void extend(const box_t &other)
+        {
+            m_x1 = std::min(m_x1, other.m_x1);
+            m_y1 = std::min(m_y1, other.m_y1);
+            m_x2 = std::max(m_x2, other.m_x2);
+            m_y2 = std::max(m_y2, other.m_y2);
+        }
+    };
+
+    enum shapeKind_t : uint8_t
+    {
+        SHAPE_OUTLINE,      ///< the cell boundary, SIZE in the LEF
+        SHAPE_PIN,          ///< a pin rectangle
+        SHAPE_OBS           ///< an obstruction rectangle
+    };
+
+    struct shape_t
+    {
+        box_t       m_box;
+        uint32_t    m_item;     ///< index of the LayoutItem, see item()
+        uint32_t    m_pin;      ///< SHAPE_PIN: pin index in the LEF geometry
+        uint16_t    m_layer;    ///< LEF geometry layer id, not used for outlines
+        shapeKind_t m_kind;
+    };
+
+    /** add a placed item with its outline and, if the LEF geometry
+        of its cell is known, its pin and obstruction rectangles.
+        The item must stay valid while the index is used.
+        Returns the item index. */
+    uint32_t addItem(const LayoutItem *item, const PRLEFReader &db);
+
+    /** add a single shape, m_item must be a valid item index */
+    void addShape(const shape_t &shape)
+    {
+        m_shapes.push_back(shape);
+    }
+
+    /** pack the shapes into the tree. Must be called after
+        the last shape was added and before any query. */
+    void build();
+
+    /** number of shapes */
+    size_t size() const
+    {
+        return m_shapes.size();
+    }
+
+    const shape_t& shape(uint32_t index) const
+    {
+        return m_shapes[index];
+    }
+
+    const LayoutItem* item(uint32_t index) const
+    {
+        return m_items[index];
+    }
+
+    size_t itemCount() const
+    {
+        return m_items.size();
+    }
+
+    /** call func(shape) for every shape that overlaps or touches
+        the box, until it returns false. */
+    template<class Func> void query(const box_t &box, Func func) const
+    {
+        if (m_nodes.empty())
+        {
+            return;
+        }
+
+        uint32_t stack[c_maxDepth * c_nodeSize];
+        uint32_t top = 0;
+        stack[top++] = static_cast<uint32_t>(m_nodes.size() - 1);
+        while(top > 0)
+        {
+            const uint32_t nodeIndex = stack[--top];
+            const node_t &node = m_nodes[nodeIndex];
+            const uint32_t end = node.m_first + node.m_count;
+            if (nodeIndex < m_leafNodes)
+            {
+                for(uint32_t i=node.m_first; i<end; i++)
+                {
+                    if (m_shapes[i].m_box.intersects(box) && !func(m_shapes[i]))
+                    {
+                        return;
+                    }
+                }
+            }
+            else
+            {
+                for(uint32_t i=node.m_first; i<end; i++)
+                {
+                    if (m_nodes[i].m_box.intersects(box))
+                    {
+                        stack[top++] = i;
+                    }
+                }
+            }
+        }
+    }
+
+    /** the indices of at most maxCount shapes, nearest to the point
+        first, that are no further away than maxDistance and for which
+        filter(shape) returns true. */
+    template<class Filter> std::vector<uint32_t> nearest(double x, double y,
+        size_t maxCount, double maxDistance, Filter filter) const
+    {
+        std::vector<uint32_t> result;
+        if (m_nodes.empty() || (maxCount == 0))
+        {
+            return result;
+        }
+
+        // best-first search: nodes and shapes ordered by their
+        // distance, a shape is final when it comes out first.
+        struct entry_t
+        {
+            double      m_distance2;
+            uint32_t    m_index;
+            bool        m_isShape;
+
+            bool operator<(const entry_t &other) const
+            {
+                return m_distance2 > other.m_distance2;
+            }
+        };
+
+        const double maxDistance2 = maxDistance * maxDistance;
+        std::priority_queue<entry_t> queue;
+        queue.push({0.0, static_cast<uint32_t>(m_nodes.size() - 1), false});
+        while(!queue.empty())
+        {
+            const entry_t entry = queue.top();
+            queue.pop();
+            if (entry.m_isShape)
+            {
+                result.push_back(entry.m_index);
+                if (result.size() == maxCount)
+                {
+                    break;
+                }
+                continue;
+            }
+
+            const node_t &node = m_nodes[entry.m_index];
+            const uint32_t end = node.m_first + node.m_count;
+            const bool leaf = (entry.m_index < m_leafNodes);
+            for(uint32_t i=node.m_first; i<end; i++)
+            {
+                const box_t &box = leaf ? m_shapes[i].m_box : m_nodes[i].m_box;
+                const double d2 = box.distance2(x, y);
+                if ((d2 <= maxDistance2) && (!leaf || filter(m_shapes[i])))
+                {
+                    queue.push({d2, i, leaf});
+                }
+            }
+        }
+        return result;
+    }
+
+    /** the pairs of items whose outlines overlap by more
+        than 'tolerance' microns in both directions. Cells that
+        only touch, like abutting pads and fillers, do not. */
+    std::vector<std::pair<uint32_t, uint32_t> > findOverlaps(double tolerance = 1.0e-6) const;
+
+    static constexpr uint32_t c_nodeSize = 16;
+    static constexpr uint32_t c_maxDepth = 16;  ///< enough for 16^8 shapes
+
+protected:
+    struct node_t
+    {
+        box_t       m_box;
+        uint32_t    m_first;    ///< first child node, or first shape for leaf nodes
+        uint32_t    m_count;
+    };
+
+    std::vector<const LayoutItem*>  m_items;
+    std::vector<shape_t>            m_shapes;   ///< in Hilbert order after build()
+    std::vector<node_t>             m_nodes;    ///< leaf nodes first, the root is the last node
+    uint32_t                        m_leafNodes;    ///< nodes [0, m_leafNodes) hold shapes
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#ifndef threadpool_h
+#define threadpool_h
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/** a fixed-size pool of worker threads.
+    Tasks are started in the order they are submitted.
+*/
+class ThreadPool
+{
+public:
+    /** create a pool with 'threads' workers.
+        0 selects one worker per hardware thread. */
+    ThreadPool(uint32_t threads = 0) : m_quit(false)
+    {
+        if (threads == 0)
+        {
+            threads = defaultThreadCount();
+        }
+
+        for(uint32_t i=0; i<threads; i++)
+        {
+            m_workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    /** waits for all submitted tasks to finish */
+    virtual ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_cv.notify_all();
+
+        for(auto &worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    /** queue a task, the returned future becomes ready
+        when it has finished. */
+    std::future<void> submit(std::function<void()> task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<void()> >(std::move(task));
+        auto future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push([packaged]() { (*packaged)(); });
+        }
+        m_cv.notify_one();
+        return future;
+    }
+
+    /** run func(0) .. func(count-1) on the pool and
+        wait until all calls have finished. */
+    void parallelFor(size_t count, const std::function<void(size_t)> &func)
+    {
+        std::vector<std::future<void> > futures;
+        futures.reserve(count);
+        for(size_t i=0; i<count; i++)
+        {
+            futures.push_back(submit([&func, i]() { func(i); }));
+        }
+
+        for(auto &f : futures)
+        {
+            f.get();
+        }
+    }
+
+    /** number of worker threads */
+    size_t size() const
+    {
+        return m_workers.size();
+    }
+
+    /** number of hardware threads, at least 1 */
+    static uint32_t defaultThreadCount()
+    {
+        uint32_t n = std::thread::hardware_concurrency();
+        return (n == 0) ? 1 : n;
+    }
+
+protected:
+    void workerLoop()
+    {
+        while(true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_quit || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                {
+                    return; // m_quit is set and all work is done
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+
+    bool                                m_quit;     ///< set when the pool is destroyed
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cv;
+    std::queue<std::function<void()> >  m_tasks;    ///< tasks waiting for a worker
+    std::vector<std::thread>            m_workers;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include "arena.h"
+
+void* Arena::allocateSlow(size_t bytes, size_t align)
+{
+    // large objects get a block of their own so the
+    // rest of the current block is not wasted.
+    const size_t size = bytes + align;
+    const bool   large = (size > m_blockSize / 4);
+    const size_t blockBytes = large ? size : m_blockSize;
+
+    std::unique_ptr<char[]> block(new char[blockBytes]);
+    char *base = block.get();
+    m_blocks.push_back(std::move(block));
+    m_bytes += blockBytes;
+
+    uintptr_t p = (reinterpret_cast<uintptr_t>(base) + align - 1) & ~(uintptr_t)(align - 1);
+    if (!large)
+    {
+        m_ptr = reinterpret_cast<char*>(p + bytes);
+        m_end = base + blockBytes;
+    }
+    return reinterpret_cast<void*>(p);
+}
+
+void Arena::adopt(Arena &other)
+{
+    for(auto &block : other.m_blocks)
+    {
+        m_blocks.push_back(std::move(block));
+    }
+    m_bytes += other.m_bytes;
+
+    other.m_blocks.clear();
+    other.m_ptr   = nullptr;
+    other.m_end   = nullptr;
+    other.m_bytes = 0;
+}
+
+std::string_view StringPool::intern(std::string_view str)
+{
+    if (str.empty())
+    {
+        return std::string_view();
+    }
+
+    auto iter = m_strings.find(str);
+    if (iter != m_strings.end())
+    {
+        return *iter;
+    }
+
+    char *copy = static_cast<char*>(m_arena.allocate(str.size() + 1, 1));
+    memcpy(copy, str.data(), str.size());
+    copy[str.size()] = 0;
+
+    std::string_view pooled(copy, str.size());
+    m_strings.insert(pooled);
+    return pooled;
+}
+
+void StringPool::merge(const StringPool &other)
+{
+    m_strings.insert(other.m_strings.begin(), other.m_strings.end());
+}
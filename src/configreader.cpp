@@ -19,8 +19,69 @@
 
 #include <sstream>
 #include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <charconv>
+#include <climits>
+#include <iterator>
 #include "logging.h"
+#include "mappedfile.h"
+#include "numberparser.h"
+#include "keywords.h"
 #include "configreader.h"
+#include "padcfg.h"
+
+namespace
+{
+
+/** the included files, compiled to PadCfg statements,
+    by canonical file name */
+std::mutex g_includeMutex;
+std::unordered_map<std::string, std::shared_ptr<const std::string> > g_includeCache;
+
+/** the files this thread is parsing, outermost first */
+thread_local std::vector<std::string> t_includeStack;
+
+std::string canonicalName(const std::string &fileName)
+{
+    std::error_code ec;
+    auto path = std::filesystem::weakly_canonical(fileName, ec);
+    return ec ? fileName : path.string();
+}
+
+} // namespace
+
+/** keeps a file on the include stack while it is parsed */
+class ConfigReader::IncludeGuard
+{
+public:
+    IncludeGuard(const std::string &fileName) : m_pushed(!fileName.empty())
+    {
+        if (m_pushed)
+        {
+            t_includeStack.push_back(canonicalName(fileName));
+        }
+    }
+
+    ~IncludeGuard()
+    {
+        if (m_pushed)
+        {
+            t_includeStack.pop_back();
+        }
+    }
+
+protected:
+    bool m_pushed;
+};
+
+void ConfigReader::clearIncludeCache()
+{
+    std::lock_guard<std::mutex> lock(g_includeMutex);
+    g_includeCache.clear();
+}
 
 bool ConfigReader::isWhitespace(char c) const
 {
@@ -53,153 +114,164 @@ bool ConfigReader::isSpecialIdentChar(char c) const
     if ((c == '[') || (c == ']') ||
         (c == '<') || (c == '>') ||
         (c == '/') || (c == '\\') ||
-        (c == '.'))
+        (c == '.') || (c == ':'))
     {
         return true;
     }
     return false;
 }
 
-ConfigReader::token_t ConfigReader::tokenize(std::string &tokstr)
+ConfigReader::token_t ConfigReader::tokenize(std::string_view &tokstr)
 {
-    tokstr.clear();
+    tokstr = std::string_view();
 
-    while(isWhitespace(m_tokchar) && !m_is->eof())
+    while((m_ptr < m_end) && isWhitespace(*m_ptr))
     {
-        m_tokchar = m_is->get();
+        m_ptr++;
     }
 
-    if (m_is->eof())
+    if (m_ptr >= m_end)
     {
         return TOK_EOF;
     }
 
-    if ((m_tokchar==10) || (m_tokchar==13))
+    const char *start = m_ptr;
+    const char c = *m_ptr++;
+
+    if ((c==10) || (c==13))
     {
-        m_tokchar = m_is->get();
         m_lineNum++;
         return TOK_EOL;
     }
 
-    if (m_tokchar=='#')
+    if (c=='#')
     {
-        m_tokchar = m_is->get();
         return TOK_HASH;
     }
 
-    if (m_tokchar==';')
+    if (c==';')
     {
-        m_tokchar = m_is->get();
         return TOK_SEMICOL;
     }
 
-    if (m_tokchar=='(')
+    if (c=='(')
     {
-        m_tokchar = m_is->get();
         return TOK_LPAREN;
     }
 
-    if (m_tokchar==')')
+    if (c==')')
     {
-        m_tokchar = m_is->get();
         return TOK_RPAREN;
     }
 
-    if (m_tokchar=='[')
+    if (c=='[')
     {
-        m_tokchar = m_is->get();
         return TOK_LBRACKET;
     }
 
-    if (m_tokchar==']')
+    if (c==']')
     {
-        m_tokchar = m_is->get();
         return TOK_RBRACKET;
     }
 
-    if (m_tokchar=='-')
+    if (c=='-')
     {
         // could be the start of a number
-        tokstr = m_tokchar;
-        m_tokchar = m_is->get();
-        if (isDigit(m_tokchar))
+        if ((m_ptr < m_end) && isDigit(*m_ptr))
         {
             // it is indeed a number!
-            while(isDigit(m_tokchar) || (m_tokchar == '.') || (m_tokchar == 'e'))
+            while((m_ptr < m_end) && (isDigit(*m_ptr) || (*m_ptr == '.') || (*m_ptr == 'e')))
             {
-                tokstr += m_tokchar;
-                m_tokchar = m_is->get();
+                m_ptr++;
             }
+            tokstr = std::string_view(start, m_ptr - start);
             return TOK_NUMBER;
         }
+        tokstr = std::string_view(start, 1);
         return TOK_MINUS;
     }
 
-    if (isAlpha(m_tokchar))
+    if (isAlpha(c))
     {
-        tokstr = m_tokchar;
-        m_tokchar = m_is->get();
-        while(isAlphaNumeric(m_tokchar) || isSpecialIdentChar(m_tokchar))
+        while((m_ptr < m_end) && (isAlphaNumeric(*m_ptr) || isSpecialIdentChar(*m_ptr)))
         {
-            tokstr += m_tokchar;
-            m_tokchar = m_is->get();
+            m_ptr++;
         }
+        tokstr = std::string_view(start, m_ptr - start);
         return TOK_IDENT;
     }
 
-    if (m_tokchar=='"')
+    if (c=='"')
     {
-        m_tokchar = m_is->get();
-        while((m_tokchar != '"') && (m_tokchar != 10) && (m_tokchar != 13))
+        // the string contents start after the opening quotes
+        start = m_ptr;
+        while((m_ptr < m_end) && (*m_ptr != '"') && (*m_ptr != 10) && (*m_ptr != 13))
         {
-            tokstr += m_tokchar;
-            m_tokchar = m_is->get();
+            m_ptr++;
         }
+        tokstr = std::string_view(start, m_ptr - start);
 
         // skip closing quotes
-        if (m_tokchar == '"')
+        if ((m_ptr < m_end) && (*m_ptr == '"'))
         {
-            m_tokchar = m_is->get();
+            m_ptr++;
         }
 
         // error on newline
-        if ((m_tokchar == 10) || (m_tokchar == 13))
+        if ((m_ptr < m_end) && ((*m_ptr == 10) || (*m_ptr == 13)))
         {
             // TODO: error, string cannot continue after newline!
         }
         return TOK_STRING;
     }
 
-    if (isDigit(m_tokchar))
+    if (isDigit(c))
     {
-        tokstr = m_tokchar;
-        m_tokchar = m_is->get();
-        while(isDigit(m_tokchar) || (m_tokchar == '.') || (m_tokchar == 'e'))
+        while((m_ptr < m_end) && (isDigit(*m_ptr) || (*m_ptr == '.') || (*m_ptr == 'e')))
         {
-            tokstr += m_tokchar;
-            m_tokchar = m_is->get();
+            m_ptr++;
         }
+        tokstr = std::string_view(start, m_ptr - start);
         return TOK_NUMBER;
     }
 
-    m_tokchar = m_is->get();
     return TOK_ERR;
 }
 
 bool ConfigReader::parse(std::istream &configstream)
 {
-    m_lineNum = 1;
-
     if (!configstream.good())
     {
         doLog(LOG_ERROR,"ConfigReader: input stream is not open\n");
         return false;
     }
 
-    m_is = &configstream;
-    std::string tokstr;
-    m_tokchar = m_is->get();
+    std::string contents{std::istreambuf_iterator<char>(configstream),
+        std::istreambuf_iterator<char>()};
+
+    return parse(contents.data(), contents.size());
+}
+
+bool ConfigReader::parse(const char *data, size_t bytes, const std::string &fileName)
+{
+    m_fileName = fileName;
+    m_lineNum = 0;
+
+    // a compiled configuration is loaded without tokenizing
+    if (PadCfg::isCompiled(data, bytes))
+    {
+        return PadCfg::read(data, bytes, *this);
+    }
+
+    IncludeGuard guard(fileName);
+
+    m_lineNum = 1;
+    m_ptr = data;
+    m_end = data + bytes;
+    m_pads.clear();
+    m_pads.reserve(c_padBatchSize);
 
+    std::string_view tokstr;
     bool m_inComment = false;
 
     ConfigReader::token_t tok = TOK_EOF;
@@ -208,6 +280,7 @@ bool ConfigReader::parse(std::istream &configstream)
         tok = tokenize(tokstr);
         if (!m_inComment)
         {
+            bool ok = true;
             switch(tok)
             {
             case TOK_ERR:
@@ -217,48 +290,62 @@ bool ConfigReader::parse(std::istream &configstream)
                 m_inComment = true;
                 break;
             case TOK_IDENT:
-                if (tokstr == "CORNER")
-                {
-                    if (!parseCorner()) return false;
-                }
-                else if (tokstr == "AREA")
-                {
-                    if (!parseArea()) return false;
-                }
-                else if (tokstr == "PAD")
-                {
-                    if (!parsePad()) return false;
-                }
-                else if (tokstr == "GRID")
-                {
-                    if (!parseGrid()) return false;
-                }
-                else if (tokstr == "SPACE")
-                {
-                    if (!parseSpace()) return false;
-                }
-                else if (tokstr == "FILLER")
+            {
+                const keyword_t keyword = Keywords::lookup(tokstr);
+
+                // keep the callbacks in file order
+                if (keyword != KW_PAD)
                 {
-                    if (!parseFiller()) return false;
+                    flushPads();
                 }
-                else if (tokstr == "OFFSET")
+
+                switch(keyword)
                 {
-                    if (!parseOffset()) return false;
-                }
-                else if (tokstr == "DESIGN")
-                {
-                    if (!parseDesignName()) return false;
-                }
-                else
+                case KW_CORNER:
+                    ok = parseCorner();
+                    break;
+                case KW_AREA:
+                    ok = parseArea();
+                    break;
+                case KW_PAD:
+                    ok = parsePad();
+                    break;
+                case KW_GRID:
+                    ok = parseGrid();
+                    break;
+                case KW_SPACE:
+                    ok = parseSpace();
+                    break;
+                case KW_FILLER:
+                    ok = parseFiller();
+                    break;
+                case KW_OFFSET:
+                    ok = parseOffset();
+                    break;
+                case KW_DESIGN:
+                    ok = parseDesignName();
+                    break;
+                case KW_INCLUDE:
+                    ok = parseInclude();
+                    break;
+                default:
                 {
                     std::stringstream ss;
                     ss << "unrecognized item " << tokstr << "\n";
                     error(ss.str());
                 }
+                }
                 break;
+            }
             default:
                 ;
             }
+
+            if (!ok)
+            {
+                flushPads();
+                return false;
+            }
         }
         else
         {
@@ -269,13 +356,30 @@ bool ConfigReader::parse(std::istream &configstream)
         }
     } while(tok != TOK_EOF);
 
+    flushPads();
     return true;
 }
 
+void ConfigReader::flushPads()
+{
+    if (!m_pads.empty())
+    {
+        onPads(m_pads.data(), m_pads.size());
+        m_pads.clear();
+    }
+}
+
 void ConfigReader::error(const std::string &errstr)
 {
     std::stringstream ss;
-    ss << "Line " << m_lineNum << " : " << errstr;
+    if (m_fileName.empty())
+    {
+        ss << "Line " << m_lineNum << " : " << errstr;
+    }
+    else
+    {
+        ss << m_fileName << " line " << m_lineNum << " : " << errstr;
+    }
     doLog(LOG_ERROR, ss.str());
 }
 
@@ -283,22 +387,30 @@ void ConfigReader::error(const std::string &errstr)
 bool ConfigReader::parsePad()
 {
     // PAD: instance location cellname
-    std::string tokstr;
-    std::string instance;
-    std::string location;
-    std::string cellname;
-    bool flipped = false;
+    std::string_view tokstr;
+    padRecord_t pad;
+    pad.m_flipped = false;
+    pad.m_line = m_lineNum;
+    pad.m_bus = false;
+    pad.m_busFirst = 0;
+    pad.m_busStride = 0;
+    pad.m_count = 1;
 
     // instance name
-    ConfigReader::token_t tok = tokenize(instance);
+    ConfigReader::token_t tok = tokenize(pad.m_instance);
     if (tok != TOK_IDENT)
     {
         error("Expected an instance name\n");
         return false;
     }
 
+    if (!parseBusRange(pad))
+    {
+        return false;
+    }
+
     // location name
-    tok = tokenize(location);
+    tok = tokenize(pad.m_location);
     if (tok != TOK_IDENT)
     {
         error("Expected a location\n");
@@ -306,19 +418,19 @@ bool ConfigReader::parsePad()
     }
 
     // PADs can only be on North, South, East or West
-    std::array<std::string, 4> items = {"N","E","S","W"};
-    if (!inArray(location, items))
+    std::array<std::string_view, 4> items = {"N","E","S","W"};
+    if (!inArray(pad.m_location, items))
     {
         error("Expected a pad location to be one of N/E/S/W\n");
         return false;
     }
 
     // parse optional 'FLIP' argument for flipped cells
-    tok = tokenize(cellname);
-    if ((tok == TOK_IDENT) && (cellname == "FLIP"))
+    tok = tokenize(pad.m_cellname);
+    if ((tok == TOK_IDENT) && (pad.m_cellname == "FLIP"))
     {
-        flipped = true;
-        tok = tokenize(cellname);
+        pad.m_flipped = true;
+        tok = tokenize(pad.m_cellname);
     }
 
     // cell name
@@ -336,13 +448,71 @@ bool ConfigReader::parsePad()
         return false;
     }
 
-    m_padCount++;
-    onPad(instance,location,cellname,flipped);
+    if (pad.m_count > UINT32_MAX - m_padCount)
+    {
+        error("Too many pads\n");
+        return false;
+    }
+
+    m_padCount += pad.m_count;
+    m_pads.push_back(pad);
+    if (m_pads.size() >= c_padBatchSize)
+    {
+        flushPads();
+    }
+
+    return true;
+}
+
+bool ConfigReader::parseBusRange(padRecord_t &pad)
+{
+    // a bus range is written as name[first:last] or
+    // name[first:last:stride]. other instance names,
+    // including name[index], are used as they are.
+    std::string_view name = pad.m_instance;
+    size_t open = name.rfind('[');
+    if ((open == std::string_view::npos) || (name.back() != ']') ||
+        (name.find(':', open) == std::string_view::npos))
+    {
+        return true;
+    }
+
+    std::string_view range = name.substr(open + 1, name.size() - open - 2);
+    const size_t fields = std::count(range.begin(), range.end(), ':') + 1;
+    uint32_t values[3] = {0, 0, 1};
+    bool valid = (fields <= 3);
+    for(size_t i=0; valid && (i<fields); i++)
+    {
+        size_t colon = range.find(':');
+        std::string_view field = range.substr(0, colon);
+        auto result = std::from_chars(field.data(), field.data() + field.size(), values[i]);
+        valid = (!field.empty()) && (result.ec == std::errc()) && (result.ptr == field.data() + field.size());
+        range.remove_prefix((colon == std::string_view::npos) ? range.size() : colon + 1);
+    }
+
+    const uint32_t first  = values[0];
+    const uint32_t last   = values[1];
+    const uint32_t stride = values[2];
+    const uint32_t span   = (first <= last) ? (last - first) : (first - last);
+
+    // [0:4294967295] has one pad more than a uint32_t can count
+    const uint64_t count  = (stride == 0) ? 0 : static_cast<uint64_t>(span / stride) + 1;
+    if (!valid || (stride == 0) || (stride > static_cast<uint32_t>(INT32_MAX)) || ((span % stride) != 0) ||
+        (count > UINT32_MAX))
+    {
+        error("Invalid bus range " + std::string(name) + ", expected [first:last] or [first:last:stride]\n");
+        return false;
+    }
 
+    pad.m_instance  = name.substr(0, open);
+    pad.m_bus       = true;
+    pad.m_busFirst  = first;
+    pad.m_busStride = (first <= last) ? static_cast<int32_t>(stride) : -static_cast<int32_t>(stride);
+    pad.m_count     = static_cast<uint32_t>(count);
     return true;
 }
 
-bool ConfigReader::inArray(const std::string &value, const std::array<std::string, 4> &array)
+bool ConfigReader::inArray(std::string_view value, const std::array<std::string_view, 4> &array)
 {
     return std::find(array.begin(), array.end(), value) != array.end();
 }
@@ -350,10 +520,10 @@ bool ConfigReader::inArray(const std::string &value, const std::array<std::strin
 bool ConfigReader::parseCorner()
 {
     // CORNER: instance location cellname
-    std::string tokstr;
-    std::string instance;
-    std::string location;
-    std::string cellname;
+    std::string_view tokstr;
+    std::string_view instance;
+    std::string_view location;
+    std::string_view cellname;
 
     // instance name
     ConfigReader::token_t tok = tokenize(instance);
@@ -372,7 +542,7 @@ bool ConfigReader::parseCorner()
     }
 
     // corners can only be on NorthWest, SouthWest, SouthEast or NorthEast
-    std::array<std::string, 4> items = {"NW","SW","SE","NE"};
+    std::array<std::string_view, 4> items = {"NW","SW","SE","NE"};
     if (!inArray(location, items))
     {
         error("Expected a corner location to be one of NW/SW/SE/NE\n");
@@ -395,15 +565,15 @@ bool ConfigReader::parseCorner()
         return false;
     }
 
-    onCorner(instance,location,cellname);
+    onCorner(std::string(instance), std::string(location), std::string(cellname));
     return true;
 }
 
 bool ConfigReader::parseArea()
 {
     // AREA: x y
-    std::string tokstr;
-    std::string w,h;
+    std::string_view tokstr;
+    std::string_view w,h;
 
     // width
     ConfigReader::token_t tok = tokenize(w);
@@ -430,14 +600,14 @@ bool ConfigReader::parseArea()
     }
 
     double wd, hd;
-    try
+    if (!NumberParser::toDouble(w, wd))
     {
-        wd = std::stod(w);
-        hd = std::stod(h);
+        error("Invalid number " + std::string(w) + "\n");
+        return false;
     }
-    catch(const std::invalid_argument& ia)
+    if (!NumberParser::toDouble(h, hd))
     {
-        error(ia.what());
+        error("Invalid number " + std::string(h) + "\n");
         return false;
     }
 
@@ -448,8 +618,8 @@ bool ConfigReader::parseArea()
 bool ConfigReader::parseGrid()
 {
     // GRID: g
-    std::string tokstr;
-    std::string g;
+    std::string_view tokstr;
+    std::string_view g;
 
     // grid
     ConfigReader::token_t tok = tokenize(g);
@@ -468,13 +638,10 @@ bool ConfigReader::parseGrid()
     }
 
     double gd;
-    try
-    {
-        gd = std::stod(g);
-    }
-    catch(const std::invalid_argument& ia)
+    if (!NumberParser::toDouble(g, gd))
     {
-        error(ia.what());
+        error("Invalid number " + std::string(g) + "\n");
+        return false;
     }
 
     onGrid(gd);
@@ -484,8 +651,8 @@ bool ConfigReader::parseGrid()
 bool ConfigReader::parseSpace()
 {
     // SPACE: g
-    std::string tokstr;
-    std::string g;
+    std::string_view tokstr;
+    std::string_view g;
 
     // space
     ConfigReader::token_t tok = tokenize(g);
@@ -504,13 +671,10 @@ bool ConfigReader::parseSpace()
     }
 
     double gd;
-    try
+    if (!NumberParser::toDouble(g, gd))
     {
-        gd = std::stod(g);
-    }
-    catch(const std::invalid_argument& ia)
-    {
-        error(ia.what());
+        error("Invalid number " + std::string(g) + "\n");
+        return false;
     }
 
     onSpace(gd);
@@ -521,8 +685,8 @@ bool ConfigReader::parseSpace()
 bool ConfigReader::parseOffset()
 {
     // OFFSET: g
-    std::string tokstr;
-    std::string g;
+    std::string_view tokstr;
+    std::string_view g;
 
     // offset
     ConfigReader::token_t tok = tokenize(g);
@@ -541,13 +705,10 @@ bool ConfigReader::parseOffset()
     }
 
     double gd;
-    try
-    {
-        gd = std::stod(g);
-    }
-    catch(const std::invalid_argument& ia)
+    if (!NumberParser::toDouble(g, gd))
     {
-        error(ia.what());
+        error("Invalid number " + std::string(g) + "\n");
+        return false;
     }
 
     onOffset(gd);
@@ -557,8 +718,8 @@ bool ConfigReader::parseOffset()
 bool ConfigReader::parseFiller()
 {
     // FILLER: fillername
-    std::string tokstr;
-    std::string fillerName;
+    std::string_view tokstr;
+    std::string_view fillerName;
 
     // fillername
     ConfigReader::token_t tok = tokenize(fillerName);
@@ -576,15 +737,91 @@ bool ConfigReader::parseFiller()
         return false;
     }
 
-    onFiller(fillerName);
+    onFiller(std::string(fillerName));
     return true;
 }
 
+bool ConfigReader::parseInclude()
+{
+    // INCLUDE: filename
+    std::string_view tokstr;
+    std::string_view includeName;
+
+    // filename, quoted if it does not look like an identifier
+    ConfigReader::token_t tok = tokenize(includeName);
+    if ((tok != TOK_IDENT) && (tok != TOK_STRING))
+    {
+        error("Expected a file name\n");
+        return false;
+    }
+
+    // expect semicol
+    tok = tokenize(tokstr);
+    if (tok != TOK_SEMICOL)
+    {
+        error("Expected ;\n");
+        return false;
+    }
+
+    // a relative name is relative to the including file
+    std::filesystem::path path(includeName);
+    if (path.is_relative() && !m_fileName.empty())
+    {
+        path = std::filesystem::path(m_fileName).parent_path() / path;
+    }
+    const std::string fileName = path.string();
+    const std::string key = canonicalName(fileName);
+
+    if (std::find(t_includeStack.begin(), t_includeStack.end(), key) != t_includeStack.end())
+    {
+        std::string cycle;
+        for(auto const &name : t_includeStack)
+        {
+            cycle += name + " -> ";
+        }
+        error("INCLUDE cycle: " + cycle + key + "\n");
+        return false;
+    }
+
+    // each file is parsed once, later INCLUDEs replay its statements
+    std::shared_ptr<const std::string> statements;
+    {
+        std::lock_guard<std::mutex> lock(g_includeMutex);
+        auto iter = g_includeCache.find(key);
+        if (iter != g_includeCache.end())
+        {
+            statements = iter->second;
+        }
+    }
+
+    if (!statements)
+    {
+        MappedFile file;
+        if (!file.openDecompressed(fileName))
+        {
+            error("Cannot open included file " + fileName + "\n");
+            return false;
+        }
+
+        auto compiled = std::make_shared<std::string>();
+        if (!PadCfg::compile(file.data(), file.size(), *compiled, fileName))
+        {
+            error("Cannot include " + fileName + "\n");
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(g_includeMutex);
+        statements = g_includeCache.emplace(key, compiled).first->second;
+    }
+
+    return PadCfg::read(statements->data(), statements->size(), *this);
+}
+
 bool ConfigReader::parseDesignName()
 {
     // DESIGN: designname
-    std::string tokstr;
-    std::string designName;
+    std::string_view tokstr;
+    std::string_view designName;
 
     // designname
     ConfigReader::token_t tok = tokenize(designName);
@@ -602,6 +839,6 @@ bool ConfigReader::parseDesignName()
         return false;
     }
 
-    onDesignName(designName);
+    onDesignName(std::string(designName));
     return true;
 }
@@ -28,12 +28,15 @@ void DebugUtils::dumpToConsole(const PRLEFReader::LEFCellInfo_t *cell)
     ss << "\n";
 
     if (cell != nullptr) {
-        ss << "Name:    " << cell->m_name.c_str() << "\n";
-        ss << "Foreign  " << cell->m_foreign.c_str() << "\n";
+        ss << "Name:    " << cell->m_name << "\n";
+        ss << "Foreign  " << cell->m_foreign << "\n";
         ss << "Width    " << cell->m_sx << "\n";
         ss << "Height   " << cell->m_sy << "\n";
         ss << "Type     " << (cell->m_isFiller ? "FILLER" : "REGULAR") << "\n";
-        ss << "Symmetry " << cell->m_symmetry.c_str() << "\n";
+        ss << "Class    " << cell->m_class << "\n";
+        ss << "Symmetry " << cell->m_symmetry << "\n";
+        ss << "Pins     " << cell->m_pinCount << "\n";
+        ss << "OBS      " << cell->m_obsCount << " rectangles\n";
     } else {
         ss << "Error: cell is a nullptr!\n";
     }
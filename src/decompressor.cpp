@@ -0,0 +1,367 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include "logging.h"
+#include "decompressor.h"
+
+#ifdef PADRING_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef PADRING_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+compression_t detectCompression(const char *data, size_t bytes)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+    if ((bytes >= 2) && (p[0] == 0x1F) && (p[1] == 0x8B))
+    {
+        return COMPRESSION_GZIP;
+    }
+
+    if ((bytes >= 4) && (p[0] == 0x28) && (p[1] == 0xB5) && (p[2] == 0x2F) && (p[3] == 0xFD))
+    {
+        return COMPRESSION_ZSTD;
+    }
+
+    return COMPRESSION_NONE;
+}
+
+const char* compressionName(compression_t type)
+{
+    switch(type)
+    {
+    case COMPRESSION_GZIP:
+        return "gzip";
+    case COMPRESSION_ZSTD:
+        return "zstd";
+    default:
+        return "uncompressed";
+    }
+}
+
+bool isCompressionSupported(compression_t type)
+{
+    switch(type)
+    {
+    case COMPRESSION_NONE:
+        return true;
+#ifdef PADRING_HAVE_ZLIB
+    case COMPRESSION_GZIP:
+        return true;
+#endif
+#ifdef PADRING_HAVE_ZSTD
+    case COMPRESSION_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+// ********************************************************************************
+//   DecompressingBuffer
+// ********************************************************************************
+
+DecompressingBuffer::DecompressingBuffer(std::istream &source, compression_t type)
+    : m_source(source),
+      m_type(type),
+      m_in(c_chunkSize),
+      m_out(c_chunkSize),
+      m_inPos(0),
+      m_inSize(0),
+      m_failed(false),
+      m_finished(false),
+      m_decoder(nullptr)
+{
+    switch(m_type)
+    {
+#ifdef PADRING_HAVE_ZLIB
+    case COMPRESSION_GZIP:
+        {
+            z_stream *zs = new z_stream();
+            // 15 window bits + 16: expect a gzip header
+            if (inflateInit2(zs, 15 + 16) != Z_OK)
+            {
+                delete zs;
+                m_failed = true;
+                break;
+            }
+            m_decoder = zs;
+        }
+        break;
+#endif
+#ifdef PADRING_HAVE_ZSTD
+    case COMPRESSION_ZSTD:
+        {
+            ZSTD_DStream *zds = ZSTD_createDStream();
+            if ((zds == nullptr) || ZSTD_isError(ZSTD_initDStream(zds)))
+            {
+                ZSTD_freeDStream(zds);
+                m_failed = true;
+                break;
+            }
+            m_decoder = zds;
+        }
+        break;
+#endif
+    default:
+        m_failed = true;
+    }
+
+    // empty get area, underflow fills it
+    setg(m_out.data(), m_out.data(), m_out.data());
+}
+
+DecompressingBuffer::~DecompressingBuffer()
+{
+    if (m_decoder == nullptr)
+    {
+        return;
+    }
+
+    switch(m_type)
+    {
+#ifdef PADRING_HAVE_ZLIB
+    case COMPRESSION_GZIP:
+        inflateEnd(static_cast<z_stream*>(m_decoder));
+        delete static_cast<z_stream*>(m_decoder);
+        break;
+#endif
+#ifdef PADRING_HAVE_ZSTD
+    case COMPRESSION_ZSTD:
+        ZSTD_freeDStream(static_cast<ZSTD_DStream*>(m_decoder));
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+bool DecompressingBuffer::readInput()
+{
+    m_source.read(m_in.data(), m_in.size());
+    m_inSize = static_cast<size_t>(m_source.gcount());
+    m_inPos  = 0;
+    return m_inSize > 0;
+}
+
+DecompressingBuffer::int_type DecompressingBuffer::underflow()
+{
+    if (gptr() < egptr())
+    {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    size_t bytes = decodeChunk();
+    if (bytes == 0)
+    {
+        return traits_type::eof();
+    }
+
+    setg(m_out.data(), m_out.data(), m_out.data() + bytes);
+    return traits_type::to_int_type(*gptr());
+}
+
+size_t DecompressingBuffer::decodeChunk()
+{
+    if (m_failed || (m_decoder == nullptr))
+    {
+        return 0;
+    }
+
+    size_t produced = 0;
+    while(produced == 0)
+    {
+        if ((m_inPos == m_inSize) && !readInput())
+        {
+            if (!m_finished)
+            {
+                doLog(LOG_ERROR, "Unexpected end of %s compressed data\n", compressionName(m_type));
+                m_failed = true;
+            }
+            return 0;
+        }
+
+        switch(m_type)
+        {
+#ifdef PADRING_HAVE_ZLIB
+        case COMPRESSION_GZIP:
+            {
+                z_stream *zs  = static_cast<z_stream*>(m_decoder);
+                zs->next_in   = reinterpret_cast<Bytef*>(m_in.data() + m_inPos);
+                zs->avail_in  = static_cast<uInt>(m_inSize - m_inPos);
+                zs->next_out  = reinterpret_cast<Bytef*>(m_out.data());
+                zs->avail_out = static_cast<uInt>(m_out.size());
+
+                int result = inflate(zs, Z_NO_FLUSH);
+                m_inPos  = m_inSize - zs->avail_in;
+                produced = m_out.size() - zs->avail_out;
+                m_finished = false;
+                if (result == Z_STREAM_END)
+                {
+                    // gzip files may hold several members
+                    m_finished = true;
+                    inflateReset(zs);
+                }
+                else if ((result != Z_OK) && (result != Z_BUF_ERROR))
+                {
+                    doLog(LOG_ERROR, "gzip error: %s\n", (zs->msg != nullptr) ? zs->msg : "corrupt data");
+                    m_failed = true;
+                    return 0;
+                }
+            }
+            break;
+#endif
+#ifdef PADRING_HAVE_ZSTD
+        case COMPRESSION_ZSTD:
+            {
+                ZSTD_inBuffer  input  = {m_in.data(), m_inSize, m_inPos};
+                ZSTD_outBuffer output = {m_out.data(), m_out.size(), 0};
+                size_t result = ZSTD_decompressStream(static_cast<ZSTD_DStream*>(m_decoder), &output, &input);
+                if (ZSTD_isError(result))
+                {
+                    doLog(LOG_ERROR, "zstd error: %s\n", ZSTD_getErrorName(result));
+                    m_failed = true;
+                    return 0;
+                }
+                m_inPos  = input.pos;
+                produced = output.pos;
+                // 0 means a frame was completely decoded and flushed
+                m_finished = (result == 0);
+            }
+            break;
+#endif
+        default:
+            return 0;
+        }
+    }
+    return produced;
+}
+
+// ********************************************************************************
+//   InputFile
+// ********************************************************************************
+
+InputFile::InputFile() : std::istream(nullptr), m_compression(COMPRESSION_NONE)
+{
+}
+
+InputFile::InputFile(const std::string &filename) : std::istream(nullptr), m_compression(COMPRESSION_NONE)
+{
+    open(filename);
+}
+
+InputFile::~InputFile()
+{
+    rdbuf(nullptr);
+}
+
+bool InputFile::open(const std::string &filename)
+{
+    rdbuf(nullptr);
+    m_decompressor.reset();
+    m_compression = COMPRESSION_NONE;
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+
+    m_file.open(filename, std::ifstream::in | std::ifstream::binary);
+    if (!m_file.is_open())
+    {
+        setstate(std::ios::failbit);
+        return false;
+    }
+
+    char magic[4];
+    m_file.read(magic, sizeof(magic));
+    m_compression = detectCompression(magic, static_cast<size_t>(m_file.gcount()));
+    m_file.clear();
+    m_file.seekg(0);
+
+    if (!isCompressionSupported(m_compression))
+    {
+        doLog(LOG_ERROR, "%s is %s compressed, but padring was built without %s support\n",
+            filename.c_str(), compressionName(m_compression), compressionName(m_compression));
+        m_file.close();
+        setstate(std::ios::failbit);
+        return false;
+    }
+
+    if (m_compression == COMPRESSION_NONE)
+    {
+        rdbuf(m_file.rdbuf());
+    }
+    else
+    {
+        m_decompressor.reset(new DecompressingBuffer(m_file, m_compression));
+        rdbuf(m_decompressor.get());
+    }
+    clear();
+    return true;
+}
+
+bool readDecompressed(const std::string &filename, std::vector<char> &data)
+{
+    InputFile file;
+    if (!file.open(filename))
+    {
+        return false;
+    }
+
+    data.clear();
+    char buffer[64*1024];
+    while(file.read(buffer, sizeof(buffer)) || (file.gcount() > 0))
+    {
+        data.insert(data.end(), buffer, buffer + file.gcount());
+    }
+    return !file.failed();
+}
+
+bool decompressBuffer(const char *src, size_t bytes, std::vector<char> &data)
+{
+    compression_t type = detectCompression(src, bytes);
+    if (!isCompressionSupported(type))
+    {
+        doLog(LOG_ERROR, "Data is %s compressed, but padring was built without %s support\n",
+            compressionName(type), compressionName(type));
+        return false;
+    }
+
+    if (type == COMPRESSION_NONE)
+    {
+        data.assign(src, src + bytes);
+        return true;
+    }
+
+    MemoryStream source(src, bytes);
+    DecompressingBuffer decompressor(source, type);
+    std::istream is(&decompressor);
+
+    data.clear();
+    char buffer[64*1024];
+    while(is.read(buffer, sizeof(buffer)) || (is.gcount() > 0))
+    {
+        data.insert(data.end(), buffer, buffer + is.gcount());
+    }
+    return !decompressor.failed();
+}
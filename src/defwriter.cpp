@@ -23,6 +23,7 @@
 #include <complex>
 #include <math.h>
 #include <assert.h>
+#include <cmath>
 #include "logging.h"
 #include "defwriter.h"
 
@@ -71,8 +72,10 @@ void DEFWriter::toDEFCoordinates(double &x, double &y)
         m_databaseUnits = 100.0;
     }
 
-    x *= m_databaseUnits;
-    y *= m_databaseUnits;
+    // DEF coordinates are integers: round once, here,
+    // instead of printing a scaled double.
+    x = static_cast<double>(std::llround(x * m_databaseUnits));
+    y = static_cast<double>(std::llround(y * m_databaseUnits));
 }
 
 void DEFWriter::writeCell(const LayoutItem *item)
@@ -129,7 +129,7 @@ void GDS2Writer::writeFloat64(double v)
     fwrite(ptr, sizeof(v), 1, m_fout);
 }
 
-uint32_t GDS2Writer::writeString(const std::string &str)
+uint32_t GDS2Writer::writeString(std::string_view str)
 {
     uint32_t bytes = str.size();
     for(auto c : str)
@@ -228,86 +228,11 @@ void GDS2Writer::writeCell(const LayoutItem *item)
         return;
     }
 
-    double px = item->m_x;      // x-position in microns
-    double py = item->m_y;      // y-position in microns
-    uint32_t rot = 0;           // rotation in degrees
-    bool     flip = false;      // true if cell is to be flipped (GDS2 flipping style!)
-
-    // process regular cells that have N,S,E,W
-    // locations
-    if (item->m_location == "N")
-    {
-        // North orientation, rotation = 180 degrees
-        if (item->m_flipped)
-        {
-            flip = true;
-            rot = 0;
-        }
-        else
-        {
-            px += item->m_lefinfo->m_sx;
-            rot = 180;
-        }
-    }
-    else if (item->m_location == "S")
-    {
-        // South orientation, rotation = 0 degrees
-        if (item->m_flipped)
-        {
-            flip = true;
-            rot = 180;
-            px += item->m_lefinfo->m_sx;
-        }
-        else
-        {
-            // nothing
-        }
-    }
-    else if (item->m_location == "E")
-    {
-        if (item->m_flipped)
-        {
-            flip = true;
-            rot = 270;
-            py += item->m_lefinfo->m_sx;
-        }
-        else
-        {
-            rot = 90;
-        }
-    }
-    else if (item->m_location == "W")
-    {
-        if (item->m_flipped)
-        {
-            flip = true;
-            rot = 90;
-        }
-        else
-        {
-            py += item->m_lefinfo->m_sx;
-            rot = 270;
-        }
-    }
-    // process corner cells that have NE,NW,SE,SW locations
-    else if (item->m_location == "NW")
-    {
-        rot = 270;
-    }
-    else if (item->m_location == "SE")
-    {
-        px += item->m_lefinfo->m_sy;
-        rot = 90;
-    }
-    else if (item->m_location == "NE")
-    {
-        px += item->m_lefinfo->m_sx;
-        rot = 180;
-    }
-    else if (item->m_location == "SW")
-    {
-        // nothing.
-    }
+    const LayoutItem::placement_t placement = item->getPlacement();
+    double px = placement.m_x;          // x-position in microns
+    double py = placement.m_y;          // y-position in microns
+    uint32_t rot = placement.m_rotation;
+    bool     flip = placement.m_flip;   // GDS2 flipping style!
 
     // SREF
     writeUint16(0x0004);    // Len
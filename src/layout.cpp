@@ -22,6 +22,92 @@
 #include "logging.h"
 #include "layout.h"
 
+LayoutItem::placement_t LayoutItem::getPlacement() const
+{
+    double px = m_x;            // x-position in microns
+    double py = m_y;            // y-position in microns
+    uint32_t rot = 0;           // rotation in degrees
+    bool     flip = false;      // true if cell is to be flipped (GDS2 flipping style!)
+
+    // process regular cells that have N,S,E,W
+    // locations
+    if (m_location == "N")
+    {
+        // North orientation, rotation = 180 degrees
+        if (m_flipped)
+        {
+            flip = true;
+            rot = 0;
+        }
+        else
+        {
+            px += m_lefinfo->m_sx;
+            rot = 180;
+        }
+    }
+    else if (m_location == "S")
+    {
+        // South orientation, rotation = 0 degrees
+        if (m_flipped)
+        {
+            flip = true;
+            rot = 180;
+            px += m_lefinfo->m_sx;
+        }
+        else
+        {
+            // nothing
+        }
+    }
+    else if (m_location == "E")
+    {
+        if (m_flipped)
+        {
+            flip = true;
+            rot = 270;
+            py += m_lefinfo->m_sx;
+        }
+        else
+        {
+            rot = 90;
+        }
+    }
+    else if (m_location == "W")
+    {
+        if (m_flipped)
+        {
+            flip = true;
+            rot = 90;
+        }
+        else
+        {
+            py += m_lefinfo->m_sx;
+            rot = 270;
+        }
+    }
+    // process corner cells that have NE,NW,SE,SW locations
+    else if (m_location == "NW")
+    {
+        rot = 270;
+    }
+    else if (m_location == "SE")
+    {
+        px += m_lefinfo->m_sy;
+        rot = 90;
+    }
+    else if (m_location == "NE")
+    {
+        px += m_lefinfo->m_sx;
+        rot = 180;
+    }
+    else if (m_location == "SW")
+    {
+        // nothing.
+    }
+
+    return {px, py, rot, flip};
+}
+
 
 Layout::Layout(direction_t dir) : m_dir(dir), m_edgePos(0.0), m_insertFlexSpacer(true)
 {
@@ -44,7 +130,7 @@ double Layout::getMinSize() const
     {
         if (item->m_size >= 0)
         {
-            total += item->m_size;
+            total += item->m_size * item->m_count;
         }
     }
 
@@ -113,6 +199,11 @@ bool Layout::doLayout()
         {
             flexSpaceItems++;
         }
+        else if (item->isRun())
+        {
+            // the spaces between the cells of a bus run
+            flexSpaceItems += item->m_count - 1;
+        }
     }
 
     double meanFlexSpaceSize = (m_dieSize - minx) / static_cast<double>(flexSpaceItems);
@@ -126,9 +217,6 @@ bool Layout::doLayout()
         setItemEdgePos(m_firstCorner);
     }
 
-    // FIXME: make grid configurable! 
-    double grid = 1.0;
-    double newPos;
     double error = 0.0;
     for(auto item : m_items)
     {
@@ -139,13 +227,21 @@ bool Layout::doLayout()
         switch(item->m_ltype)
         {
         case LayoutItem::TYPE_FLEXSPACE:
-            newPos = pos + meanFlexSpaceSize + error;
-            newPos = std::floor(newPos / grid) * grid;  // round new position to grid
-            item->m_size = newPos - pos;                // set size of FLEXSPACE
-            pos = newPos;
-            error += (meanFlexSpaceSize - item->m_size);
+            pos = placeFlexSpace(pos, meanFlexSpaceSize, error, item->m_size);
             break;
         case LayoutItem::TYPE_CELL:
+            if (item->isRun())
+            {
+                // remember where the FLEXSPACEs of the run start
+                // so expandItems() can place them the same way.
+                item->m_flexSize  = meanFlexSpaceSize;
+                item->m_flexError = error;
+                for(uint32_t n=1; n<item->m_count; n++)
+                {
+                    double flexSize;
+                    pos = placeFlexSpace(pos + item->m_size, meanFlexSpaceSize, error, flexSize);
+                }
+            }
             pos += item->m_size;
             break;
         case LayoutItem::TYPE_CORNER:
@@ -167,6 +263,53 @@ bool Layout::doLayout()
     return true;
 }
 
+double Layout::placeFlexSpace(double pos, double meanSize, double &error, double &size) const
+{
+    // FIXME: make grid configurable! 
+    double grid = 1.0;
+    double newPos = pos + meanSize + error;
+    newPos = std::floor(newPos / grid) * grid;  // round new position to grid
+    size = newPos - pos;                        // set size of FLEXSPACE
+    error += (meanSize - size);
+    return newPos;
+}
+
+std::vector<LayoutItem*> Layout::expandItems(std::deque<LayoutItem> &storage) const
+{
+    std::vector<LayoutItem*> items;
+    items.reserve(m_items.size());
+    for(auto item : m_items)
+    {
+        if (!item->isRun())
+        {
+            items.push_back(item);
+            continue;
+        }
+
+        double pos   = getItemPos(item);
+        double error = item->m_flexError;
+        for(uint32_t n=0; n<item->m_count; n++)
+        {
+            if (n > 0)
+            {
+                LayoutItem &flex = storage.emplace_back(LayoutItem::TYPE_FLEXSPACE);
+                setItemEdgePos(&flex);
+                setItemPos(&flex, pos);
+                pos = placeFlexSpace(pos, item->m_flexSize, error, flex.m_size);
+                items.push_back(&flex);
+            }
+
+            LayoutItem &cell = storage.emplace_back(*item);
+            cell.m_instance = item->runInstance(n);
+            cell.m_count = 1;
+            setItemPos(&cell, pos);
+            items.push_back(&cell);
+            pos += item->m_size;
+        }
+    }
+    return items;
+}
+
 void Layout::dump()
 {
     if (m_firstCorner != nullptr)
@@ -177,7 +320,11 @@ void Layout::dump()
 
     for(auto c : m_items)
     {
-        if ((c->m_ltype == LayoutItem::TYPE_CELL) || (c->m_ltype == LayoutItem::TYPE_CORNER))
+        if (c->isRun())
+        {
+            std::cout << c->runInstance(0) << " .. " << c->runInstance(c->m_count-1) << " : " << c->m_cellname << " " << getItemPos(c) << "\n";
+        }
+        else if ((c->m_ltype == LayoutItem::TYPE_CELL) || (c->m_ltype == LayoutItem::TYPE_CORNER))
         {
             std::cout << c->m_instance << " : " << c->m_cellname << " " << getItemPos(c) << "\n";
         }
@@ -0,0 +1,298 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "lefdiff.h"
+
+namespace
+{
+
+/** combines values into a 64-bit hash */
+class Hasher
+{
+public:
+    void add(uint64_t value)
+    {
+        m_hash = (m_hash ^ value) * 0xff51afd7ed558ccdULL;
+        m_hash ^= m_hash >> 32;
+    }
+
+    void addDouble(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    }
+
+    void addString(std::string_view str)
+    {
+        add(std::hash<std::string_view>()(str));
+        add(str.size());
+    }
+
+    uint64_t value() const
+    {
+        return m_hash;
+    }
+
+protected:
+    uint64_t m_hash = 0x9e3779b97f4a7c15ULL;
+};
+
+/** microns per database unit of a library */
+double micronsPerUnit(const PRLEFReader &lib)
+{
+    return (lib.m_lefDatabaseUnits > 0.0) ? 1.0 / lib.m_lefDatabaseUnits : 1.0;
+}
+
+/** hashes of the layer names of a library, by layer id */
+std::vector<uint64_t> layerHashes(const PRLEFReader &lib)
+{
+    std::vector<uint64_t> hashes;
+    for(size_t i=0; i<lib.m_geometry.layerCount(); i++)
+    {
+        hashes.push_back(std::hash<std::string_view>()(lib.m_geometry.layerName(static_cast<uint16_t>(i))));
+    }
+    return hashes;
+}
+
+void hashRects(Hasher &hasher, const PRLEFReader &lib, const std::vector<uint64_t> &layers,
+    uint32_t first, uint32_t count)
+{
+    const LEFGeometry &geometry = lib.m_geometry;
+    const double scale = micronsPerUnit(lib);
+    for(uint32_t i=first; i<first+count; i++)
+    {
+        hasher.add(layers[geometry.layers()[i]]);
+        hasher.addDouble(geometry.x1()[i] * scale);
+        hasher.addDouble(geometry.y1()[i] * scale);
+        hasher.addDouble(geometry.x2()[i] * scale);
+        hasher.addDouble(geometry.y2()[i] * scale);
+    }
+}
+
+bool sameRects(const PRLEFReader &oldLib, uint32_t oldFirst,
+    const PRLEFReader &newLib, uint32_t newFirst, uint32_t count)
+{
+    const LEFGeometry &a = oldLib.m_geometry;
+    const LEFGeometry &b = newLib.m_geometry;
+    const double scaleA = micronsPerUnit(oldLib);
+    const double scaleB = micronsPerUnit(newLib);
+    for(uint32_t i=0; i<count; i++)
+    {
+        const uint32_t ia = oldFirst + i;
+        const uint32_t ib = newFirst + i;
+        if ((a.x1()[ia]*scaleA != b.x1()[ib]*scaleB) || (a.y1()[ia]*scaleA != b.y1()[ib]*scaleB) ||
+            (a.x2()[ia]*scaleA != b.x2()[ib]*scaleB) || (a.y2()[ia]*scaleA != b.y2()[ib]*scaleB) ||
+            (a.layerName(a.layers()[ia]) != b.layerName(b.layers()[ib])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool byName(const PRLEFReader::LEFCellInfo_t *a, const PRLEFReader::LEFCellInfo_t *b)
+{
+    return a->m_name < b->m_name;
+}
+
+} // namespace
+
+uint64_t LEFDiff::hashCell(const PRLEFReader &lib, const PRLEFReader::LEFCellInfo_t &cell)
+{
+    return hashCell(lib, layerHashes(lib), cell);
+}
+
+uint64_t LEFDiff::hashCell(const PRLEFReader &lib, const std::vector<uint64_t> &layers,
+    const PRLEFReader::LEFCellInfo_t &cell)
+{
+    Hasher hasher;
+    hasher.addDouble(cell.m_sx);
+    hasher.addDouble(cell.m_sy);
+    hasher.addString(cell.m_class);
+    hasher.addString(cell.m_foreign);
+    hasher.addString(cell.m_symmetry);
+
+    hasher.add(cell.m_pinCount);
+    for(uint32_t i=0; i<cell.m_pinCount; i++)
+    {
+        auto const &pin = lib.m_geometry.pin(cell.m_firstPin + i);
+        hasher.addString(pin.m_name);
+        hasher.add(pin.m_rectCount);
+        hashRects(hasher, lib, layers, pin.m_firstRect, pin.m_rectCount);
+    }
+
+    hasher.add(cell.m_obsCount);
+    hashRects(hasher, lib, layers, cell.m_firstObs, cell.m_obsCount);
+    return hasher.value();
+}
+
+uint32_t LEFDiff::changes(const PRLEFReader &oldLib, const PRLEFReader::LEFCellInfo_t &oldCell,
+    const PRLEFReader &newLib, const PRLEFReader::LEFCellInfo_t &newCell)
+{
+    uint32_t result = 0;
+    if ((oldCell.m_sx != newCell.m_sx) || (oldCell.m_sy != newCell.m_sy))
+    {
+        result |= CHANGE_SIZE;
+    }
+
+    if (oldCell.m_class != newCell.m_class)
+    {
+        result |= CHANGE_CLASS;
+    }
+
+    if (oldCell.m_foreign != newCell.m_foreign)
+    {
+        result |= CHANGE_FOREIGN;
+    }
+
+    if (oldCell.m_symmetry != newCell.m_symmetry)
+    {
+        result |= CHANGE_SYMMETRY;
+    }
+
+    bool samePins = (oldCell.m_pinCount == newCell.m_pinCount);
+    for(uint32_t i=0; samePins && (i<oldCell.m_pinCount); i++)
+    {
+        auto const &a = oldLib.m_geometry.pin(oldCell.m_firstPin + i);
+        auto const &b = newLib.m_geometry.pin(newCell.m_firstPin + i);
+        samePins = (a.m_name == b.m_name) && (a.m_rectCount == b.m_rectCount) &&
+            sameRects(oldLib, a.m_firstRect, newLib, b.m_firstRect, a.m_rectCount);
+    }
+    if (!samePins)
+    {
+        result |= CHANGE_PINS;
+    }
+
+    if ((oldCell.m_obsCount != newCell.m_obsCount) ||
+        !sameRects(oldLib, oldCell.m_firstObs, newLib, newCell.m_firstObs, oldCell.m_obsCount))
+    {
+        result |= CHANGE_OBS;
+    }
+
+    return result;
+}
+
+LEFDiff::result_t LEFDiff::compare(const PRLEFReader &oldLib, const PRLEFReader &newLib)
+{
+    result_t result;
+    const std::vector<uint64_t> oldLayers = layerHashes(oldLib);
+    const std::vector<uint64_t> newLayers = layerHashes(newLib);
+
+    for(auto const &oldCell : oldLib.m_cells)
+    {
+        auto iter = newLib.m_cells.find(oldCell.first);
+        if (iter == newLib.m_cells.end())
+        {
+            result.m_removed.push_back(oldCell.second);
+            continue;
+        }
+
+        const PRLEFReader::LEFCellInfo_t &newCell = *iter->second;
+        if (hashCell(oldLib, oldLayers, *oldCell.second) == hashCell(newLib, newLayers, newCell))
+        {
+            result.m_unchanged++;
+            continue;
+        }
+
+        // a hash collision shows up as a change without changes
+        uint32_t changed = changes(oldLib, *oldCell.second, newLib, newCell);
+        if (changed != 0)
+        {
+            result.m_changed.push_back({oldCell.second, &newCell, changed});
+        }
+        else
+        {
+            result.m_unchanged++;
+        }
+    }
+
+    for(auto const &newCell : newLib.m_cells)
+    {
+        if (oldLib.m_cells.find(newCell.first) == oldLib.m_cells.end())
+        {
+            result.m_added.push_back(newCell.second);
+        }
+    }
+
+    // only the differences are sorted
+    std::sort(result.m_added.begin(), result.m_added.end(), byName);
+    std::sort(result.m_removed.begin(), result.m_removed.end(), byName);
+    std::sort(result.m_changed.begin(), result.m_changed.end(),
+        [](const changedCell_t &a, const changedCell_t &b)
+        {
+            return a.m_old->m_name < b.m_old->m_name;
+        });
+    return result;
+}
+
+void LEFDiff::write(std::ostream &os, const result_t &result)
+{
+    for(auto cell : result.m_removed)
+    {
+        os << "- " << cell->m_name << "\n";
+    }
+
+    for(auto cell : result.m_added)
+    {
+        os << "+ " << cell->m_name << "\n";
+    }
+
+    for(auto const &changed : result.m_changed)
+    {
+        const PRLEFReader::LEFCellInfo_t &a = *changed.m_old;
+        const PRLEFReader::LEFCellInfo_t &b = *changed.m_new;
+
+        os << "~ " << a.m_name << ":";
+        const char *separator = " ";
+        if (changed.m_changes & CHANGE_SIZE)
+        {
+            os << separator << "size " << a.m_sx << " x " << a.m_sy << " -> " << b.m_sx << " x " << b.m_sy;
+            separator = ", ";
+        }
+        if (changed.m_changes & CHANGE_CLASS)
+        {
+            os << separator << "class " << a.m_class << " -> " << b.m_class;
+            separator = ", ";
+        }
+        if (changed.m_changes & CHANGE_FOREIGN)
+        {
+            os << separator << "foreign " << a.m_foreign << " -> " << b.m_foreign;
+            separator = ", ";
+        }
+        if (changed.m_changes & CHANGE_SYMMETRY)
+        {
+            os << separator << "symmetry " << a.m_symmetry << " -> " << b.m_symmetry;
+            separator = ", ";
+        }
+        if (changed.m_changes & CHANGE_PINS)
+        {
+            os << separator << "pins";
+            separator = ", ";
+        }
+        if (changed.m_changes & CHANGE_OBS)
+        {
+            os << separator << "obstructions";
+        }
+        os << "\n";
+    }
+}
@@ -0,0 +1,136 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include "arena.h"
+#include "lefgeometry.h"
+
+uint16_t LEFGeometry::layerId(std::string_view layerName)
+{
+    auto iter = m_layerIds.find(layerName);
+    if (iter != m_layerIds.end())
+    {
+        return iter->second;
+    }
+
+    const uint16_t id = static_cast<uint16_t>(m_layerNames.size());
+    m_layerNames.push_back(layerName);
+    m_layerIds.insert(std::make_pair(layerName, id));
+    return id;
+}
+
+bool LEFGeometry::addRect(uint16_t layer, int64_t x1, int64_t y1, int64_t x2, int64_t y2)
+{
+    constexpr int64_t lo = std::numeric_limits<int32_t>::min();
+    constexpr int64_t hi = std::numeric_limits<int32_t>::max();
+    if ((std::min(std::min(x1, y1), std::min(x2, y2)) < lo) ||
+        (std::max(std::max(x1, y1), std::max(x2, y2)) > hi))
+    {
+        return false;
+    }
+
+    if (m_size == m_capacity)
+    {
+        // grow by half, doubling wastes too much
+        // memory on libraries with millions of rectangles.
+        reallocate(std::max<uint32_t>(1024, m_capacity + m_capacity/2));
+    }
+
+    column(0)[m_size] = static_cast<int32_t>(std::min(x1, x2));
+    column(1)[m_size] = static_cast<int32_t>(std::min(y1, y2));
+    column(2)[m_size] = static_cast<int32_t>(std::max(x1, x2));
+    column(3)[m_size] = static_cast<int32_t>(std::max(y1, y2));
+    layerColumn()[m_size] = layer;
+    m_size++;
+    return true;
+}
+
+void LEFGeometry::reallocate(uint32_t capacity)
+{
+    if (capacity == m_capacity)
+    {
+        return;
+    }
+
+    std::unique_ptr<char[]> block;
+    if (capacity > 0)
+    {
+        block.reset(new char[capacity * c_bytesPerRect]);
+    }
+
+    if (m_size > 0)
+    {
+        // copy the columns to their new positions
+        for(uint32_t i=0; i<4; i++)
+        {
+            memcpy(block.get() + 4*i*static_cast<size_t>(capacity), column(i), m_size*sizeof(int32_t));
+        }
+        memcpy(block.get() + 16*static_cast<size_t>(capacity), layers(), m_size*sizeof(uint16_t));
+    }
+
+    m_block.swap(block);
+    m_capacity = capacity;
+}
+
+LEFGeometry::offsets_t LEFGeometry::append(const LEFGeometry &other, StringPool &strings)
+{
+    offsets_t offsets;
+    offsets.m_rects = m_size;
+    offsets.m_pins  = pinCount();
+
+    std::vector<uint16_t> layerMap(other.layerCount());
+    for(uint16_t id=0; id<other.layerCount(); id++)
+    {
+        layerMap[id] = layerId(strings.intern(other.layerName(id)));
+    }
+
+    if (m_size + other.m_size > m_capacity)
+    {
+        reallocate(m_size + other.m_size);
+    }
+
+    if (other.m_size > 0)
+    {
+        for(uint32_t i=0; i<4; i++)
+        {
+            memcpy(column(i) + m_size, other.column(i), other.m_size*sizeof(int32_t));
+        }
+
+        uint16_t *layer = layerColumn();
+        const uint16_t *otherLayer = other.layers();
+        for(uint32_t i=0; i<other.m_size; i++)
+        {
+            layer[m_size + i] = layerMap[otherLayer[i]];
+        }
+        m_size += other.m_size;
+    }
+
+    m_pins.reserve(m_pins.size() + other.m_pins.size());
+    for(auto const &otherPin : other.m_pins)
+    {
+        pin_t pin = otherPin;
+        pin.m_name = strings.intern(pin.m_name);
+        pin.m_firstRect += offsets.m_rects;
+        m_pins.push_back(pin);
+    }
+
+    return offsets;
+}
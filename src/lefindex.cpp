@@ -0,0 +1,183 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+#include <string.h>
+#include <filesystem>
+#include <fstream>
+
+#include "logging.h"
+#include "lefindex.h"
+
+bool LEFIndex::read(const std::string &lefFile, const PadLib::fileState_t &state,
+    const MappedFile &stored, size_t bytes)
+{
+    m_sections.clear();
+    m_file.close();
+
+    const std::string indexFile = indexFileName(lefFile);
+    if (!m_file.open(indexFile))
+    {
+        return false;
+    }
+
+    const char *data = m_file.data();
+    const size_t size = m_file.size();
+
+    header_t header;
+    if (size < sizeof(header))
+    {
+        doLog(LOG_WARN, "LEF index %s is damaged\n", indexFile.c_str());
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if ((memcmp(header.m_magic, "PADIDX\0\0", 8) != 0) ||
+        (header.m_version != c_version) ||
+        (header.m_byteOrder != c_byteOrder))
+    {
+        doLog(LOG_INFO, "LEF index %s has an unsupported format\n", indexFile.c_str());
+        return false;
+    }
+
+    const size_t sectionsOffset = sizeof(header_t);
+    const size_t stringsOffset  = sectionsOffset + header.m_sectionCount * sizeof(sectionRecord_t);
+    if (stringsOffset + header.m_stringBytes != size)
+    {
+        doLog(LOG_WARN, "LEF index %s is damaged\n", indexFile.c_str());
+        return false;
+    }
+
+    // a touched file is still accepted when its contents are unchanged
+    if ((header.m_dataBytes != bytes) || (header.m_lefSize != state.m_size) ||
+        ((header.m_lefMtime != state.m_mtime) &&
+         (PadLib::hash(stored.data(), stored.size()) != header.m_lefHash)))
+    {
+        doLog(LOG_INFO, "LEF index %s is out of date\n", indexFile.c_str());
+        return false;
+    }
+
+    const char *strings = data + stringsOffset;
+    bool damaged = false;
+    auto getString = [&](const string_t &s)
+        {
+            if (static_cast<uint64_t>(s.m_offset) + s.m_length > header.m_stringBytes)
+            {
+                damaged = true;
+                return std::string_view();
+            }
+            return std::string_view(strings + s.m_offset, s.m_length);
+        };
+
+    m_sections.reserve(header.m_sectionCount);
+    for(uint32_t i=0; i<header.m_sectionCount; i++)
+    {
+        sectionRecord_t record;
+        memcpy(&record, data + sectionsOffset + i*sizeof(sectionRecord_t), sizeof(record));
+
+        damaged |= (record.m_type > LEFScanner::SEC_PROPERTYDEFINITIONS);
+        damaged |= (record.m_begin > record.m_end) || (record.m_end > bytes);
+
+        LEFScanner::section_t section;
+        section.m_type  = static_cast<LEFScanner::sectionType_t>(record.m_type);
+        section.m_name  = getString(record.m_name);
+        section.m_class = getString(record.m_class);
+        section.m_begin = record.m_begin;
+        section.m_end   = record.m_end;
+        section.m_line  = record.m_line;
+        m_sections.push_back(section);
+    }
+
+    if (damaged)
+    {
+        doLog(LOG_WARN, "LEF index %s is damaged\n", indexFile.c_str());
+        m_sections.clear();
+        return false;
+    }
+    return true;
+}
+
+bool LEFIndex::write(const std::string &lefFile, const PadLib::fileState_t &state,
+    size_t bytes, const std::vector<LEFScanner::section_t> &sections)
+{
+    header_t header;
+    memcpy(header.m_magic, "PADIDX\0\0", 8);
+    header.m_version      = c_version;
+    header.m_byteOrder    = c_byteOrder;
+    header.m_sectionCount = static_cast<uint32_t>(sections.size());
+    header.m_reserved     = 0;
+    header.m_lefSize      = state.m_size;
+    header.m_lefMtime     = state.m_mtime;
+    header.m_lefHash      = state.m_hash;
+    header.m_dataBytes    = bytes;
+
+    std::string strings;
+    auto addString = [&strings](std::string_view str)
+        {
+            string_t entry;
+            entry.m_offset = static_cast<uint32_t>(strings.size());
+            entry.m_length = static_cast<uint32_t>(str.size());
+            strings += str;
+            return entry;
+        };
+
+    std::vector<sectionRecord_t> records;
+    records.reserve(sections.size());
+    for(auto const &section : sections)
+    {
+        sectionRecord_t record;
+        record.m_type  = section.m_type;
+        record.m_line  = section.m_line;
+        record.m_begin = section.m_begin;
+        record.m_end   = section.m_end;
+        record.m_name  = addString(section.m_name);
+        record.m_class = addString(section.m_class);
+        records.push_back(record);
+    }
+    header.m_stringBytes = strings.size();
+
+    // write to a temporary file first so a concurrent
+    // reader never sees a half-written index.
+    const std::string indexFile = indexFileName(lefFile);
+    const std::string tmpFile = PadLib::tempFileName(indexFile);
+    std::error_code ec;
+    {
+        std::ofstream os(tmpFile, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!os.good())
+        {
+            return false;
+        }
+
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(records.data()), records.size()*sizeof(sectionRecord_t));
+        os.write(strings.data(), strings.size());
+        if (!os.good())
+        {
+            os.close();
+            std::filesystem::remove(tmpFile, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmpFile, indexFile, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpFile, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,374 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <memory>
+
+#include "logging.h"
+#include "threadpool.h"
+#include "mappedfile.h"
+#include "decompressor.h"
+#include "lefscanner.h"
+#include "lefindex.h"
+#include "padlib.h"
+#include "prefetcher.h"
+#include "lefloader.h"
+
+bool LEFLoader::load(const std::vector<std::string> &filenames)
+{
+    if (m_lazy)
+    {
+        return loadLazy(filenames);
+    }
+
+    if (!m_cacheFile.empty() && PadLib::read(m_cacheFile, filenames, m_db))
+    {
+        doLog(LOG_INFO, "Read %lu cells from LEF cache %s\n",
+            static_cast<unsigned long>(m_db.m_cells.size()), m_cacheFile.c_str());
+        return true;
+    }
+
+    m_states.clear();
+    if (!m_cacheFile.empty())
+    {
+        m_states.resize(filenames.size());
+    }
+
+    uint32_t jobs = (m_jobs == 0) ? ThreadPool::defaultThreadCount() : m_jobs;
+    bool ok = (jobs <= 1) ? loadSerial(filenames) : loadParallel(filenames, jobs);
+
+    // the geometry is complete, give back what it reserved to grow
+    m_db.m_geometry.shrinkToFit();
+
+    if (m_db.errorCount() > 0)
+    {
+        doLog(LOG_WARN, "%u errors in LEF input, the broken statements were skipped\n",
+            m_db.errorCount());
+    }
+
+    if (ok && !m_cacheFile.empty())
+    {
+        if (PadLib::write(m_cacheFile, filenames, m_states, m_db))
+        {
+            doLog(LOG_INFO, "Wrote LEF cache %s\n", m_cacheFile.c_str());
+        }
+        else
+        {
+            doLog(LOG_WARN, "Cannot write LEF cache %s\n", m_cacheFile.c_str());
+        }
+    }
+    return ok;
+}
+
+bool LEFLoader::loadSerial(const std::vector<std::string> &filenames)
+{
+    for(size_t i=0; i<filenames.size(); i++)
+    {
+        const std::string &leffile = filenames[i];
+        doLog(LOG_INFO, "Reading LEF %s\n", leffile.c_str());
+        MappedFile file;
+        bool ok = readFile(leffile, file, m_states.empty() ? nullptr : &m_states[i]) &&
+            m_db.parseFileData(file.data(), file.size());
+
+        if (!ok)
+        {
+            doLog(LOG_ERROR, "Cannot open LEF file %s\n", leffile.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LEFLoader::loadLazy(const std::vector<std::string> &filenames)
+{
+    for(auto const &leffile : filenames)
+    {
+        doLog(LOG_INFO, "Indexing LEF %s\n", leffile.c_str());
+        // the file is only hashed when its index is rewritten
+        std::unique_ptr<MappedFile> file(new MappedFile());
+        PadLib::fileState_t state = {};
+        if ((m_useIndex && !PadLib::fileStatus(leffile, state.m_size, state.m_mtime)) ||
+            !readFile(leffile, *file, nullptr) || !indexFile(leffile, std::move(file), state))
+        {
+            doLog(LOG_ERROR, "Cannot open LEF file %s\n", leffile.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LEFLoader::readFile(const std::string &filename, MappedFile &file, PadLib::fileState_t *state)
+{
+    if ((state != nullptr) && !PadLib::fileStatus(filename, state->m_size, state->m_mtime))
+    {
+        return false;
+    }
+
+    bool ok = (m_prefetcher != nullptr) ?
+        m_prefetcher->openRaw(filename, file) : file.open(filename);
+
+    if (ok && (state != nullptr))
+    {
+        state->m_hash = PadLib::hash(file.data(), file.size());
+    }
+    return ok;
+}
+
+bool LEFLoader::indexFile(const std::string &filename, std::unique_ptr<MappedFile> stored,
+    PadLib::fileState_t state)
+{
+    // indexed macros need random access, so compressed
+    // files are decompressed into memory.
+    std::unique_ptr<MappedFile> file;
+    if (detectCompression(stored->data(), stored->size()) == COMPRESSION_NONE)
+    {
+        file = std::move(stored);
+    }
+    else
+    {
+        file.reset(new MappedFile());
+        std::vector<char> contents;
+        if (!decompressBuffer(stored->data(), stored->size(), contents))
+        {
+            return false;
+        }
+        file->assign(std::move(contents));
+    }
+
+    if (!m_useIndex)
+    {
+        m_db.indexFile(std::move(file));
+        return true;
+    }
+
+    LEFIndex index;
+    const MappedFile &contents = stored ? *stored : *file;
+    if (index.read(filename, state, contents, file->size()))
+    {
+        m_db.indexFile(std::move(file), index.sections());
+        return true;
+    }
+
+    auto sections = LEFScanner::scan(file->data(), file->size());
+    const std::string indexFile = LEFIndex::indexFileName(filename);
+    state.m_hash = PadLib::hash(contents.data(), contents.size());
+    if (LEFIndex::write(filename, state, file->size(), sections))
+    {
+        doLog(LOG_INFO, "Wrote LEF index %s\n", indexFile.c_str());
+    }
+    else
+    {
+        doLog(LOG_WARN, "Cannot write LEF index %s\n", indexFile.c_str());
+    }
+    m_db.indexFile(std::move(file), sections);
+    return true;
+}
+
+std::vector<LEFLoader::range_t> LEFLoader::splitFile(const char *data, size_t bytes, uint32_t jobs) const
+{
+    std::vector<range_t> ranges;
+    if ((m_splitSize == 0) || (bytes <= m_splitSize))
+    {
+        ranges.push_back({0, bytes, 1});
+        return ranges;
+    }
+
+    // a few ranges per thread to balance the load
+    const size_t rangeSize = std::max(m_splitSize, bytes / (jobs*4));
+
+    range_t range = {0, bytes, 1};
+    for(auto const &section : LEFScanner::scan(data, bytes))
+    {
+        if ((section.m_type == LEFScanner::SEC_MACRO) &&
+            (section.m_begin - range.m_begin >= rangeSize))
+        {
+            range.m_end = section.m_begin;
+            ranges.push_back(range);
+            range = {section.m_begin, bytes, section.m_line};
+        }
+    }
+    ranges.push_back(range);
+
+    return ranges;
+}
+
+double LEFLoader::findDatabaseUnits(const char *data, size_t bytes)
+{
+    for(auto const &section : LEFScanner::scan(data, bytes, true))
+    {
+        if (section.m_type == LEFScanner::SEC_UNITS)
+        {
+            // errors are reported when the range
+            // holding the section is parsed.
+            LogCapture quiet;
+            quiet.start();
+            PRLEFReader reader;
+            reader.parse(data + section.m_begin, section.m_end - section.m_begin, section.m_line);
+            quiet.stop();
+            return reader.m_lefDatabaseUnits;
+        }
+    }
+    return 0.0;
+}
+
+bool LEFLoader::loadParallel(const std::vector<std::string> &filenames, uint32_t jobs)
+{
+    struct fileJob_t
+    {
+        MappedFile              m_file;
+        bool                    m_ok;
+        bool                    m_compressed;   ///< decompressed while parsing, not split
+        double                  m_databaseUnits;    ///< from the UNITS before the first MACRO, 0 if none
+        std::vector<range_t>    m_ranges;
+    };
+
+    struct rangeJob_t
+    {
+        rangeJob_t() : m_ok(true) {}
+
+        PRLEFReader m_reader;
+        LogCapture  m_log;
+        bool        m_ok;
+    };
+
+    std::vector<std::unique_ptr<fileJob_t> > fileJobs;
+    for(size_t i=0; i<filenames.size(); i++)
+    {
+        fileJobs.emplace_back(new fileJob_t());
+    }
+    std::vector<std::vector<std::unique_ptr<rangeJob_t> > > rangeJobs(filenames.size());
+
+    // note: the pool must be destroyed before the jobs
+    // so that no worker can touch a deleted job.
+    ThreadPool pool(jobs);
+
+    // map all files and find where they can be split
+    std::vector<std::future<void> > opened;
+    for(size_t i=0; i<filenames.size(); i++)
+    {
+        fileJob_t *job = fileJobs[i].get();
+        const std::string &filename = filenames[i];
+        PadLib::fileState_t *state = m_states.empty() ? nullptr : &m_states[i];
+        opened.push_back(pool.submit([this, job, &filename, state, jobs]()
+            {
+                job->m_databaseUnits = 0.0;
+                job->m_ok = readFile(filename, job->m_file, state);
+                job->m_compressed = job->m_ok &&
+                    (detectCompression(job->m_file.data(), job->m_file.size()) != COMPRESSION_NONE);
+
+                if (job->m_compressed)
+                {
+                    job->m_ranges.push_back({0, job->m_file.size(), 1});
+                }
+                else if (job->m_ok)
+                {
+                    job->m_databaseUnits = findDatabaseUnits(job->m_file.data(), job->m_file.size());
+                    job->m_ranges = splitFile(job->m_file.data(), job->m_file.size(), jobs);
+                }
+            }));
+    }
+
+    // parse the ranges of each file as soon as it is mapped,
+    // while later files are still being read.
+    //
+    // a range without UNITS, or a file that relies on the
+    // UNITS of an earlier one, needs the units in effect
+    // at its position to convert coordinates. The UNITS of
+    // compressed files are only known after parsing them,
+    // so a later file without UNITS of its own waits for
+    // the last compressed file before it.
+    double databaseUnits = m_db.m_lefDatabaseUnits;
+    rangeJob_t *compressedJob = nullptr;
+    std::future<void> *compressedDone = nullptr;
+    std::vector<std::vector<std::future<void> > > futures(filenames.size());
+    for(size_t i=0; i<filenames.size(); i++)
+    {
+        opened[i].get();
+        fileJob_t *file = fileJobs[i].get();
+        if (file->m_databaseUnits > 0.0)
+        {
+            databaseUnits = file->m_databaseUnits;
+            compressedJob = nullptr;
+        }
+        else if (compressedJob != nullptr)
+        {
+            compressedDone->wait();
+            if (compressedJob->m_reader.m_lefDatabaseUnits > 0.0)
+            {
+                databaseUnits = compressedJob->m_reader.m_lefDatabaseUnits;
+            }
+            compressedJob = nullptr;
+        }
+        file->m_databaseUnits = databaseUnits;
+
+        for(auto const &range : file->m_ranges)
+        {
+            rangeJobs[i].emplace_back(new rangeJob_t());
+            rangeJob_t *job = rangeJobs[i].back().get();
+            futures[i].push_back(pool.submit([job, file, range]()
+                {
+                    job->m_log.start();
+                    job->m_reader.deferCellLog(&job->m_log);
+                    job->m_reader.setDatabaseUnits(file->m_databaseUnits);
+                    if (file->m_compressed)
+                    {
+                        job->m_ok = job->m_reader.parseFileData(file->m_file.data(), file->m_file.size());
+                    }
+                    else
+                    {
+                        job->m_reader.parse(file->m_file.data() + range.m_begin,
+                            range.m_end - range.m_begin, range.m_line);
+                    }
+                    job->m_log.stop();
+                }));
+        }
+
+        if (file->m_compressed)
+        {
+            compressedJob = rangeJobs[i].back().get();
+            compressedDone = &futures[i].back();
+        }
+    }
+
+    // merge in command-line and file order as soon
+    // as each range is available.
+    for(size_t i=0; i<filenames.size(); i++)
+    {
+        doLog(LOG_INFO, "Reading LEF %s\n", filenames[i].c_str());
+        if (!fileJobs[i]->m_ok)
+        {
+            doLog(LOG_ERROR, "Cannot open LEF file %s\n", filenames[i].c_str());
+            return false;
+        }
+
+        for(size_t r=0; r<futures[i].size(); r++)
+        {
+            futures[i][r].get();
+            m_db.merge(rangeJobs[i][r]->m_reader, rangeJobs[i][r]->m_log);
+            if (!rangeJobs[i][r]->m_ok)
+            {
+                doLog(LOG_ERROR, "Cannot open LEF file %s\n", filenames[i].c_str());
+                return false;
+            }
+            rangeJobs[i][r].reset();
+        }
+    }
+
+    return true;
+}
@@ -17,7 +17,16 @@
     
 */
 
+#include <algorithm>
+#include <sstream>
+#include <string.h>
+#include "logging.h"
+#include "mappedfile.h"
+#include "decompressor.h"
+#include "numberparser.h"
+#include "keywords.h"
 #include "lefreader.h"
+#include "lefgrammar.h"
 
 bool LEFReader::isWhitespace(char c) const
 {
@@ -46,130 +55,199 @@ bool LEFReader::isAlphaNumeric(char c) const
 }
 
 
+bool LEFReader::fillBuffer(const char *&keep)
+{
+    if (m_is == nullptr)
+    {
+        return false;   // memory input: there is nothing more
+    }
+
+    // move the partially scanned token to the front
+    // of the chunk buffer and append the next chunk.
+    const size_t keepBytes = m_end - keep;
+    if (keepBytes + c_chunkSize > m_chunk.size())
+    {
+        std::vector<char> bigger(keepBytes + c_chunkSize);
+        std::copy(keep, m_end, bigger.begin());
+        m_chunk.swap(bigger);
+    }
+    else if (keepBytes > 0)
+    {
+        std::copy(keep, m_end, m_chunk.begin());
+    }
+
+    m_is->read(m_chunk.data() + keepBytes, c_chunkSize);
+    const size_t bytesRead = m_is->gcount();
+
+    keep    = m_chunk.data();
+    m_begin = m_chunk.data();
+    m_ptr   = m_chunk.data() + keepBytes;
+    m_end = m_ptr + bytesRead;
+
+    return (bytesRead > 0);
+}
+
 LEFReader::token_t LEFReader::tokenize(std::string &tokstr)
 {
-    tokstr.clear();
+    std::string_view tokview;
+    token_t tok = tokenize(tokview);
+    tokstr = tokview;
+    return tok;
+}
+
+LEFReader::token_t LEFReader::tokenize(std::string_view &tokstr)
+{
+    tokstr = std::string_view();
+    m_tokIsFixed = false;
 
-    while(isWhitespace(m_tokchar) && !m_is->eof())
+    const char *start = m_end;
+    int c = peekChar(start);
+    while(isWhitespace(c))
     {
-        m_tokchar = m_is->get();
+        m_ptr++;
+        c = peekChar(start);
     }
 
-    if (m_is->eof())
+    if (c < 0)
     {
         return TOK_EOF;
     }
 
-    if ((m_tokchar==10) || (m_tokchar==13))
+    start = m_ptr;
+    m_ptr++;
+
+    if ((c==10) || (c==13))
     {
-        m_tokchar = m_is->get();
         m_lineNum++;
         return TOK_EOL;
     }
 
-    if (m_tokchar=='#')
+    if (c=='#')
     {
-        m_tokchar = m_is->get();
         return TOK_HASH; 
     }
 
-    if (m_tokchar==';')
+    if (c==';')
     {
-        m_tokchar = m_is->get();
         return TOK_SEMICOL; 
     }
 
-    if (m_tokchar=='(')
+    if (c=='(')
     {
-        m_tokchar = m_is->get();
         return TOK_LPAREN;
     }
 
-    if (m_tokchar==')')
+    if (c==')')
     {
-        m_tokchar = m_is->get();
         return TOK_RPAREN;
     }
 
-    if (m_tokchar=='[')
+    if (c=='[')
     {
-        m_tokchar = m_is->get();
         return TOK_LBRACKET;
     }
 
-    if (m_tokchar==']')
+    if (c==']')
     {
-        m_tokchar = m_is->get();
         return TOK_RBRACKET;
     }
 
-    if (m_tokchar=='-')
+    if (c=='-')
     {
         // could be the start of a number
-        tokstr = m_tokchar;
-        m_tokchar = m_is->get();
-        if (isDigit(m_tokchar))
+        c = peekChar(start);
+        if (isDigit(c))
         {
             // it is indeed a number!
-            while(isDigit(m_tokchar) || (m_tokchar == '.') || (m_tokchar == 'e'))
-            {
-                tokstr += m_tokchar;
-                m_tokchar = m_is->get();
-            }
-            return TOK_NUMBER;            
+            return scanNumber(start, tokstr);
         }
+        tokstr = std::string_view(start, 1);
         return TOK_MINUS;
     }
 
-    if (isAlpha(m_tokchar))
+    if (isAlpha(c))
     {
-        tokstr = m_tokchar;
-        m_tokchar = m_is->get();
-        while(isAlphaNumeric(m_tokchar))
-        {            
-            tokstr += m_tokchar;
-            m_tokchar = m_is->get();
+        c = peekChar(start);
+        while(isAlphaNumeric(c))
+        {
+            m_ptr++;
+            c = peekChar(start);
         }
+        tokstr = std::string_view(start, m_ptr - start);
         return TOK_IDENT;
     }
 
-    if (m_tokchar=='"')
+    if (c=='"')
     {
-        m_tokchar = m_is->get();
-        while((m_tokchar != '"') && (m_tokchar != 10) && (m_tokchar != 13))
+        // the string contents start after the opening quotes
+        start = m_ptr;
+        c = peekChar(start);
+        while((c >= 0) && (c != '"') && (c != 10) && (c != 13))
         {
-            tokstr += m_tokchar;
-            m_tokchar = m_is->get();
+            m_ptr++;
+            c = peekChar(start);
         }
+        tokstr = std::string_view(start, m_ptr - start);
 
         // skip closing quotes
-        if (m_tokchar == '"')
+        if (c == '"')
         {
-            m_tokchar = m_is->get();
+            m_ptr++;
         }
 
         // error on newline
-        if ((m_tokchar == 10) || (m_tokchar == 13))
+        if ((c == 10) || (c == 13))
         {
             // TODO: error, string cannot continue after newline!
         }
         return TOK_STRING;
     }
 
-    if (isDigit(m_tokchar))
+    if (isDigit(c))
     {
-        tokstr = m_tokchar;
-        m_tokchar = m_is->get();
-        while(isDigit(m_tokchar) || (m_tokchar == '.') || (m_tokchar == 'e'))
+        m_ptr = start;
+        return scanNumber(start, tokstr);
+    }
+
+    return TOK_ERR;
+}
+
+LEFReader::token_t LEFReader::scanNumber(const char *&start, std::string_view &tokstr)
+{
+    // collect the value of a fixed-point number while scanning it,
+    // so tokenToNumber does not have to read the text again.
+    NumberParser::fixed_t &fixed = m_tokFixed;
+    fixed.m_mantissa   = 0;
+    fixed.m_fracDigits = 0;
+    fixed.m_negative   = (*start == '-');
+
+    uint32_t digits = 0;
+    bool seenDot = false;
+    bool isFixed = true;
+    int c = peekChar(start);
+    while(isDigit(c) || (c == '.') || (c == 'e'))
+    {
+        if (isDigit(c))
+        {
+            isFixed = isFixed && (++digits <= 18);
+            if (isFixed)
+            {
+                fixed.m_mantissa = fixed.m_mantissa*10 + (c - '0');
+                fixed.m_fracDigits += seenDot ? 1 : 0;
+            }
+        }
+        else
         {
-            tokstr += m_tokchar;
-            m_tokchar = m_is->get();
+            isFixed = isFixed && (c == '.') && !seenDot;
+            seenDot = true;
         }
-        return TOK_NUMBER;
+        m_ptr++;
+        c = peekChar(start);
     }
 
-    m_tokchar = m_is->get();
-    return TOK_ERR;
+    tokstr = std::string_view(start, m_ptr - start);
+    m_tokIsFixed = isFixed;
+    return TOK_NUMBER;
 }
 
 void LEFReader::parse(std::istream &lefstream)
@@ -182,10 +260,66 @@ void LEFReader::parse(std::istream &lefstream)
         return;
     }
 
-    m_is = &lefstream;
-    
-    m_tokchar = m_is->get();
+    m_is    = &lefstream;
+    m_begin = nullptr;
+    m_ptr   = nullptr;
+    m_end   = nullptr;
+
+    doParse();
+
+    m_is = nullptr;
+    m_chunk.clear();
+    m_chunk.shrink_to_fit();
+}
+
+void LEFReader::parse(const char *data, size_t bytes, uint32_t firstLine)
+{
+    m_lineNum = firstLine;
+    m_is    = nullptr;
+    m_begin = data;
+    m_ptr   = data;
+    m_end   = data + bytes;
+
+    doParse();
+}
+
+bool LEFReader::parseFile(const std::string &filename)
+{
+    MappedFile lefFile;
+    if (!lefFile.open(filename))
+    {
+        return false;
+    }
+
+    return parseFileData(lefFile.data(), lefFile.size());
+}
+
+bool LEFReader::parseFileData(const char *data, size_t bytes)
+{
+    compression_t type = detectCompression(data, bytes);
+    if (type == COMPRESSION_NONE)
+    {
+        parse(data, bytes);
+        return true;
+    }
+
+    if (!isCompressionSupported(type))
+    {
+        doLog(LOG_ERROR, "LEF data is %s compressed, but padring was built without %s support\n",
+            compressionName(type), compressionName(type));
+        return false;
+    }
 
+    // decode in chunks instead of holding the whole file
+    MemoryStream source(data, bytes);
+    DecompressingBuffer decompressor(source, type);
+    std::istream is(&decompressor);
+    parse(is);
+    return !decompressor.failed();
+}
+
+void LEFReader::doParse()
+{
     bool m_inComment = false;
     
     m_curtok = TOK_EOF;
@@ -198,34 +332,44 @@ void LEFReader::parse(std::istream &lefstream)
             {
             case TOK_ERR:
                 error("LEF parse error\n");
+                resync();
                 break;
             case TOK_HASH:  // line comment
                 m_inComment = true;
                 break;
             case TOK_IDENT:
-                if (m_tokstr == "MACRO")
-                {
-                    parseMacro();
-                }
-                else if (m_tokstr == "LAYER")
-                {
-                    parseLayer();
-                }
-                else if (m_tokstr == "VIA")
-                {
-                    parseVia();
-                }
-                else if (m_tokstr == "VIARULE")
-                {
-                    parseViaRule();
-                }
-                else if (m_tokstr == "UNITS")
-                {
-                    parseUnits();
-                }
-                else if (m_tokstr == "PROPERTYDEFINITIONS")
                 {
-                    parsePropertyDefintions();
+                    bool ok = true;
+                    switch(Keywords::lookup(m_tokstr))
+                    {
+                    case KW_MACRO:
+                        ok = parseMacro();
+                        break;
+                    case KW_LAYER:
+                        ok = parseLayer();
+                        break;
+                    case KW_VIA:
+                        ok = parseVia();
+                        break;
+                    case KW_VIARULE:
+                        ok = parseViaRule();
+                        break;
+                    case KW_UNITS:
+                        ok = parseUnits();
+                        break;
+                    case KW_PROPERTYDEFINITIONS:
+                        ok = parsePropertyDefintions();
+                        break;
+                    default:
+                        ;
+                    }
+
+                    // skip the rest of a broken statement instead of
+                    // reading its contents as top-level statements
+                    if (!ok)
+                    {
+                        resync();
+                    }
                 }
                 break;
             default:
@@ -246,7 +390,256 @@ void LEFReader::parse(std::istream &lefstream)
 
 void LEFReader::error(const std::string &errstr)
 {
-    std::cerr << "Line " << m_lineNum << " : " << errstr; 
+    // a damaged file must not flood the log
+    m_errorCount++;
+    if (m_errorCount > c_maxReportedErrors)
+    {
+        return;
+    }
+
+    std::stringstream ss;
+    ss << "Line " << m_lineNum << " : " << errstr;
+    doLog(LOG_ERROR, "%s", ss.str().c_str());
+
+    if (m_errorCount == c_maxReportedErrors)
+    {
+        doLog(LOG_ERROR, "Too many LEF errors, further errors are counted but not reported\n");
+    }
+}
+
+bool LEFReader::tokenToNumber(double &value)
+{
+    if (m_tokIsFixed && NumberParser::fixedToDouble(m_tokFixed, value))
+    {
+        return true;
+    }
+
+    if (!NumberParser::toDouble(m_tokstr, value))
+    {
+        error("Invalid number " + std::string(m_tokstr) + "\n");
+        return false;
+    }
+    return true;
+}
+
+bool LEFReader::tokenToNumber(double &value, int64_t &dbu)
+{
+    dbu = 0;
+    if (m_tokIsFixed && NumberParser::fixedToNumber(m_tokFixed, m_databaseUnits, value, dbu))
+    {
+        return true;
+    }
+
+    if (!NumberParser::toNumber(m_tokstr, m_databaseUnits, value, dbu))
+    {
+        error("Invalid number " + std::string(m_tokstr) + "\n");
+        return false;
+    }
+    return true;
+}
+
+bool LEFReader::matches(const LEFGrammar::arg_t &arg) const
+{
+    using namespace LEFGrammar;
+    switch(arg.m_type)
+    {
+    case EL_NUMBER:
+    case EL_NUMBER_DBU:
+    case EL_SKIP_NUMBER:
+        return m_curtok == TOK_NUMBER;
+    case EL_WORD:
+    case EL_WORDS:
+    case EL_SKIP_WORD:
+        return m_curtok == TOK_IDENT;
+    case EL_LITERAL:
+    case EL_APPEND_LITERAL:
+        return (m_curtok == TOK_IDENT) && (m_tokstr == arg.m_literal);
+    case EL_SEMICOL:
+        return m_curtok == TOK_SEMICOL;
+    case EL_EOL:
+        return m_curtok == TOK_EOL;
+    default:
+        return true;
+    }
+}
+
+bool LEFReader::parseStatement(const LEFGrammar::statement_t &statement)
+{
+    // one parser per statement, generated from the table
+    using parser_t = bool (LEFReader::*)();
+    static constexpr auto c_parsers = []<size_t... I>(std::index_sequence<I...>)
+        {
+            return std::array<parser_t, sizeof...(I)>{ &LEFReader::parseStatement<I>... };
+        }(std::make_index_sequence<LEFGrammar::c_statementCount>());
+
+    return (this->*c_parsers[&statement - LEFGrammar::c_statements])();
+}
+
+template<size_t I> bool LEFReader::parseStatement()
+{
+    using namespace LEFGrammar;
+    constexpr const statement_t &statement = c_statements[I];
+
+    // the arguments are checked even if nobody wants them,
+    // but they are only converted and copied for the action.
+    const bool wanted = (statement.m_callbacks == 0) || ((m_callbacks & statement.m_callbacks) != 0);
+
+    values_t values;
+    values.m_hasDBU = (m_databaseUnits > 0.0);
+    if constexpr (hasText(statement))
+    {
+        if (wanted)
+        {
+            m_text.clear();
+        }
+    }
+
+    m_curtok = tokenize(m_tokstr);
+    if (!parseElements<I, 0>(values, wanted))
+    {
+        return false;
+    }
+
+    if (wanted)
+    {
+        values.m_text = m_text;
+        statement.m_action(*this, values);
+    }
+    return true;
+}
+
+template<size_t I, size_t E> bool LEFReader::parseElements(LEFGrammar::values_t &values, bool wanted)
+{
+    using namespace LEFGrammar;
+    constexpr const statement_t &statement = c_statements[I];
+    constexpr element_t type = statement.m_args[E].m_type;
+    const std::string_view literal = statement.m_args[E].m_literal;
+
+    // m_curtok is the first token the element has not seen
+    if constexpr (type == EL_END)
+    {
+        return true;
+    }
+    else if constexpr (type == EL_OPTIONAL)
+    {
+        if (!matches(statement.m_args[E+1]))
+        {
+            return parseElements<I, optionalEnd(statement, E) + 1>(values, wanted);
+        }
+        return parseElements<I, E+1>(values, wanted);
+    }
+    else if constexpr (type == EL_OPTIONAL_END)
+    {
+        return parseElements<I, E+1>(values, wanted);
+    }
+    else if constexpr ((type == EL_WORDS) || (type == EL_ANY_WORDS))
+    {
+        if ((type == EL_WORDS) && (m_curtok != TOK_IDENT))
+        {
+            return statementError(statement, "an identifier");
+        }
+        while(m_curtok == TOK_IDENT)
+        {
+            if (wanted)
+            {
+                m_text += m_tokstr;
+                m_text += " ";
+            }
+            m_curtok = tokenize(m_tokstr);
+        }
+
+        // the token after the words is the next element's
+        return parseElements<I, E+1>(values, wanted);
+    }
+    else
+    {
+        if constexpr ((type == EL_NUMBER) || (type == EL_NUMBER_DBU) ||
+            (type == EL_SKIP_NUMBER))
+        {
+            if (m_curtok != TOK_NUMBER)
+            {
+                return statementError(statement, "a number");
+            }
+
+            constexpr size_t index = numberIndex(statement, E);
+            if constexpr (type == EL_NUMBER)
+            {
+                if (wanted && !tokenToNumber(values.m_number[index]))
+                {
+                    return false;
+                }
+            }
+            else if constexpr (type == EL_NUMBER_DBU)
+            {
+                if (wanted && !tokenToNumber(values.m_number[index], values.m_dbu[index]))
+                {
+                    return false;
+                }
+            }
+        }
+        else if constexpr ((type == EL_WORD) || (type == EL_SKIP_WORD))
+        {
+            if (m_curtok != TOK_IDENT)
+            {
+                return statementError(statement, "an identifier");
+            }
+            if (wanted && (type == EL_WORD))
+            {
+                m_text = m_tokstr;
+            }
+        }
+        else if constexpr ((type == EL_LITERAL) || (type == EL_APPEND_LITERAL))
+        {
+            if ((m_curtok != TOK_IDENT) || (m_tokstr != literal))
+            {
+                return statementError(statement, "'" + std::string(literal) + "'");
+            }
+            if (wanted && (type == EL_APPEND_LITERAL))
+            {
+                m_text += " ";
+                m_text += literal;
+            }
+        }
+        else if constexpr (type == EL_SKIP_TO_SEMICOL)
+        {
+            while(m_curtok != TOK_SEMICOL)
+            {
+                if ((m_curtok == TOK_EOL) || (m_curtok == TOK_EOF))
+                {
+                    return statementError(statement, "a semicolon");
+                }
+                m_curtok = tokenize(m_tokstr);
+            }
+        }
+        else if constexpr (type == EL_SEMICOL)
+        {
+            if (m_curtok != TOK_SEMICOL)
+            {
+                return statementError(statement, "a semicolon");
+            }
+        }
+        else if constexpr (type == EL_EOL)
+        {
+            if (m_curtok != TOK_EOL)
+            {
+                return statementError(statement, "EOL");
+            }
+        }
+
+        // the last element keeps its token, like the
+        // semicolon that ends most statements.
+        if constexpr (statement.m_args[E+1].m_type != EL_END)
+        {
+            m_curtok = tokenize(m_tokstr);
+        }
+        return parseElements<I, E+1>(values, wanted);
+    }
+}
+
+bool LEFReader::statementError(const LEFGrammar::statement_t &statement, const std::string &expected)
+{
+    error("Expected " + expected + " in " + std::string(Keywords::name(statement.m_keyword)) + "\n");
+    return false;
 }
 
 bool LEFReader::parseMacro()
@@ -272,7 +665,10 @@ bool LEFReader::parseMacro()
         return false;
     }
 
-    onMacro(name);
+    if (wants(CB_MACRO))
+    {
+        onMacro(name);
+    }
 
     // wait for 'END macroname'
     bool endFound = false;
@@ -282,38 +678,42 @@ bool LEFReader::parseMacro()
 
         if (m_curtok == TOK_IDENT)
         {
-            if (m_tokstr == "PIN")
-            {
-                parsePin();
-            }
-            else if (m_tokstr == "CLASS")
-            {
-                parseClass();
-            }            
-            else if (m_tokstr == "ORIGIN")
-            {
-                parseOrigin();
-            }
-            else if (m_tokstr == "FOREIGN")
-            {
-                parseForeign();
-            }
-            else if (m_tokstr == "SIZE")
+            bool ok = true;
+            const keyword_t kw = Keywords::lookup(m_tokstr);
+            const LEFGrammar::statement_t *statement = LEFGrammar::find(LEFGrammar::CTX_MACRO, kw);
+            if (statement != nullptr)
             {
-                parseSize();
+                ok = parseStatement(*statement);
             }
-            else if (m_tokstr == "SYMMETRY")
+            else switch(kw)
             {
-                parseSymmetry();
+            case KW_PIN:
+                ok = parsePin();
+                break;
+            case KW_OBS:
+                ok = parseObs();
+                break;
+            case KW_MACRO:
+                if (!endFound)
+                {
+                    // END <name> is missing: leave the
+                    // next macro to the top-level parser
+                    error("Expected END " + name + " before MACRO\n");
+                    m_ptr = m_tokstr.data();
+                    return false;
+                }
+                break;
+            //case KW_LAYER:
+            //    parseLayer();   // TECH LEF layer, not a port LAYER!
+            //    break;
+            default:
+                ;
             }
-            else if (m_tokstr == "SITE")
+
+            if (!ok)
             {
-                parseSite();
+                return false;
             }
-            //else if (m_tokstr == "LAYER")
-            //{
-            //    parseLayer();   // TECH LEF layer, not a port LAYER!
-            //}  
         }
 
         if (endFound)
@@ -333,7 +733,7 @@ bool LEFReader::parseMacro()
             endFound = false;
         }
 
-        if (m_is->eof())
+        if (atEOF())
         {
             error("Unexpected end of file\n");
             return false;
@@ -361,7 +761,7 @@ bool LEFReader::parsePinName(std::string &outName)
             error("Expected a number in pin brackets");
             return false;
         }
-        auto numstr = m_tokstr;
+        std::string numstr(m_tokstr);
         
         m_curtok = tokenize(m_tokstr);
         if (m_curtok != TOK_RBRACKET)
@@ -395,9 +795,10 @@ bool LEFReader::parsePin()
         return false;
     }
 
-    std::cout << "  PIN: " << name << "\n";
-
-    onPin(name);
+    if (wants(CB_PIN))
+    {
+        onPin(name);
+    }
 
     while(true)
     {
@@ -405,25 +806,37 @@ bool LEFReader::parsePin()
 
         if (m_curtok == TOK_IDENT)
         {
-            if (m_tokstr == "DIRECTION")
+            const keyword_t kw = Keywords::lookup(m_tokstr);
+            const LEFGrammar::statement_t *statement = LEFGrammar::find(LEFGrammar::CTX_PIN, kw);
+            if (statement != nullptr)
             {
-                parseDirection();
+                if (!parseStatement(*statement))
+                {
+                    return false;
+                }
             }
-            else if (m_tokstr == "USE")
+            else if (kw == KW_PORT)
             {
-                parseUse();
-            }            
-            else if (m_tokstr == "PORT")
+                if (!parsePort())
+                {
+                    return false;
+                }
+            }
+            else if (kw == KW_MACRO)
             {
-                parsePort();
+                // END <pin name> is missing: leave the
+                // next macro to the top-level parser
+                error("Expected END " + name + " before MACRO\n");
+                m_ptr = m_tokstr.data();
+                return false;
             }
-            else if (m_tokstr == "END")
+            else if (kw == KW_END)
             {
                 std::string endName;
                 if (!parsePinName(endName))
                 {
                     std::stringstream ss;
-                    ss << "Expected pin name " << endName << "\n";
+                    ss << "Expected pin name " << name << "\n";
                     error(ss.str());
                     return false;
                 }
@@ -431,7 +844,7 @@ bool LEFReader::parsePin()
                 if (endName != name)
                 {
                     std::stringstream ss;
-                    ss << "Expected pin name " << endName << "\n";
+                    ss << "Expected pin name " << name << "\n";
                     error(ss.str());
                     return false;
                 }
@@ -446,7 +859,7 @@ bool LEFReader::parsePin()
             }           
         }
 
-        if (m_is->eof())
+        if (atEOF())
         {
             error("Unexpected end of file\n");
             return false;
@@ -455,474 +868,112 @@ bool LEFReader::parsePin()
 }
 
 
-bool LEFReader::parseClass()
+bool LEFReader::parsePort()
 {
-    // CLASS name <optional name> ';'
-
-    std::string className;
-    
-
-    // read in all the classes
-    bool foundOne = false;
+    // PORT EOL <geometry> END
     m_curtok = tokenize(m_tokstr);
-    while(m_curtok == TOK_IDENT)
-    {
-        foundOne = true;
-        className += m_tokstr;
-        className += " ";
-        m_curtok = tokenize(m_tokstr);
-    }
-    if (!foundOne)
-    {
-        error("Expected at least one class\n");
-        return false;
-    }
-    
-    if (m_curtok != TOK_SEMICOL)
+    if (m_curtok != TOK_EOL)
     {
-        error("Expected a semicolon\n");
+        error("Expected EOL\n");
         return false;
     }
 
-    onClass(className);
-
-    return true;
-};
+    return parseGeometry();
+}
 
-bool LEFReader::parseOrigin()
+bool LEFReader::parseObs()
 {
-    // ORIGIN <number> <number> ; 
-
-    
-    std::string xnum;
-    std::string ynum;
-
-    m_curtok = tokenize(xnum);
-    if (m_curtok != TOK_NUMBER)
-    {
-        error("Expected a number\n");
-        return false;
-    }
-
-    m_curtok = tokenize(ynum);
-    if (m_curtok != TOK_NUMBER)
-    {
-        error("Expected a number\n");
-        return false;
-    }
-
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon\n");
-        return false;
-    }
-
-    double xnumd, ynumd;
-    try
-    {
-        xnumd = std::stod(xnum);
-        ynumd = std::stod(ynum);
-    }
-    catch(const std::invalid_argument& ia)
-    {
-        error(ia.what());
-    }
-
-    onOrigin(xnumd, ynumd);
-
-    //std::cout << "  ORIGIN " << xnum << " " << ynum << "\n";
-
-    return true;
-};
-
-bool LEFReader::parseSite()
-{
-    // SITE name ';' 
-
-    std::string siteName;
-    
-
-    m_curtok = tokenize(siteName);
-    if (m_curtok != TOK_IDENT)
-    {
-        error("Expected an identifier\n");
-        return false;
-    }
-
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon\n");
-        return false;
-    }
-
-    onSite(siteName);
-
-    //std::cout << "  SITE " << siteName << "\n";
-
-    return true;
-};
-
-bool LEFReader::parseSize()
-{
-    // SIZE <number> BY <number> ';' 
-
-    
-    std::string xnum;
-    std::string ynum;
-
-    m_curtok = tokenize(xnum);
-    if (m_curtok != TOK_NUMBER)
-    {
-        error("Expected a number\n");
-        return false;
-    }
-
-    m_curtok = tokenize(m_tokstr);
-    if ((m_curtok != TOK_IDENT) && (m_tokstr != "BY"))
-    {
-        error("Expected 'BY'\n");
-        return false;
-    }
-
-    m_curtok = tokenize(ynum);
-    if (m_curtok != TOK_NUMBER)
-    {
-        error("Expected a number\n");
-        return false;
-    }
-
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon\n");
-        return false;
-    }
-
-    double xnumd, ynumd;
-    try
-    {
-        xnumd = std::stod(xnum);
-        ynumd = std::stod(ynum);
-    }
-    catch(const std::invalid_argument& ia)
-    {
-        error(ia.what());
-    }
-
-    onSize(xnumd, ynumd);
-
-    //std::cout << "  SIZE " << xnum << " " << ynum << "\n";
-
-    return true;
-};
-
-bool LEFReader::parseSymmetry()
-{
-    // SYMMETRY (X|Y|R90)+ ';' 
-
-    
-    std::string symmetry;
-
-    // read options until we get to the semicolon.
+    // OBS EOL <geometry> END
     m_curtok = tokenize(m_tokstr);
-    while(m_curtok!= TOK_SEMICOL)
-    {
-        symmetry += m_tokstr;
-        symmetry += " ";
-        m_curtok = tokenize(m_tokstr);
-    }
-
-    //std::cout << "  SYMMETRY " << symmetry << "\n";
-
-    return true;
-};
-
-bool LEFReader::parseForeign()
-{
-    // FOREIGN <cellname> [<number> <number>] ; 
-
-    std::string cellname;
-    std::string xnum;
-    std::string ynum;
-
-    m_curtok = tokenize(cellname);
-    if (m_curtok != TOK_IDENT)
+    if (m_curtok != TOK_EOL)
     {
-        error("Expected the cell name\n");
+        error("Expected EOL\n");
         return false;
     }
 
-    // foreign point is optional
-
-    m_curtok = tokenize(xnum);
-    if (m_curtok == TOK_NUMBER)
+    if (wants(CB_GEOMETRY))
     {
-        m_curtok = tokenize(ynum);
-        if (m_curtok != TOK_NUMBER)
-        {
-            error("Expected a number\n");
-            return false;
-        }
-
-        m_curtok = tokenize(m_tokstr);
-        if (m_curtok != TOK_SEMICOL)
-        {
-            error("Expected a semicolon\n");
-            return false;
-        }
-
-        double xnumd, ynumd;
-        try
-        {
-            xnumd = std::stod(xnum);
-            ynumd = std::stod(ynum);
-        }
-        catch(const std::invalid_argument& ia)
-        {
-            error(ia.what());
-        }
-
-        onForeign(cellname, xnumd, ynumd);
-        return true;
+        onObstruction();
     }
-    else if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a number or semicolon\n");
-        return false;
-    }    
-
-    onForeign(cellname, 0, 0);
-
-    return true;
-};
 
+    return parseGeometry();
+}
 
-bool LEFReader::parseDirection()
+bool LEFReader::parseGeometry()
 {
-    // DIRECTION OUTPUT/INPUT/INOUT etc.
-    std::string direction;
-
-    // read options until we get to the semicolon.
-    m_curtok = tokenize(direction);
-    if (m_curtok != TOK_IDENT)
-    {
-        error("Expected direction\n");
-        return false;
-    }
-
-    m_curtok = tokenize(m_tokstr);
-    if ((direction == "OUTPUT") && (m_tokstr == "TRISTATE"))
+    // ( LAYER <name> ... ';' ( RECT ... ';' | <other> ... ';' )* )* END
+    while(true)
     {
-        // OUTPUT can be followed by TRISTATE
-        // FIXME: use enum.
-        direction += " TRISTATE";
         m_curtok = tokenize(m_tokstr);
-    }
-
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon\n");
-        return false;
-    }    
-
-    onPinDirection(direction);
-
-    return true;
-};
-
-bool LEFReader::parseUse()
-{
-    // USE OUTPUT/INPUT/INOUT etc.
-
-    std::string use;
-
-    m_curtok = tokenize(use);
-    if (m_curtok != TOK_IDENT)
-    {
-        error("Expected use\n");
-        return false;
-    }
-
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon\n");
-        return false;
-    }    
-
-    onPinUse(use);
-
-    return true;
-};
-
-bool LEFReader::parsePort()
-{
-    std::string name;
-    
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected EOL\n");
-        return false;
-    }
-
-    // expect LAYER
-    m_curtok = tokenize(m_tokstr);
-    while (m_curtok == TOK_IDENT)
-    {
-        if (m_tokstr == "LAYER")
-        {
-            parsePortLayer();
-        }
-        else if (m_tokstr == "END")
-        {
-            break;
-        }
-        else
+        if (m_curtok == TOK_IDENT)
         {
-            // eat until ;
-            do
+            const keyword_t kw = Keywords::lookup(m_tokstr);
+            const LEFGrammar::statement_t *statement = LEFGrammar::find(LEFGrammar::CTX_GEOMETRY, kw);
+            if (statement != nullptr)
             {
-                m_curtok = tokenize(m_tokstr);
-            } while(m_curtok != TOK_SEMICOL);
-
-            // eat newline
-            m_curtok = tokenize(m_tokstr);
-            if (m_curtok != TOK_EOL)
+                if (!parseStatement(*statement))
+                {
+                    return false;
+                }
+            }
+            else if (kw == KW_END)
             {
-                error("Expected EOL");
-                return false;
+                return true;
+            }
+            else
+            {
+                // POLYGON, PATH, VIA, WIDTH etc. are not used,
+                // eat until ;
+                do
+                {
+                    m_curtok = tokenize(m_tokstr);
+                } while((m_curtok != TOK_SEMICOL) && (m_curtok != TOK_EOF));
             }
         }
 
-        if (m_is->eof())
+        if (m_curtok == TOK_EOF)
         {
             error("Unexpected end of file\n");
             return false;
         }
     }
-    return true;
 }
 
-bool LEFReader::parsePortLayer()
+bool LEFReader::parseLayer()
 {
-    // LAYER <name> ';'
-    std::string name;
+    m_curtok = tokenize(m_tokstr);
+    std::string layerName(m_tokstr);
 
-    m_curtok = tokenize(name);
     if (m_curtok != TOK_IDENT)
     {
-        error("Expected layer name\n");
+        error("Expected a layer name\n");
         return false;
     }
 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon\n");
-        return false;
-    }    
-
+    // expect EOL
     m_curtok = tokenize(m_tokstr);
     if (m_curtok != TOK_EOL)
     {
-        error("Expected an EOL\n");
-        return false;
-    }    
-
-    //std::cout << "    LAYER " << name << "\n";
-
-    do
-    {
-        if (!parsePortLayerItem())
-        {
-            return false;
-        }
-    } while(m_tokstr != "END");
-    
-    return true;
-}
-
-bool LEFReader::parsePortLayerItem()
-{
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_IDENT)
-    {
-        error("Expected RECT or END\n");
+        error("Expected EOL in LAYER\n");
         return false;
     }
 
-    while(1)
+    if (!wants(CB_LAYER))
     {
-        if (m_tokstr == "END")
-        {
-            return true;
-        }
-        else if (m_tokstr == "RECT")
+        // nobody is interested in the layer items
+        if (!skipToEnd(layerName))
         {
-            parseRect();
+            error("Unexpected end of file in LAYER\n");
+            return false;
         }
-        m_curtok = tokenize(m_tokstr);
-    }
-}
-
-bool LEFReader::parseRect()
-{
-    
-    std::string coords;
 
-    for(uint32_t i=0; i<4; i++)
-    {
         m_curtok = tokenize(m_tokstr);
-        if (m_curtok != TOK_NUMBER)
+        if (m_curtok != TOK_EOL)
         {
-            error("Expected number in RECT\n");
+            error("Expected EOL\n");
             return false;
         }
-        coords += m_tokstr;
-        coords += " ";
-    }
-
-    // expect ; 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon in RECT\n");
-        return false;
-    }
-
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected an EOL in RECT\n");
-        return false;
-    }    
-
-    //std::cout << "      RECT " << coords << "\n";
-
-    return true;
-}
-
-bool LEFReader::parseLayer()
-{
-    m_curtok = tokenize(m_tokstr);
-    std::string layerName = m_tokstr;
-
-    if (m_curtok != TOK_IDENT)
-    {
-        error("Expected a layer name\n");
-        return false;
-    }
-
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected EOL in LAYER\n");
-        return false;
+        return true;
     }
 
     onLayer(layerName);
@@ -964,38 +1015,21 @@ bool LEFReader::parseLayerItem()
     m_curtok = tokenize(m_tokstr);
     if (m_curtok != TOK_IDENT)
     {
+        if (m_curtok == TOK_EOL)
+        {
+            return true;    // empty line
+        }
         error("Expected identifier in layer item\n");
         return false;
     }
-    if (m_tokstr == "PITCH")
+    const keyword_t kw = Keywords::lookup(m_tokstr);
+    const LEFGrammar::statement_t *statement = LEFGrammar::find(LEFGrammar::CTX_LAYER, kw);
+    if (statement != nullptr)
     {
-        return parseLayerPitch();   
+        return parseStatement(*statement);
     }
-    else if (m_tokstr == "OFFSET")
-    {
-        return parseLayerOffset();
-    }
-    else if (m_tokstr == "TYPE")
-    {
-        return parseLayerType();
-    }    
-    else if (m_tokstr == "DIRECTION")
-    {
-        return parseLayerDirection();
-    }
-    else if (m_tokstr == "WIDTH")
-    {
-        return parseLayerWidth();
-    }    
-    else if (m_tokstr == "MAXWIDTH")
-    {
-        return parseLayerMaxWidth();
-    }        
-    else if (m_tokstr == "END")
-    {
-        return true;
-    }
-    else
+
+    if (kw != KW_END)
     {
         // eat everything on the line
         while((m_curtok != TOK_EOL) && (m_curtok != TOK_EOF))
@@ -1012,252 +1046,168 @@ bool LEFReader::parseLayerItem()
     return true;
 }
 
-bool LEFReader::parseLayerPitch()
+size_t LEFReader::countLines(const char *begin, const char *end)
 {
-    std::string pitch;
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_NUMBER)
+    // the tokenizer counts every CR and LF as a line,
+    // so a CR LF pair counts twice. Lone CRs are rare
+    // enough to ignore, as LEFScanner does.
+    size_t lines = 0;
+    const char *p = begin;
+    while((p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr)
     {
-        error("Expected a number in layer pitch\n");
-        return false;    
+        lines += ((p > begin) && (p[-1] == '\r')) ? 2 : 1;
+        p++;
     }
-
-    pitch = m_tokstr;
-
-    // expect ; 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon in layer pitch\n");
-        return false;
-    }
-
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected an EOL\n");
-        return false;
-    }
-
-    double pitchd;
-    try
-    {
-        pitchd = std::stod(pitch);
-    }
-    catch(const std::invalid_argument& ia)
-    {
-        error(ia.what());
-    }
-
-    onLayerPitch(pitchd);
-
-    return true;    
+    return lines;
 }
 
-bool LEFReader::parseLayerOffset()
+bool LEFReader::completeLines(const char *&limit)
 {
-    std::string offset;
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_NUMBER)
-    {
-        error("Expected a number in layer offset\n");
-        return false;    
-    }
-
-    offset = m_tokstr;
-
-    // expect ; 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
+    while(true)
     {
-        error("Expected a semicolon in layer offset\n");
-        return false;
-    }
+        limit = m_end;
+        while((limit > m_ptr) && (limit[-1] != '\n'))
+        {
+            limit--;
+        }
 
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected an EOL\n");
-        return false;
-    }
+        if (limit > m_ptr)
+        {
+            return true;
+        }
 
-    double offsetd;
-    try
-    {
-        offsetd = std::stod(offset);
-    }
-    catch(const std::invalid_argument& ia)
-    {
-        error(ia.what());
+        // no complete line left: read more, keeping the partial line
+        const char *keep = m_ptr;
+        const bool more = fillBuffer(keep);
+        m_ptr = keep;
+        if (!more)
+        {
+            limit = m_end;
+            return (m_ptr < m_end);
+        }
     }
-
-    onLayerOffset(offsetd);
-
-    return true;    
 }
 
-bool LEFReader::parseLayerType()
+bool LEFReader::skipToEnd(const std::string &name)
 {
-    std::string layerType;
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_IDENT)
-    {
-        error("Expected a string in layer type\n");
-        return false;    
-    }
+    // Search the raw buffer for 'END <name>' instead of tokenizing
+    // the block. Only complete lines are searched, so a match can
+    // never straddle a stream buffer refill.
+    const char *limit;
+    while(completeLines(limit))
+    {
+        std::string_view region(m_ptr, limit - m_ptr);
+        size_t pos = region.find("END");
+        while(pos != std::string_view::npos)
+        {
+            const char *hit = m_ptr + pos;
+            const char *q   = hit + 3;
 
-    layerType = m_tokstr;
+            // END must be a word of its own and not part of a string
+            bool match = (hit == m_ptr) ||
+                (!isAlphaNumeric(hit[-1]) && (hit[-1] != '"'));
 
-    // expect ; 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon in layer type\n");
-        return false;
-    }
-
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected an EOL\n");
-        return false;
-    }
+            if (match && (q < limit) && isWhitespace(*q))
+            {
+                while((q < limit) && isWhitespace(*q))
+                {
+                    q++;
+                }
 
-    onLayerType(layerType);
+                if ((static_cast<size_t>(limit - q) >= name.size()) &&
+                    (memcmp(q, name.data(), name.size()) == 0))
+                {
+                    q += name.size();
+                    if ((q == limit) || !isAlphaNumeric(*q))
+                    {
+                        m_lineNum += countLines(m_ptr, hit);
+                        m_ptr = q;
+                        return true;
+                    }
+                }
+            }
+            pos = region.find("END", pos + 3);
+        }
 
-    return true;    
+        m_lineNum += countLines(m_ptr, limit);
+        m_ptr = limit;
+    }
+    return false;
 }
 
-bool LEFReader::parseLayerWidth()
+bool LEFReader::atLineStart() const
 {
-    std::string width;
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_NUMBER)
-    {
-        error("Expected a number in layer width\n");
-        return false;    
-    }
-
-    width = m_tokstr;
-
-    // expect ; 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon in layer width\n");
-        return false;
-    }
-
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected an EOL\n");
-        return false;
-    }
-
-    double widthd;
-    try
-    {
-        widthd = std::stod(width);
-    }
-    catch(const std::invalid_argument& ia)
+    const char *p = m_ptr;
+    while((p > m_begin) && isWhitespace(p[-1]))
     {
-        error(ia.what());
+        p--;
     }
-
-    onLayerWidth(widthd);
-
-    return true;    
+    return (p == m_begin) || (p[-1] == '\n') || (p[-1] == '\r');
 }
 
-bool LEFReader::parseLayerMaxWidth()
+bool LEFReader::isStatementStart(const char *begin, const char *end)
 {
-    std::string maxwidth;
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_NUMBER)
+    const char *p = begin;
+    while((p < end) && ((*p == ' ') || (*p == '\t')))
     {
-        error("Expected a number in layer max width\n");
-        return false;    
+        p++;
     }
 
-    maxwidth = m_tokstr;
-
-    // expect ; 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
+    const char *word = p;
+    while((p < end) && (*p != ' ') && (*p != '\t') && (*p != '\r') && (*p != '\n'))
     {
-        error("Expected a semicolon in layer max width\n");
-        return false;
+        p++;
     }
 
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
+    switch(Keywords::lookup(std::string_view(word, p - word)))
     {
-        error("Expected an EOL\n");
+    case KW_MACRO:
+    case KW_LAYER:
+    case KW_VIA:
+    case KW_VIARULE:
+    case KW_UNITS:
+    case KW_PROPERTYDEFINITIONS:
+        // LAYER and VIA statements inside a macro end with a
+        // semicolon, the top-level ones do not.
+        return (memchr(p, ';', end - p) == nullptr);
+    default:
         return false;
     }
-
-    double maxwidthd;
-    try
-    {
-        maxwidthd = std::stod(maxwidth);
-    }
-    catch(const std::invalid_argument& ia)
-    {
-        error(ia.what());
-    }
-
-    onLayerMaxWidth(maxwidthd);
-
-    return true;
 }
 
-bool LEFReader::parseLayerDirection()
+void LEFReader::resync()
 {
-    std::string direction;
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_IDENT)
-    {
-        error("Expected a string in layer direction\n");
-        return false;    
-    }
-
-    direction = m_tokstr;
-
-    // expect ; 
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_SEMICOL)
-    {
-        error("Expected a semicolon in layer direction\n");
-        return false;
-    }
+    // The rest of the current line is only a candidate if nothing
+    // precedes m_ptr on it. Each line is looked at once, so
+    // recovering from an error never costs more than a single
+    // pass over the input.
+    bool lineStart = atLineStart();
+    const char *limit;
+    while(completeLines(limit))
+    {
+        while(m_ptr < limit)
+        {
+            const char *eol  = static_cast<const char*>(memchr(m_ptr, '\n', limit - m_ptr));
+            const char *next = (eol != nullptr) ? eol + 1 : limit;
+            if (lineStart && isStatementStart(m_ptr, next))
+            {
+                return;
+            }
 
-    // expect EOL
-    m_curtok = tokenize(m_tokstr);
-    if (m_curtok != TOK_EOL)
-    {
-        error("Expected an EOL\n");
-        return false;
+            m_lineNum += countLines(m_ptr, next);
+            m_ptr = next;
+            lineStart = true;
+        }
     }
-
-    onLayerDirection(direction);
-
-    return true;  
 }
 
 bool LEFReader::parseVia()
 {
     // VIA <vianame> ...
-    // keep on reading tokens until we
+    // skip everything until we
     // find END <vianame>
 
     m_curtok = tokenize(m_tokstr);
-    std::string viaName;
 
     if (m_curtok != TOK_IDENT)
     {
@@ -1265,26 +1215,12 @@ bool LEFReader::parseVia()
         return false;
     }
 
-    viaName = m_tokstr;
-
-    // read until we get END <vianame>
-    do
+    if (!skipToEnd(std::string(m_tokstr)))
     {
-        m_curtok = tokenize(m_tokstr);
-        while(m_tokstr != "END")
-        {
-            m_curtok = tokenize(m_tokstr);
-        }
+        error("Unexpected end of file in VIA\n");
+        return false;
+    }
 
-        // read via name
-        m_curtok = tokenize(m_tokstr);
-        if (m_curtok != TOK_IDENT)
-        {
-            error("Expected via name after END\n");
-            return false;
-        }
-    } while(m_tokstr == viaName);
-    
     m_curtok = tokenize(m_tokstr);
     if (m_curtok != TOK_EOL)
     {
@@ -1298,11 +1234,10 @@ bool LEFReader::parseVia()
 bool LEFReader::parseViaRule()
 {
     // VIARULE <vianame> ...
-    // keep on reading tokens until we
+    // skip everything until we
     // find END <vianame>
 
     m_curtok = tokenize(m_tokstr);
-    std::string viaRuleName;
 
     if (m_curtok != TOK_IDENT)
     {
@@ -1310,26 +1245,12 @@ bool LEFReader::parseViaRule()
         return false;
     }
 
-    viaRuleName = m_tokstr;
-
-    // read until we get END <vianame>
-    do
+    if (!skipToEnd(std::string(m_tokstr)))
     {
-        m_curtok = tokenize(m_tokstr);
-        while(m_tokstr != "END")
-        {
-            m_curtok = tokenize(m_tokstr);
-        }
+        error("Unexpected end of file in VIARULE\n");
+        return false;
+    }
 
-        // read via name
-        m_curtok = tokenize(m_tokstr);
-        if (m_curtok != TOK_IDENT)
-        {
-            error("Expected viarule name after END\n");
-            return false;
-        }
-    } while(m_tokstr == viaRuleName);
-    
     m_curtok = tokenize(m_tokstr);
     if (m_curtok != TOK_EOL)
     {
@@ -1360,57 +1281,23 @@ bool LEFReader::parseUnits()
     {
         m_curtok = tokenize(m_tokstr);
 
+        if (m_curtok == TOK_EOL)
+        {
+            continue;   // empty line
+        }
+
         if (m_curtok != TOK_IDENT)
         {
             error("Expected string in units block\n");
             return false;
         }
 
-        if (m_tokstr == "DATABASE")
+        const LEFGrammar::statement_t *statement =
+            LEFGrammar::find(LEFGrammar::CTX_UNITS, Keywords::lookup(m_tokstr));
+        if (statement != nullptr)
         {
-            m_curtok = tokenize(m_tokstr);
-            if ((m_curtok == TOK_IDENT) && (m_tokstr == "MICRONS"))
-            {
-                m_curtok = tokenize(m_tokstr);
-                if (m_curtok == TOK_NUMBER)
-                {
-                    double micronsd;
-                    try
-                    {
-                        micronsd = std::stod(m_tokstr);
-                    }
-                    catch(const std::invalid_argument& ia)
-                    {
-                        error(ia.what());
-                        return false;
-                    }
-
-                    // expect ; and EOL
-                    m_curtok = tokenize(m_tokstr);
-                    if (m_curtok != TOK_SEMICOL)
-                    {
-                        error("Expected ; after DATABASE MICRONS <number>\n");
-                        return false;
-                    }
-
-                    m_curtok = tokenize(m_tokstr);
-                    if (m_curtok != TOK_EOL)
-                    {
-                        error("Expected EOL after DATABASE MICRONS <number> ;\n");
-                        return false;
-                    }
-
-                    onDatabaseUnitsMicrons(micronsd);
-                }
-                else
-                {
-                    error("Expected a number after DATABASE MICRONS\n");
-                    return false;
-                }
-            }
-            else
+            if (!parseStatement(*statement))
             {
-                error("Expects MICRONS keywords after DATABASE\n");
                 return false;
             }
         }
@@ -1448,35 +1335,18 @@ bool LEFReader::parsePropertyDefintions()
     // basically, eat everything until
     // we encounter END PROPERTYDEFINTIONS EOL
 
-    while(1)
+    if (!skipToEnd("PROPERTYDEFINITIONS"))
     {
-        m_curtok = tokenize(m_tokstr);
-        if ((m_curtok == TOK_IDENT) && (m_tokstr == "END"))
-        {
-            m_curtok = tokenize(m_tokstr);
-            if ((m_curtok == TOK_IDENT) && (m_tokstr == "PROPERTYDEFINITIONS"))
-            {
-                m_curtok = tokenize(m_tokstr);
-                if (m_curtok == TOK_EOL)
-                {
-                    return true;
-                }
-                else if (m_curtok == TOK_EOF)
-                {
-                    error("Unexpected end of liberty file\n");
-                    return false;                    
-                }
-            }
-            else if (m_curtok == TOK_EOF)
-            {
-                error("Unexpected end of liberty file\n");
-                return false;
-            }
-        }
-        else if (m_curtok == TOK_EOF)
-        {
-            error("Unexpected end of liberty file\n");
-            return false;
-        }
+        error("Unexpected end of file in PROPERTYDEFINITIONS\n");
+        return false;
     }
-}
\ No newline at end of file
+
+    m_curtok = tokenize(m_tokstr);
+    if (m_curtok != TOK_EOL)
+    {
+        error("Expected EOL after END PROPERTYDEFINITIONS\n");
+        return false;
+    }
+
+    return true;
+}
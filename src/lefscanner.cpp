@@ -0,0 +1,172 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include "lefscanner.h"
+
+namespace
+{
+
+bool isSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+/** get the next whitespace separated word from [p, end) */
+std::string_view nextWord(const char *&p, const char *end)
+{
+    while((p < end) && isSpace(*p))
+    {
+        p++;
+    }
+
+    const char *start = p;
+    while((p < end) && !isSpace(*p))
+    {
+        p++;
+    }
+    return std::string_view(start, p - start);
+}
+
+} // namespace
+
+std::vector<LEFScanner::section_t> LEFScanner::scan(const char *data, size_t bytes, bool headerOnly)
+{
+    std::vector<section_t> sections;
+
+    section_t current;
+    bool inSection = false;
+    std::string_view pinName;   // PIN inside a MACRO, its END must not end the macro
+
+    uint32_t lineNum = 1;
+    const char *end  = data + bytes;
+    const char *line = data;
+    while(line < end)
+    {
+        const char *eol = static_cast<const char*>(memchr(line, '\n', end - line));
+        const char *lineEnd = (eol != nullptr) ? eol : end;
+        const char *next = (eol != nullptr) ? eol + 1 : end;
+
+        const char *p = line;
+        std::string_view first = nextWord(p, lineEnd);
+
+        if (!first.empty() && (first[0] != '#'))
+        {
+            if (!inSection)
+            {
+                std::string_view name = nextWord(p, lineEnd);
+                bool found = true;
+                if (first == "MACRO")
+                {
+                    if (headerOnly)
+                    {
+                        break;
+                    }
+                    current.m_type = SEC_MACRO;
+                }
+                else if (first == "LAYER")
+                {
+                    current.m_type = SEC_LAYER;
+                }
+                else if (first == "VIA")
+                {
+                    current.m_type = SEC_VIA;
+                }
+                else if (first == "VIARULE")
+                {
+                    current.m_type = SEC_VIARULE;
+                }
+                else if (first == "SITE")
+                {
+                    current.m_type = SEC_SITE;
+                }
+                else if (first == "UNITS")
+                {
+                    current.m_type = SEC_UNITS;
+                    name = first;
+                }
+                else if (first == "PROPERTYDEFINITIONS")
+                {
+                    current.m_type = SEC_PROPERTYDEFINITIONS;
+                    name = first;
+                }
+                else
+                {
+                    found = false;
+                }
+
+                if (found && !name.empty())
+                {
+                    current.m_name  = name;
+                    current.m_begin = line - data;
+                    current.m_line  = lineNum;
+                    current.m_class = std::string_view();
+                    inSection = true;
+                    pinName = std::string_view();
+                }
+            }
+            else if (first == "END")
+            {
+                std::string_view name = nextWord(p, lineEnd);
+                if (!pinName.empty())
+                {
+                    if (name == pinName)
+                    {
+                        pinName = std::string_view();
+                    }
+                }
+                else if (name == current.m_name)
+                {
+                    current.m_end = next - data;
+                    sections.push_back(current);
+                    inSection = false;
+                }
+            }
+            else if ((first == "PIN") && (current.m_type == SEC_MACRO))
+            {
+                pinName = nextWord(p, lineEnd);
+            }
+            else if ((first == "CLASS") && (current.m_type == SEC_MACRO) && pinName.empty())
+            {
+                // keep everything up to the semicolon
+                std::string_view rest(p, lineEnd - p);
+                rest = rest.substr(0, rest.find(';'));
+                while(!rest.empty() && isSpace(rest.front()))
+                {
+                    rest.remove_prefix(1);
+                }
+                while(!rest.empty() && isSpace(rest.back()))
+                {
+                    rest.remove_suffix(1);
+                }
+                current.m_class = rest;
+            }
+        }
+
+        // LEFReader counts every CR and LF as a line
+        lineNum++;
+        if ((lineEnd > line) && (lineEnd[-1] == '\r'))
+        {
+            lineNum++;
+        }
+        line = next;
+    }
+
+    return sections;
+}
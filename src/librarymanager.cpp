@@ -0,0 +1,279 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include "librarymanager.h"
+#include "lefloader.h"
+#include "logging.h"
+
+bool LibraryManager::load(const std::string &library, const std::vector<std::string> &filenames,
+    uint32_t jobs)
+{
+    // parse into a reader of our own, only the cells
+    // that are new end up in the store.
+    PRLEFReader reader;
+    LEFLoader loader(reader);
+    loader.setJobs(jobs);
+    if (!loader.load(filenames))
+    {
+        return false;
+    }
+
+    add(library, reader);
+
+    doLog(LOG_INFO, "Library %s: %zu cells, %zu shared with other libraries\n",
+        library.c_str(), cellsOf(library).size(), sharedCellCount(library));
+    return true;
+}
+
+void LibraryManager::add(const std::string &library, const PRLEFReader &reader)
+{
+    m_layerMap.clear();
+    for(size_t i=0; i<reader.m_geometry.layerCount(); i++)
+    {
+        auto name = m_store.intern(reader.m_geometry.layerName(static_cast<uint16_t>(i)));
+        m_layerMap.push_back(m_store.m_geometry.layerId(name));
+    }
+
+    library_t added;
+    added.m_databaseUnits = reader.m_lefDatabaseUnits;
+    added.m_cells.reserve(reader.m_cells.size());
+    for(auto const &cell : reader.m_cells)
+    {
+        PRLEFReader::LEFCellInfo_t *record = share(reader, *cell.second);
+        added.m_cells.insert(std::make_pair(record->m_name, record));
+        m_refs.at(record).m_refs++;
+    }
+
+    auto iter = m_libraries.find(library);
+    if (iter == m_libraries.end())
+    {
+        m_libraries.insert(std::make_pair(library, std::move(added)));
+        return;
+    }
+
+    release(cellsOf(library));
+    iter->second.m_databaseUnits = added.m_databaseUnits;
+    cellsOf(library) = std::move(added.m_cells);
+    if (library == m_active)
+    {
+        m_store.m_lefDatabaseUnits = added.m_databaseUnits;
+    }
+}
+
+bool LibraryManager::activate(const std::string &library)
+{
+    auto iter = m_libraries.find(library);
+    if (iter == m_libraries.end())
+    {
+        return false;
+    }
+
+    if (library == m_active)
+    {
+        return true;
+    }
+
+    // park the cells of the active library, or those
+    // the store held itself, and move the new ones in.
+    cellMap_t &parked = m_active.empty() ? m_storeCells : m_libraries.at(m_active).m_cells;
+    parked.swap(m_store.m_cells);
+    m_store.m_cells.swap(iter->second.m_cells);
+
+    m_store.m_lefDatabaseUnits = iter->second.m_databaseUnits;
+    if (m_store.m_lefDatabaseUnits > 0.0)
+    {
+        m_store.setDatabaseUnits(m_store.m_lefDatabaseUnits);
+    }
+
+    m_active = library;
+    return true;
+}
+
+std::vector<std::string> LibraryManager::libraries() const
+{
+    std::vector<std::string> names;
+    for(auto const &library : m_libraries)
+    {
+        names.push_back(library.first);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+PRLEFReader::LEFCellInfo_t* LibraryManager::editCell(std::string_view name)
+{
+    if (m_active.empty())
+    {
+        return nullptr;
+    }
+
+    auto iter = m_store.m_cells.find(name);
+    if (iter == m_store.m_cells.end())
+    {
+        return nullptr;
+    }
+
+    record_t &record = m_refs.at(iter->second);
+    if (record.m_refs > 1)
+    {
+        // copy on write, the other libraries keep the original
+        PRLEFReader::LEFCellInfo_t *cell = m_store.createCell(iter->first);
+        *cell = *iter->second;
+        record.m_refs--;
+
+        m_refs.insert(std::make_pair(cell, record_t{1, record.m_databaseUnits}));
+        m_versions[cell->m_name].push_back(cell);
+        iter->second = cell;
+    }
+    return iter->second;
+}
+
+size_t LibraryManager::sharedCellCount(const std::string &library) const
+{
+    size_t count = 0;
+    for(auto const &cell : cellsOf(library))
+    {
+        if (m_refs.at(cell.second).m_refs > 1)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+LibraryManager::cellMap_t& LibraryManager::cellsOf(const std::string &library)
+{
+    return (library == m_active) ? m_store.m_cells : m_libraries.at(library).m_cells;
+}
+
+const LibraryManager::cellMap_t& LibraryManager::cellsOf(const std::string &library) const
+{
+    return (library == m_active) ? m_store.m_cells : m_libraries.at(library).m_cells;
+}
+
+PRLEFReader::LEFCellInfo_t* LibraryManager::share(const PRLEFReader &reader,
+    const PRLEFReader::LEFCellInfo_t &cell)
+{
+    auto &versions = m_versions[m_store.intern(cell.m_name)];
+    for(auto record : versions)
+    {
+        if ((m_refs.at(record).m_databaseUnits == reader.m_lefDatabaseUnits) &&
+            isEqual(*record, reader, cell))
+        {
+            return record;
+        }
+    }
+
+    PRLEFReader::LEFCellInfo_t *record = copy(reader, cell);
+    versions.push_back(record);
+    m_refs.insert(std::make_pair(record, record_t{0, reader.m_lefDatabaseUnits}));
+    return record;
+}
+
+bool LibraryManager::isEqual(const PRLEFReader::LEFCellInfo_t &record, const PRLEFReader &reader,
+    const PRLEFReader::LEFCellInfo_t &cell) const
+{
+    if ((record.m_sx != cell.m_sx) || (record.m_sy != cell.m_sy) ||
+        (record.m_isFiller != cell.m_isFiller) || (record.m_hasClass != cell.m_hasClass) ||
+        (record.m_hasForeign != cell.m_hasForeign) ||
+        (record.m_pinCount != cell.m_pinCount) || (record.m_obsCount != cell.m_obsCount) ||
+        (record.m_foreign != cell.m_foreign) || (record.m_symmetry != cell.m_symmetry) ||
+        (record.m_class != cell.m_class))
+    {
+        return false;
+    }
+
+    const LEFGeometry &ours   = m_store.m_geometry;
+    const LEFGeometry &theirs = reader.m_geometry;
+    auto sameRects = [&](uint32_t first, uint32_t otherFirst, uint32_t count)
+    {
+        for(uint32_t i=0; i<count; i++)
+        {
+            const uint32_t a = first + i;
+            const uint32_t b = otherFirst + i;
+            if ((ours.x1()[a] != theirs.x1()[b]) || (ours.y1()[a] != theirs.y1()[b]) ||
+                (ours.x2()[a] != theirs.x2()[b]) || (ours.y2()[a] != theirs.y2()[b]) ||
+                (ours.layers()[a] != m_layerMap[theirs.layers()[b]]))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for(uint32_t i=0; i<cell.m_pinCount; i++)
+    {
+        auto const &pin = ours.pin(record.m_firstPin + i);
+        auto const &otherPin = theirs.pin(cell.m_firstPin + i);
+        if ((pin.m_name != otherPin.m_name) || (pin.m_rectCount != otherPin.m_rectCount) ||
+            !sameRects(pin.m_firstRect, otherPin.m_firstRect, pin.m_rectCount))
+        {
+            return false;
+        }
+    }
+
+    return sameRects(record.m_firstObs, cell.m_firstObs, cell.m_obsCount);
+}
+
+PRLEFReader::LEFCellInfo_t* LibraryManager::copy(const PRLEFReader &reader,
+    const PRLEFReader::LEFCellInfo_t &cell)
+{
+    PRLEFReader::LEFCellInfo_t *record = m_store.createCell(cell.m_name);
+    const std::string_view name = record->m_name;
+    *record = cell;
+    record->m_name     = name;
+    record->m_foreign  = m_store.intern(cell.m_foreign);
+    record->m_symmetry = m_store.intern(cell.m_symmetry);
+    record->m_class    = m_store.intern(cell.m_class);
+
+    LEFGeometry &ours = m_store.m_geometry;
+    const LEFGeometry &theirs = reader.m_geometry;
+    auto copyRects = [&](uint32_t first, uint32_t count)
+    {
+        for(uint32_t i=first; i<first+count; i++)
+        {
+            ours.addRect(m_layerMap[theirs.layers()[i]],
+                theirs.x1()[i], theirs.y1()[i], theirs.x2()[i], theirs.y2()[i]);
+        }
+    };
+
+    record->m_firstPin = ours.pinCount();
+    for(uint32_t i=0; i<cell.m_pinCount; i++)
+    {
+        auto const &pin = theirs.pin(cell.m_firstPin + i);
+        uint32_t index = ours.addPin(m_store.intern(pin.m_name));
+        copyRects(pin.m_firstRect, pin.m_rectCount);
+        ours.pin(index).m_rectCount = pin.m_rectCount;
+    }
+
+    record->m_firstObs = ours.rectCount();
+    copyRects(cell.m_firstObs, cell.m_obsCount);
+    return record;
+}
+
+void LibraryManager::release(const cellMap_t &cells)
+{
+    // records without users stay in the store and
+    // are shared again when a later library has them.
+    for(auto const &cell : cells)
+    {
+        m_refs.at(cell.second).m_refs--;
+    }
+}
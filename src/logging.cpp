@@ -23,6 +23,7 @@
 #include "logging.h"
 
 static uint32_t gs_loglevel = LOG_INFO;
+static thread_local LogCapture *gs_capture = nullptr;
 
 void setLogLevel(uint32_t level)
 {
@@ -41,6 +42,31 @@ void doLog(uint32_t t, const char *format, ...)
         return;
     }
 
+    if (gs_capture != nullptr)
+    {
+        va_list argptr;
+        va_start(argptr, format);
+        char buffer[512];
+        int len = vsnprintf(buffer, sizeof(buffer), format, argptr);
+        va_end(argptr);
+
+        if (len < static_cast<int>(sizeof(buffer)))
+        {
+            gs_capture->add(t, buffer);
+        }
+        else
+        {
+            // message did not fit, format it again
+            std::string txt(len+1, ' ');
+            va_start(argptr, format);
+            vsnprintf(&txt[0], txt.size(), format, argptr);
+            va_end(argptr);
+            txt.resize(len);
+            gs_capture->add(t, txt);
+        }
+        return;
+    }
+
     FILE *sout = stdout;
 
     switch(t)
@@ -72,3 +98,23 @@ void doLog(uint32_t t, const char *format, ...)
     fflush(sout);
     va_end(argptr);
 }
+
+void LogCapture::start()
+{
+    m_previous = gs_capture;
+    gs_capture = this;
+}
+
+void LogCapture::stop()
+{
+    gs_capture = m_previous;
+    m_previous = nullptr;
+}
+
+void LogCapture::replay(size_t first, size_t last) const
+{
+    for(size_t i=first; (i<last) && (i<m_entries.size()); i++)
+    {
+        doLog(m_entries[i].m_level, "%s", m_entries[i].m_text.c_str());
+    }
+}
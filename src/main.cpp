@@ -22,15 +22,19 @@
 
 */
 
+#include <chrono>
+#include <deque>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/fmt.h"
 #include "cxxopts.hpp"
 
 #include "prlefreader.h"
+#include "lefloader.h"
 #include "configreader.h"
 #include "layout.h"
 #include "padringdb.h"
@@ -39,6 +43,109 @@
 #include "fillerhandler.h"
 #include "debugutils.h"
 #include "gds2writer.h"
+#include "mappedfile.h"
+#include "prefetcher.h"
+#include "shapeindex.h"
+#include "lefdiff.h"
+#include "librarymanager.h"
+#include "padcfg.h"
+
+/** compare two LEF libraries and list the cells that were added,
+    removed or changed. Returns 0 when they have the same cells,
+    1 when they differ and -1 when a file cannot be read. */
+int runLEFDiff(const std::string &oldFile, const std::string &newFile, uint32_t jobs)
+{
+    PRLEFReader oldLib;
+    PRLEFReader newLib;
+    LEFLoader oldLoader(oldLib);
+    LEFLoader newLoader(newLib);
+    oldLoader.setJobs(jobs);
+    newLoader.setJobs(jobs);
+    if (!oldLoader.load({oldFile}) || !newLoader.load({newFile}))
+    {
+        return -1;
+    }
+
+    auto result = LEFDiff::compare(oldLib, newLib);
+    LEFDiff::write(std::cout, result);
+    spdlog::info("{:d} cells added, {:d} removed, {:d} changed, {:d} unchanged",
+        result.m_added.size(), result.m_removed.size(), result.m_changed.size(), result.m_unchanged);
+
+    return result.identical() ? 0 : 1;
+}
+
+/** a cell library given with --library */
+struct librarySpec_t
+{
+    std::string                 m_name;
+    std::vector<std::string>    m_files;
+};
+
+/** parse --library arguments of the form name=file,file,...
+    The option parser may already have split the file list
+    at the commas. Returns false on a malformed argument. */
+bool parseLibraries(const std::vector<std::string> &args, std::vector<librarySpec_t> &libraries)
+{
+    for(auto const &arg : args)
+    {
+        std::string files = arg;
+        const size_t equals = arg.find('=');
+        if (equals != std::string::npos)
+        {
+            libraries.push_back({arg.substr(0, equals), {}});
+            files = arg.substr(equals + 1);
+        }
+
+        if (libraries.empty() || libraries.back().m_name.empty())
+        {
+            return false;
+        }
+
+        std::stringstream list(files);
+        std::string file;
+        while(std::getline(list, file, ','))
+        {
+            if (!file.empty())
+            {
+                libraries.back().m_files.push_back(file);
+            }
+        }
+    }
+
+    for(auto const &library : libraries)
+    {
+        if (library.m_files.empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** load all libraries into the cell database of a library
+    manager and make the selected one active */
+bool loadLibraries(LibraryManager &manager, const std::vector<librarySpec_t> &libraries,
+    const std::string &selected, uint32_t jobs)
+{
+    for(auto const &library : libraries)
+    {
+        if (!manager.load(library.m_name, library.m_files, jobs))
+        {
+            spdlog::error("Cannot load library {}", library.m_name);
+            return false;
+        }
+    }
+
+    if (!manager.activate(selected))
+    {
+        spdlog::error("Unknown library {}", selected);
+        return false;
+    }
+
+    spdlog::info("Using library {}, {:d} cell records for {:d} libraries", selected,
+        manager.recordCount(), libraries.size());
+    return true;
+}
 
 int main(int argc, char *argv[])
 {
@@ -92,14 +199,29 @@ int main(int argc, char *argv[])
         ("q,quiet", "produce no console output")
         ("v,verbose", "produce verbose output")
         ("filler", "set the filler cell prefix", cxxopts::value<std::vector<std::string>>())
+        ("j,jobs", "number of threads used to read LEF files (default: all cores)", cxxopts::value<uint32_t>())
+        ("cache", "binary cell cache, rebuilt when the LEF files change", cxxopts::value<std::string>())
+        ("lazy", "only parse the LEF cells used by the configuration")
+        ("index", "keep a .pidx index next to each LEF file, implies --lazy")
+        ("library", "load LEF files as a named library: name=file.lef,...", cxxopts::value<std::vector<std::string>>())
+        ("use-library", "the library used for the padring (default: the first --library)", cxxopts::value<std::string>())
+        ("lef-diff", "compare two LEF files given instead of the configuration file")
+        ("compile-config", "compile the configuration file given first into the .padcfg file given second")
+        ("decompile-config", "write the .padcfg file given first as a configuration file given second")
         ("config_file", "set the configuration file", cxxopts::value<std::vector<std::string>>());
 
     options.parse_positional({"config_file"});
 
     auto cmdresult = options.parse(argc, argv);
 
+    // --lef-diff takes the old and the new LEF file,
+    // the config compiler an input and an output file.
+    const bool lefDiff = (cmdresult.count("lef-diff") > 0);
+    const bool compileConfig = (cmdresult.count("compile-config") > 0);
+    const bool decompileConfig = (cmdresult.count("decompile-config") > 0);
+    const bool twoFiles = lefDiff || compileConfig || decompileConfig;
     if ((cmdresult.count("help")>0) ||
-        (cmdresult.count("config_file")!=1))
+        (cmdresult.count("config_file") != (twoFiles ? 2 : 1)))
     {
         std::cout << options.help({"", "Group"}) << std::endl;
         exit(0);
@@ -112,72 +234,192 @@ int main(int argc, char *argv[])
         spdlog::set_level(spdlog::level::debug);
     }
 
+    uint32_t jobs = (cmdresult.count("jobs") > 0) ? cmdresult["jobs"].as<uint32_t>() : 0;
+    if (lefDiff)
+    {
+        auto &files = cmdresult["config_file"].as<std::vector<std::string> >();
+        return runLEFDiff(files[0], files[1], jobs);
+    }
+
+    if (compileConfig || decompileConfig)
+    {
+        auto &files = cmdresult["config_file"].as<std::vector<std::string> >();
+        bool ok = compileConfig ? PadCfg::compileFile(files[0], files[1]) :
+            PadCfg::decompileFile(files[0], files[1]);
+        if (!ok)
+        {
+            spdlog::error("Cannot {} {}", compileConfig ? "compile" : "decompile", files[0]);
+            return -1;
+        }
+        spdlog::info("Wrote {}", files[1]);
+        return 0;
+    }
+
     //------------------------------------------------------------------------------
     // Program banner
     //------------------------------------------------------------------------------
-    if (cmdresult.count("lef") < 1){
+    std::vector<librarySpec_t> libraries;
+    if ((cmdresult.count("library") > 0) &&
+        !parseLibraries(cmdresult["library"].as<std::vector<std::string> >(), libraries))
+    {
+        spdlog::error("A library is given as --library name=file.lef,...");
+        return -1;
+    }
+
+    if ((cmdresult.count("lef") < 1) && libraries.empty()){
         spdlog::error("You must specify at least one LEF file containing the ASIC cells");
         return -1;
     }
 
+    if (!libraries.empty() && ((cmdresult.count("lef") > 0) || (cmdresult.count("cache") > 0) ||
+        (cmdresult.count("lazy") > 0) || (cmdresult.count("index") > 0)))
+    {
+        spdlog::error("--library cannot be combined with --lef, --cache, --lazy or --index");
+        return -1;
+    }
+
     PadringDB padring;
 
-    double LEFDatabaseUnits = 0.0;
+    const std::vector<std::string> noFiles;
+    auto &leffiles = libraries.empty() ? cmdresult["lef"].as<std::vector<std::string> >() : noFiles;
+    auto& v = cmdresult["config_file"].as<std::vector<std::string> >();
+    std::string configFileName = v[0];
+
+    // read all input files concurrently, parsing starts as soon
+    // as the first one is in memory. With a cache, the LEF files
+    // are usually not needed, and with an index only a part of
+    // each uncompressed LEF file is read.
+    const bool useIndex = (cmdresult.count("index") > 0);
+    auto loadStart = std::chrono::steady_clock::now();
+    std::vector<std::string> inputFiles = {configFileName};
+    if ((cmdresult.count("cache") == 0) && !useIndex)
+    {
+        inputFiles.insert(inputFiles.end(), leffiles.begin(), leffiles.end());
+    }
+
+    Prefetcher prefetcher;
+    prefetcher.start(inputFiles);
 
     // read the cells from the LEF files
-    // and save the most recent database units figure along the way..
-    auto &leffiles = cmdresult["lef"].as<std::vector<std::string> >();
-    for(auto leffile : leffiles)
-    {
-        std::ifstream lefstream(leffile, std::ifstream::in);
-        spdlog::info("Reading LEF {}", leffile.c_str());
-        padring.m_lefreader.parse(lefstream);
-        if (padring.m_lefreader.m_lefDatabaseUnits > 0.0)
+    // cells in later files replace those in earlier ones.
+    LEFLoader lefLoader(padring.m_lefreader);
+    lefLoader.setJobs(jobs);
+    if (cmdresult.count("cache") > 0)
+    {
+        lefLoader.setCacheFile(cmdresult["cache"].as<std::string>());
+    }
+    lefLoader.setLazy((cmdresult.count("lazy") > 0) || useIndex);
+    lefLoader.setUseIndex(useIndex);
+    lefLoader.setPrefetcher(&prefetcher);
+
+    // the configuration is parsed on its own thread while the
+    // LEF files load. it only records the cell names, they are
+    // looked up by resolveCells() once all cells are known.
+    // its messages are shown after those of the LEF files.
+    bool configOpened = false;
+    bool configParsed = false;
+    LogCapture configLog;
+    std::thread configThread([&]()
         {
-            LEFDatabaseUnits = padring.m_lefreader.m_lefDatabaseUnits;
-        }
+            configLog.start();
+            MappedFile configFile;
+            configOpened = prefetcher.open(configFileName, configFile);
+            configParsed = configOpened &&
+                padring.parse(configFile.data(), configFile.size(), configFileName);
+            configLog.stop();
+        });
+
+    // several libraries share one cell database, the
+    // padring is built from the selected one.
+    LibraryManager libraryManager(padring.m_lefreader);
+    bool lefLoaded;
+    if (libraries.empty())
+    {
+        lefLoaded = lefLoader.load(leffiles);
+    }
+    else
+    {
+        const std::string selected = (cmdresult.count("use-library") > 0) ?
+            cmdresult["use-library"].as<std::string>() : libraries.front().m_name;
+        lefLoaded = loadLibraries(libraryManager, libraries, selected, jobs);
+    }
+    configThread.join();
+    configLog.replay();
+    if (!lefLoaded)
+    {
+        return -1;
     }
 
-    spdlog::info("{:d} cells read", padring.m_lefreader.m_cells.size());
+    // the most recent database units figure
+    double LEFDatabaseUnits = padring.m_lefreader.m_lefDatabaseUnits;
 
-    auto& v = cmdresult["config_file"].as<std::vector<std::string> >();
-    std::string configFileName = v[0];
+    spdlog::info("{:d} cells read", padring.m_lefreader.getCellCount());
 
-    std::ifstream configStream(configFileName, std::ifstream::in);
-    if (!padring.parse(configStream))
+    if (!configOpened)
+    {
+        spdlog::error("Cannot open configuration file {}", configFileName);
+        return -1;
+    }
+
+    if (!configParsed)
     {
         spdlog::error("Cannot parse configuration file -- aborting");
         return -1;
     }
 
+    // like before, pads and corners with an unknown
+    // cell are left out of the padring.
+    padring.resolveCells();
+
+    double loadTime = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - loadStart).count();
+    spdlog::info("Input read with {}: first file after {:.1f} ms, all files after {:.1f} ms",
+        prefetcher.method(), prefetcher.firstFileTime(), prefetcher.allFilesTime());
+    spdlog::info("Input loaded in {:.1f} ms", loadTime);
+
     // if an explicit filler cell prefix was not given,
     // search the cell database for filler cells
     FillerHandler fillerHandler;
     if (cmdresult.count("filler") == 0)
     {
+        padring.m_lefreader.materializeFillers();
         for(auto lefCell : padring.m_lefreader.m_cells)
         {
             if (lefCell.second->m_isFiller)
             {
-                fillerHandler.addFillerCell(lefCell.first, lefCell.second->m_sx);
+                fillerHandler.addFillerCell(std::string(lefCell.first), lefCell.second->m_sx);
             }
         }
     }
     else
     {
         // use the provided filler cell prefix to search for filler cells
+        padring.m_lefreader.materializeFillers(padring.m_fillerPrefix);
         for(auto lefCell : padring.m_lefreader.m_cells)
         {
             // match prefix
             if (lefCell.first.rfind(padring.m_fillerPrefix, 0) == 0)
             {
-                fillerHandler.addFillerCell(lefCell.first, lefCell.second->m_sx);
+                fillerHandler.addFillerCell(std::string(lefCell.first), lefCell.second->m_sx);
             }
         }
     }
 
     spdlog::info("Found {:d} filler cells", fillerHandler.getCellCount());
 
+    // check the cells now that the grid is known
+    // and the fillers have been parsed
+    std::vector<std::string_view> cornerCells;
+    for(auto corner : {padring.m_north.getFirstCorner(), padring.m_north.getLastCorner(),
+        padring.m_south.getFirstCorner(), padring.m_south.getLastCorner()})
+    {
+        if (corner != nullptr)
+        {
+            cornerCells.push_back(corner->m_cellname);
+        }
+    }
+    PRLEFReader::logReport(padring.m_lefreader.checkCells(padring.m_grid, jobs, cornerCells));
+
     if (fillerHandler.getCellCount() == 0)
     {
         spdlog::error("Cannot proceed without filler cells. Please use the --filler option to explicitly specify a filler cell prefix");
@@ -262,8 +504,18 @@ int main(int argc, char *argv[])
     def.writeCell(bottomleft);
     def.writeCell(bottomright);
 
+    // the fillers are kept for the overlap check
+    std::deque<LayoutItem> fillers;
+
+    // bus runs are only expanded into their pads here
+    std::deque<LayoutItem> expanded;
+    auto northItems = padring.m_north.expandItems(expanded);
+    auto southItems = padring.m_south.expandItems(expanded);
+    auto westItems  = padring.m_west.expandItems(expanded);
+    auto eastItems  = padring.m_east.expandItems(expanded);
+
     double north_y = padring.m_dieHeight;
-    for(auto item : padring.m_north)
+    for(auto item : northItems)
     {
         if (item->m_ltype == LayoutItem::TYPE_CELL)
         {
@@ -283,15 +535,16 @@ int main(int argc, char *argv[])
                 if (width > 0.0)
                 {
                     LayoutItem filler(LayoutItem::TYPE_FILLER);
-                    filler.m_cellname = cellName;
                     filler.m_x = pos;
                     filler.m_y = north_y;
                     filler.m_size = width;
                     filler.m_location = "N";
                     filler.m_lefinfo = padring.m_lefreader.getCellByName(cellName);
+                    filler.m_cellname = filler.m_lefinfo->m_name;
                     if (writer != nullptr) writer->writeCell(&filler);
                     svg.writeCell(&filler);
                     def.writeCell(&filler);
+                    fillers.push_back(filler);
                     space -= width;
                     pos += width;
                 }
@@ -305,7 +558,7 @@ int main(int argc, char *argv[])
     }
 
     double south_y = 0;
-    for(auto item : padring.m_south)
+    for(auto item : southItems)
     {
         if (item->m_ltype == LayoutItem::TYPE_CELL)
         {
@@ -325,15 +578,16 @@ int main(int argc, char *argv[])
                 if (width > 0.0)
                 {
                     LayoutItem filler(LayoutItem::TYPE_FILLER);
-                    filler.m_cellname = cellName;
                     filler.m_x = pos;
                     filler.m_y = south_y;
                     filler.m_size = width;
                     filler.m_location = "S";
                     filler.m_lefinfo = padring.m_lefreader.getCellByName(cellName);
+                    filler.m_cellname = filler.m_lefinfo->m_name;
                     if (writer != nullptr) writer->writeCell(&filler);
                     svg.writeCell(&filler);
                     def.writeCell(&filler);
+                    fillers.push_back(filler);
                     space -= width;
                     pos += width;
                 }
@@ -347,7 +601,7 @@ int main(int argc, char *argv[])
     }
 
     double west_x = 0;
-    for(auto item : padring.m_west)
+    for(auto item : westItems)
     {
         if (item->m_ltype == LayoutItem::TYPE_CELL)
         {
@@ -367,15 +621,16 @@ int main(int argc, char *argv[])
                 if (width > 0.0)
                 {
                     LayoutItem filler(LayoutItem::TYPE_FILLER);
-                    filler.m_cellname = cellName;
                     filler.m_x = west_x;
                     filler.m_y = pos;
                     filler.m_size = width;
                     filler.m_location = "W";
                     filler.m_lefinfo = padring.m_lefreader.getCellByName(cellName);
+                    filler.m_cellname = filler.m_lefinfo->m_name;
                     if (writer != nullptr) writer->writeCell(&filler);
                     svg.writeCell(&filler);
                     def.writeCell(&filler);
+                    fillers.push_back(filler);
                     space -= width;
                     pos += width;
                 }
@@ -389,7 +644,7 @@ int main(int argc, char *argv[])
     }
 
     double east_x = padring.m_dieWidth;
-    for(auto item : padring.m_east)
+    for(auto item : eastItems)
     {
         if (item->m_ltype == LayoutItem::TYPE_CELL)
         {
@@ -409,15 +664,16 @@ int main(int argc, char *argv[])
                 if (width > 0.0)
                 {
                     LayoutItem filler(LayoutItem::TYPE_FILLER);
-                    filler.m_cellname = cellName;
                     filler.m_x = east_x;
                     filler.m_y = pos;
                     filler.m_size = width;
                     filler.m_location = "E";
                     filler.m_lefinfo = padring.m_lefreader.getCellByName(cellName);
+                    filler.m_cellname = filler.m_lefinfo->m_name;
                     if (writer != nullptr) writer->writeCell(&filler);
                     svg.writeCell(&filler);
                     def.writeCell(&filler);
+                    fillers.push_back(filler);
                     space -= width;
                     pos += width;
                 }
@@ -432,6 +688,52 @@ int main(int argc, char *argv[])
 
     if (writer != nullptr) delete writer;
 
+    // check that no two placed cells overlap
+    ShapeIndex shapes;
+    for(auto corner : {topleft, topright, bottomleft, bottomright})
+    {
+        if (corner != nullptr)
+        {
+            shapes.addItem(corner, padring.m_lefreader);
+        }
+    }
+    for(auto edge : {&northItems, &southItems, &westItems, &eastItems})
+    {
+        for(auto item : *edge)
+        {
+            if (item->m_ltype == LayoutItem::TYPE_CELL)
+            {
+                shapes.addItem(item, padring.m_lefreader);
+            }
+        }
+    }
+    for(auto const &filler : fillers)
+    {
+        shapes.addItem(&filler, padring.m_lefreader);
+    }
+    shapes.build();
+
+    auto describe = [](const LayoutItem *item)
+        {
+            if (item->m_ltype == LayoutItem::TYPE_FILLER)
+            {
+                return fmt::format("filler {} at ({:f}, {:f})", item->m_cellname, item->m_x, item->m_y);
+            }
+            return item->m_instance;
+        };
+
+    const size_t maxReportedOverlaps = 20;
+    auto overlaps = shapes.findOverlaps();
+    for(size_t i=0; (i<overlaps.size()) && (i<maxReportedOverlaps); i++)
+    {
+        spdlog::warn("Cells {} and {} overlap", describe(shapes.item(overlaps[i].first)),
+            describe(shapes.item(overlaps[i].second)));
+    }
+    if (overlaps.size() > maxReportedOverlaps)
+    {
+        spdlog::warn("{:d} more pairs of overlapping cells", overlaps.size() - maxReportedOverlaps);
+    }
+
     if (spdlog::get_level() < spdlog::level::info) {
         spdlog::debug("Printing cell definitions");
         for (auto cell : padring.m_lefreader.m_cells) {
@@ -0,0 +1,144 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <fstream>
+#include <iterator>
+#include "mappedfile.h"
+#include "decompressor.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode))
+    {
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size == 0)
+        {
+            // mmap does not accept empty regions
+            ::close(fd);
+            m_open = true;
+            return true;
+        }
+
+        void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED)
+        {
+            // the tokenizers read front to back
+            madvise(ptr, m_size, MADV_SEQUENTIAL);
+            ::close(fd);
+            m_data   = static_cast<const char*>(ptr);
+            m_mapped = true;
+            m_open   = true;
+            return true;
+        }
+    }
+    ::close(fd);
+    m_size = 0;
+#endif
+
+    // fall back to reading the file into memory
+    std::ifstream is(filename, std::ifstream::in | std::ifstream::binary);
+    if (!is.good())
+    {
+        return false;
+    }
+
+    m_copy.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    m_data = m_copy.data();
+    m_size = m_copy.size();
+    m_open = true;
+    return true;
+}
+
+bool MappedFile::openDecompressed(const std::string &filename)
+{
+    if (!open(filename))
+    {
+        return false;
+    }
+
+    if (detectCompression(m_data, m_size) == COMPRESSION_NONE)
+    {
+        return true;
+    }
+
+    std::vector<char> contents;
+    bool ok = readDecompressed(filename, contents);
+    close();
+    if (!ok)
+    {
+        return false;
+    }
+
+    m_copy.swap(contents);
+    m_data = m_copy.data();
+    m_size = m_copy.size();
+    m_open = true;
+    return true;
+}
+
+void MappedFile::assign(std::vector<char> &&contents)
+{
+    close();
+    m_copy = std::move(contents);
+    m_data = m_copy.data();
+    m_size = m_copy.size();
+    m_open = true;
+}
+
+void MappedFile::assign(std::unique_ptr<char[]> contents, size_t bytes)
+{
+    close();
+    m_buffer = std::move(contents);
+    m_data = m_buffer.get();
+    m_size = bytes;
+    m_open = true;
+}
+
+void MappedFile::close()
+{
+#ifndef _WIN32
+    if (m_mapped)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+    m_copy.clear();
+    m_buffer.reset();
+    m_data   = nullptr;
+    m_size   = 0;
+    m_open   = false;
+    m_mapped = false;
+}
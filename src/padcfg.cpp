@@ -0,0 +1,545 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include "logging.h"
+#include "mappedfile.h"
+#include "configreader.h"
+#include "padcfg.h"
+#include "padlib.h"
+
+namespace
+{
+
+const char c_locations[] = "NESW";
+
+template<typename T> void put(std::string &out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/** reads the unaligned statement arguments,
+    remembering when it ran past the end. */
+class Cursor
+{
+public:
+    Cursor(const char *data, size_t bytes) : m_ptr(data), m_end(data + bytes), m_ok(true) {}
+
+    template<typename T> T get()
+    {
+        T value{};
+        if (static_cast<size_t>(m_end - m_ptr) < sizeof(T))
+        {
+            m_ok = false;
+            m_ptr = m_end;
+            return value;
+        }
+        memcpy(&value, m_ptr, sizeof(T));
+        m_ptr += sizeof(T);
+        return value;
+    }
+
+    std::string_view getText(size_t bytes)
+    {
+        if (static_cast<size_t>(m_end - m_ptr) < bytes)
+        {
+            m_ok = false;
+            m_ptr = m_end;
+            return std::string_view();
+        }
+        std::string_view text(m_ptr, bytes);
+        m_ptr += bytes;
+        return text;
+    }
+
+    bool atEnd() const
+    {
+        return m_ptr >= m_end;
+    }
+
+    bool ok() const
+    {
+        return m_ok;
+    }
+
+protected:
+    const char *m_ptr;
+    const char *m_end;
+    bool        m_ok;
+};
+
+/** shortest text that reads back as the same double */
+std::string formatNumber(double value)
+{
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
+
+} // namespace
+
+/** records the callbacks of a text configuration as statements */
+class PadCfg::Compiler : public ConfigReader
+{
+public:
+    Compiler() : m_statementCount(0) {}
+
+    virtual void onCorner(const std::string &instance, const std::string &location,
+        const std::string &cellname) override
+    {
+        beginStatement(ST_CORNER);
+        put<uint32_t>(m_statements, intern(instance));
+        put<uint32_t>(m_statements, intern(location));
+        put<uint32_t>(m_statements, intern(cellname));
+    }
+
+    virtual void onPads(const padRecord_t *pads, size_t count) override
+    {
+        for(size_t i=0; i<count; i++)
+        {
+            const padRecord_t &pad = pads[i];
+            beginStatement(ST_PAD);
+            put<uint8_t>(m_statements, (pad.m_flipped ? c_padFlip : 0) | (pad.m_bus ? c_padBus : 0));
+            put<uint8_t>(m_statements, static_cast<uint8_t>(strchr(c_locations, pad.m_location[0]) - c_locations));
+            put<uint32_t>(m_statements, intern(pad.m_cellname));
+
+            // instance names are unique, they are
+            // not worth a string table entry.
+            const size_t length = std::min<size_t>(pad.m_instance.size(), UINT16_MAX);
+            if (length != pad.m_instance.size())
+            {
+                doLog(LOG_ERROR, "Instance name %s is too long\n", std::string(pad.m_instance).c_str());
+                m_failed = true;
+            }
+            put<uint16_t>(m_statements, static_cast<uint16_t>(length));
+            m_statements.append(pad.m_instance.data(), length);
+
+            if (pad.m_bus)
+            {
+                put<uint32_t>(m_statements, pad.m_busFirst);
+                put<int32_t>(m_statements, pad.m_busStride);
+                put<uint32_t>(m_statements, pad.m_count);
+            }
+        }
+    }
+
+    virtual void onArea(double x, double y) override
+    {
+        beginStatement(ST_AREA);
+        put<double>(m_statements, x);
+        put<double>(m_statements, y);
+    }
+
+    virtual void onGrid(double grid) override
+    {
+        beginStatement(ST_GRID);
+        put<double>(m_statements, grid);
+    }
+
+    virtual void onFiller(const std::string &fillerName) override
+    {
+        beginStatement(ST_FILLER);
+        put<uint32_t>(m_statements, intern(fillerName));
+    }
+
+    virtual void onSpace(double space) override
+    {
+        beginStatement(ST_SPACE);
+        put<double>(m_statements, space);
+    }
+
+    virtual void onOffset(double offset) override
+    {
+        beginStatement(ST_OFFSET);
+        put<double>(m_statements, offset);
+    }
+
+    virtual void onDesignName(const std::string &designName) override
+    {
+        beginStatement(ST_DESIGN);
+        put<uint32_t>(m_statements, intern(designName));
+    }
+
+    /** assemble the compiled file */
+    void write(std::string &compiled) const
+    {
+        header_t header;
+        memcpy(header.m_magic, "PADCFG\0\0", 8);
+        header.m_version        = c_version;
+        header.m_byteOrder      = c_byteOrder;
+        header.m_stringCount    = static_cast<uint32_t>(m_strings.size());
+        header.m_statementCount = m_statementCount;
+        header.m_stringBytes    = m_stringData.size();
+        header.m_statementBytes = m_statements.size();
+        header.m_checksum       = 0;
+
+        compiled.clear();
+        compiled.reserve(sizeof(header) + m_strings.size()*sizeof(string_t) +
+            m_stringData.size() + m_statements.size());
+        compiled.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        compiled.append(reinterpret_cast<const char*>(m_strings.data()), m_strings.size()*sizeof(string_t));
+        compiled.append(m_stringData);
+        compiled.append(m_statements);
+
+        header.m_checksum = PadLib::hash(compiled.data() + sizeof(header), compiled.size() - sizeof(header));
+        memcpy(compiled.data(), &header, sizeof(header));
+    }
+
+    bool m_failed = false;
+
+protected:
+    void beginStatement(statement_t statement)
+    {
+        put<uint8_t>(m_statements, statement);
+        m_statementCount++;
+    }
+
+    uint32_t intern(std::string_view str)
+    {
+        auto iter = m_ids.find(std::string(str));
+        if (iter != m_ids.end())
+        {
+            return iter->second;
+        }
+
+        const uint32_t id = static_cast<uint32_t>(m_strings.size());
+        m_strings.push_back({static_cast<uint32_t>(m_stringData.size()), static_cast<uint32_t>(str.size())});
+        m_stringData.append(str);
+        m_ids.emplace(std::string(str), id);
+        return id;
+    }
+
+    std::unordered_map<std::string, uint32_t> m_ids;
+    std::vector<string_t>   m_strings;
+    std::string             m_stringData;
+    std::string             m_statements;
+    uint32_t                m_statementCount;
+};
+
+/** writes the callbacks as configuration text */
+class PadCfg::TextWriter : public ConfigReader
+{
+public:
+    TextWriter(std::ostream &os) : m_os(os) {}
+
+    virtual void onCorner(const std::string &instance, const std::string &location,
+        const std::string &cellname) override
+    {
+        m_os << "CORNER " << instance << " " << location << " " << cellname << " ;\n";
+    }
+
+    virtual void onPads(const padRecord_t *pads, size_t count) override
+    {
+        for(size_t i=0; i<count; i++)
+        {
+            const padRecord_t &pad = pads[i];
+            m_os << "PAD " << pad.m_instance;
+            if (pad.m_bus)
+            {
+                const int64_t last = static_cast<int64_t>(pad.m_busFirst) +
+                    static_cast<int64_t>(pad.m_count - 1) * pad.m_busStride;
+                m_os << "[" << pad.m_busFirst << ":" << last;
+                if ((pad.m_busStride != 1) && (pad.m_busStride != -1))
+                {
+                    m_os << ":" << std::abs(pad.m_busStride);
+                }
+                m_os << "]";
+            }
+            m_os << " " << pad.m_location << (pad.m_flipped ? " FLIP " : " ") << pad.m_cellname << " ;\n";
+        }
+    }
+
+    virtual void onArea(double x, double y) override
+    {
+        m_os << "AREA " << formatNumber(x) << " " << formatNumber(y) << " ;\n";
+    }
+
+    virtual void onGrid(double grid) override
+    {
+        m_os << "GRID " << formatNumber(grid) << " ;\n";
+    }
+
+    virtual void onFiller(const std::string &fillerName) override
+    {
+        m_os << "FILLER " << fillerName << " ;\n";
+    }
+
+    virtual void onSpace(double space) override
+    {
+        m_os << "SPACE " << formatNumber(space) << " ;\n";
+    }
+
+    virtual void onOffset(double offset) override
+    {
+        m_os << "OFFSET " << formatNumber(offset) << " ;\n";
+    }
+
+    virtual void onDesignName(const std::string &designName) override
+    {
+        m_os << "DESIGN " << designName << " ;\n";
+    }
+
+protected:
+    std::ostream &m_os;
+};
+
+bool PadCfg::compile(const char *text, size_t bytes, std::string &compiled,
+    const std::string &fileName)
+{
+    Compiler compiler;
+    if (!compiler.parse(text, bytes, fileName) || compiler.m_failed)
+    {
+        return false;
+    }
+    compiler.write(compiled);
+    return true;
+}
+
+bool PadCfg::compileFile(const std::string &configFile, const std::string &compiledFile)
+{
+    MappedFile file;
+    if (!file.openDecompressed(configFile))
+    {
+        doLog(LOG_ERROR, "Cannot open configuration file %s\n", configFile.c_str());
+        return false;
+    }
+
+    std::string compiled;
+    if (!compile(file.data(), file.size(), compiled, configFile))
+    {
+        return false;
+    }
+
+    std::ofstream os(compiledFile, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    os.write(compiled.data(), compiled.size());
+    if (!os.good())
+    {
+        doLog(LOG_ERROR, "Cannot write compiled configuration %s\n", compiledFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool PadCfg::decompile(const char *data, size_t bytes, std::ostream &os)
+{
+    TextWriter writer(os);
+    return read(data, bytes, writer);
+}
+
+bool PadCfg::decompileFile(const std::string &compiledFile, const std::string &configFile)
+{
+    MappedFile file;
+    if (!file.open(compiledFile))
+    {
+        doLog(LOG_ERROR, "Cannot open compiled configuration %s\n", compiledFile.c_str());
+        return false;
+    }
+
+    std::ofstream os(configFile, std::ofstream::out | std::ofstream::trunc);
+    if (!decompile(file.data(), file.size(), os))
+    {
+        return false;
+    }
+
+    if (!os.good())
+    {
+        doLog(LOG_ERROR, "Cannot write configuration file %s\n", configFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool PadCfg::isCompiled(const char *data, size_t bytes)
+{
+    return (bytes >= 8) && (memcmp(data, "PADCFG\0\0", 8) == 0);
+}
+
+bool PadCfg::read(const char *data, size_t bytes, ConfigReader &reader)
+{
+    header_t header;
+    if (!isCompiled(data, bytes) || (bytes < sizeof(header)))
+    {
+        doLog(LOG_ERROR, "Compiled configuration is damaged\n");
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if ((header.m_version != c_version) || (header.m_byteOrder != c_byteOrder))
+    {
+        doLog(LOG_ERROR, "Compiled configuration has an unsupported format, compile it again\n");
+        return false;
+    }
+
+    const size_t stringsOffset    = sizeof(header_t);
+    const size_t stringDataOffset = stringsOffset + static_cast<size_t>(header.m_stringCount) * sizeof(string_t);
+    const size_t statementsOffset = stringDataOffset + header.m_stringBytes;
+    if ((stringDataOffset > bytes) || (statementsOffset > bytes) ||
+        (statementsOffset + header.m_statementBytes != bytes) ||
+        (PadLib::hash(data + sizeof(header), bytes - sizeof(header)) != header.m_checksum))
+    {
+        doLog(LOG_ERROR, "Compiled configuration is damaged\n");
+        return false;
+    }
+
+    // check the string table before handing out any strings
+    std::vector<std::string_view> strings(header.m_stringCount);
+    for(uint32_t i=0; i<header.m_stringCount; i++)
+    {
+        string_t s;
+        memcpy(&s, data + stringsOffset + i*sizeof(string_t), sizeof(s));
+        if (static_cast<uint64_t>(s.m_offset) + s.m_length > header.m_stringBytes)
+        {
+            doLog(LOG_ERROR, "Compiled configuration is damaged\n");
+            return false;
+        }
+        strings[i] = std::string_view(data + stringDataOffset + s.m_offset, s.m_length);
+    }
+
+    Cursor cursor(data + statementsOffset, header.m_statementBytes);
+    bool valid = true;
+    auto getString = [&]()
+        {
+            uint32_t id = cursor.get<uint32_t>();
+            if (id >= strings.size())
+            {
+                valid = false;
+                return std::string();
+            }
+            return std::string(strings[id]);
+        };
+
+    reader.m_pads.clear();
+    reader.m_pads.reserve(ConfigReader::c_padBatchSize);
+    uint32_t statements = 0;
+    while(valid && cursor.ok() && !cursor.atEnd())
+    {
+        const statement_t statement = static_cast<statement_t>(cursor.get<uint8_t>());
+        statements++;
+
+        // keep the callbacks in file order
+        if (statement != ST_PAD)
+        {
+            reader.flushPads();
+        }
+
+        switch(statement)
+        {
+        case ST_DESIGN:
+        {
+            std::string name = getString();
+            if (valid) reader.onDesignName(name);
+            break;
+        }
+        case ST_AREA:
+        {
+            double x = cursor.get<double>();
+            double y = cursor.get<double>();
+            if (cursor.ok()) reader.onArea(x, y);
+            break;
+        }
+        case ST_GRID:
+        {
+            double grid = cursor.get<double>();
+            if (cursor.ok()) reader.onGrid(grid);
+            break;
+        }
+        case ST_CORNER:
+        {
+            std::string instance = getString();
+            std::string location = getString();
+            std::string cellname = getString();
+            if (valid && cursor.ok()) reader.onCorner(instance, location, cellname);
+            break;
+        }
+        case ST_PAD:
+        {
+            ConfigReader::padRecord_t pad;
+            const uint8_t flags    = cursor.get<uint8_t>();
+            const uint8_t location = cursor.get<uint8_t>();
+            const uint32_t cell    = cursor.get<uint32_t>();
+            pad.m_instance  = cursor.getText(cursor.get<uint16_t>());
+            pad.m_flipped   = (flags & c_padFlip) != 0;
+            pad.m_bus       = (flags & c_padBus) != 0;
+            pad.m_line      = reader.m_lineNum;
+            pad.m_busFirst  = 0;
+            pad.m_busStride = 0;
+            pad.m_count     = 1;
+            if (pad.m_bus)
+            {
+                pad.m_busFirst  = cursor.get<uint32_t>();
+                pad.m_busStride = cursor.get<int32_t>();
+                pad.m_count     = cursor.get<uint32_t>();
+            }
+
+            // the last bus index must be a valid index too
+            const int64_t last = static_cast<int64_t>(pad.m_busFirst) +
+                static_cast<int64_t>(pad.m_count - 1) * pad.m_busStride;
+            valid = (location < 4) && (cell < strings.size()) && (pad.m_count > 0) &&
+                (!pad.m_bus || ((pad.m_busStride != 0) && (last >= 0) && (last <= UINT32_MAX))) &&
+                (pad.m_count <= UINT32_MAX - reader.m_padCount);
+            if (valid && cursor.ok())
+            {
+                pad.m_location = std::string_view(c_locations + location, 1);
+                pad.m_cellname = strings[cell];
+                reader.m_padCount += pad.m_count;
+                reader.m_pads.push_back(pad);
+                if (reader.m_pads.size() >= ConfigReader::c_padBatchSize)
+                {
+                    reader.flushPads();
+                }
+            }
+            break;
+        }
+        case ST_SPACE:
+        {
+            double space = cursor.get<double>();
+            if (cursor.ok()) reader.onSpace(space);
+            break;
+        }
+        case ST_OFFSET:
+        {
+            double offset = cursor.get<double>();
+            if (cursor.ok()) reader.onOffset(offset);
+            break;
+        }
+        case ST_FILLER:
+        {
+            std::string prefix = getString();
+            if (valid) reader.onFiller(prefix);
+            break;
+        }
+        default:
+            valid = false;
+        }
+    }
+    reader.flushPads();
+
+    if (!valid || !cursor.ok() || (statements != header.m_statementCount))
+    {
+        doLog(LOG_ERROR, "Compiled configuration is damaged\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,465 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <string.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
+#include "logging.h"
+#include "mappedfile.h"
+#include "padlib.h"
+
+namespace
+{
+
+uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+} // namespace
+
+uint64_t PadLib::hash(const char *data, size_t bytes)
+{
+    // a simple multiply-rotate hash over 64-bit words;
+    // it only has to notice edits, not resist attacks.
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+
+    uint64_t h = prime2 ^ bytes;
+    size_t i = 0;
+    for(; i + 8 <= bytes; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = rotl64(h ^ (word * prime2), 31) * prime1;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, bytes - i);
+    h = rotl64(h ^ (tail * prime2), 31) * prime1;
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    return h;
+}
+
+bool PadLib::fileStatus(const std::string &filename, uint64_t &size, int64_t &mtime)
+{
+    std::error_code ec;
+    size = std::filesystem::file_size(filename, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    auto ftime = std::filesystem::last_write_time(filename, ec);
+    if (ec)
+    {
+        return false;
+    }
+    mtime = static_cast<int64_t>(ftime.time_since_epoch().count());
+    return true;
+}
+
+bool PadLib::isUnchanged(const std::string &filename, uint64_t size, int64_t mtime, uint64_t contentHash)
+{
+    uint64_t currentSize;
+    int64_t  currentMtime;
+    if (!fileStatus(filename, currentSize, currentMtime) || (currentSize != size))
+    {
+        return false;
+    }
+
+    if (currentMtime == mtime)
+    {
+        return true;
+    }
+
+    // the file was touched, see if its contents changed
+    MappedFile file;
+    if (!file.open(filename))
+    {
+        return false;
+    }
+    return hash(file.data(), file.size()) == contentHash;
+}
+
+std::string PadLib::tempFileName(const std::string &filename)
+{
+    // the process id keeps concurrent runs apart,
+    // the counter the threads of one run.
+    static std::atomic<uint32_t> counter(0);
+#ifdef _WIN32
+    const long pid = _getpid();
+#else
+    const long pid = getpid();
+#endif
+    return filename + ".tmp." + std::to_string(pid) + "." + std::to_string(counter++);
+}
+
+bool PadLib::isCurrent(const std::string &filename, const fileRecord_t &record)
+{
+    return isUnchanged(filename, record.m_size, record.m_mtime, record.m_hash);
+}
+
+bool PadLib::read(const std::string &cacheFile,
+    const std::vector<std::string> &lefFiles, PRLEFReader &db)
+{
+    MappedFile file;
+    if (!file.open(cacheFile))
+    {
+        return false;
+    }
+
+    const char *data = file.data();
+    const size_t bytes = file.size();
+
+    header_t header;
+    if (bytes < sizeof(header))
+    {
+        doLog(LOG_WARN, "LEF cache %s is damaged\n", cacheFile.c_str());
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if ((memcmp(header.m_magic, "PADLIB\0\0", 8) != 0) ||
+        (header.m_version != c_version) ||
+        (header.m_byteOrder != c_byteOrder))
+    {
+        doLog(LOG_INFO, "LEF cache %s has an unsupported format\n", cacheFile.c_str());
+        return false;
+    }
+
+    const size_t filesOffset   = sizeof(header_t);
+    const size_t cellsOffset   = filesOffset + header.m_fileCount * sizeof(fileRecord_t);
+    const size_t layersOffset  = cellsOffset + header.m_cellCount * sizeof(cellRecord_t);
+    const size_t pinsOffset    = layersOffset + header.m_layerCount * sizeof(string_t);
+    const size_t rectsOffset   = pinsOffset + header.m_pinCount * sizeof(pinRecord_t);
+    const size_t stringsOffset = rectsOffset + header.m_rectCount * c_bytesPerRect;
+    if ((stringsOffset + header.m_stringBytes != bytes) ||
+        (hash(data + sizeof(header), bytes - sizeof(header)) != header.m_checksum))
+    {
+        doLog(LOG_WARN, "LEF cache %s is damaged\n", cacheFile.c_str());
+        return false;
+    }
+
+    const char *strings = data + stringsOffset;
+    bool damaged = false;
+    auto getString = [&](const string_t &s)
+        {
+            if (static_cast<uint64_t>(s.m_offset) + s.m_length > header.m_stringBytes)
+            {
+                damaged = true;
+                return std::string_view();
+            }
+            return std::string_view(strings + s.m_offset, s.m_length);
+        };
+
+    // the cache must describe exactly these LEF files
+    bool current = (header.m_fileCount == lefFiles.size());
+    for(uint32_t i=0; current && (i<header.m_fileCount); i++)
+    {
+        fileRecord_t record;
+        memcpy(&record, data + filesOffset + i*sizeof(fileRecord_t), sizeof(record));
+        current = (getString(record.m_name) == lefFiles[i]) && isCurrent(lefFiles[i], record);
+    }
+
+    if (!current || damaged)
+    {
+        doLog(LOG_INFO, "LEF cache %s is out of date\n", cacheFile.c_str());
+        return false;
+    }
+
+    // check all cells before touching the database
+    std::vector<cellRecord_t> records(header.m_cellCount);
+    for(uint32_t i=0; i<header.m_cellCount; i++)
+    {
+        cellRecord_t &record = records[i];
+        memcpy(&record, data + cellsOffset + i*sizeof(cellRecord_t), sizeof(record));
+        getString(record.m_name);
+        getString(record.m_foreign);
+        getString(record.m_symmetry);
+        getString(record.m_class);
+        damaged |= (static_cast<uint64_t>(record.m_firstPin) + record.m_pinCount > header.m_pinCount);
+        damaged |= (static_cast<uint64_t>(record.m_firstObs) + record.m_obsCount > header.m_rectCount);
+    }
+
+    std::vector<string_t> layers(header.m_layerCount);
+    for(uint32_t i=0; i<header.m_layerCount; i++)
+    {
+        memcpy(&layers[i], data + layersOffset + i*sizeof(string_t), sizeof(string_t));
+        getString(layers[i]);
+    }
+
+    std::vector<pinRecord_t> pins(header.m_pinCount);
+    for(uint32_t i=0; i<header.m_pinCount; i++)
+    {
+        pinRecord_t &pin = pins[i];
+        memcpy(&pin, data + pinsOffset + i*sizeof(pinRecord_t), sizeof(pin));
+        getString(pin.m_name);
+        damaged |= (static_cast<uint64_t>(pin.m_firstRect) + pin.m_rectCount > header.m_rectCount);
+    }
+
+    const size_t rects = header.m_rectCount;
+    std::vector<int32_t>  coords(4*rects);
+    std::vector<uint16_t> rectLayers(rects);
+    memcpy(coords.data(), data + rectsOffset, coords.size()*sizeof(int32_t));
+    memcpy(rectLayers.data(), data + rectsOffset + coords.size()*sizeof(int32_t), rects*sizeof(uint16_t));
+    for(auto layer : rectLayers)
+    {
+        damaged |= (layer >= header.m_layerCount);
+    }
+
+    if (damaged)
+    {
+        doLog(LOG_WARN, "LEF cache %s is damaged\n", cacheFile.c_str());
+        return false;
+    }
+
+    // the geometry is added after any that is already in the database
+    std::vector<uint16_t> layerIds(layers.size());
+    for(size_t i=0; i<layers.size(); i++)
+    {
+        layerIds[i] = db.m_geometry.layerId(db.intern(getString(layers[i])));
+    }
+
+    const uint32_t rectBase = db.m_geometry.rectCount();
+    db.m_geometry.reserve(rectBase + header.m_rectCount);
+    for(size_t i=0; i<rects; i++)
+    {
+        db.m_geometry.addRect(layerIds[rectLayers[i]],
+            coords[i], coords[rects + i], coords[2*rects + i], coords[3*rects + i]);
+    }
+
+    const uint32_t pinBase = db.m_geometry.pinCount();
+    for(auto const &record : pins)
+    {
+        auto &pin = db.m_geometry.pin(db.m_geometry.addPin(db.intern(getString(record.m_name))));
+        pin.m_firstRect = rectBase + record.m_firstRect;
+        pin.m_rectCount = record.m_rectCount;
+    }
+
+    db.m_cells.reserve(db.m_cells.size() + records.size());
+    for(auto const &record : records)
+    {
+        auto cell = db.createCell(getString(record.m_name));
+        cell->m_foreign  = db.intern(getString(record.m_foreign));
+        cell->m_symmetry = db.intern(getString(record.m_symmetry));
+        cell->m_class    = db.intern(getString(record.m_class));
+        cell->m_sx       = record.m_sx;
+        cell->m_sy       = record.m_sy;
+        cell->m_isFiller = (record.m_flags & c_flagFiller) != 0;
+        cell->m_hasClass = (record.m_flags & c_flagHasClass) != 0;
+        cell->m_hasForeign = (record.m_flags & c_flagHasForeign) != 0;
+        cell->m_firstPin = pinBase + record.m_firstPin;
+        cell->m_pinCount = record.m_pinCount;
+        cell->m_firstObs = rectBase + record.m_firstObs;
+        cell->m_obsCount = record.m_obsCount;
+
+        auto result = db.m_cells.insert(std::make_pair(cell->m_name, cell));
+        if (!result.second)
+        {
+            // replace a cell that was already in the database
+            auto iter = result.first;
+            if (db.m_parseCell == iter->second)
+            {
+                db.m_parseCell = nullptr;
+            }
+            iter->second = cell;
+        }
+    }
+
+    if (header.m_databaseUnits > 0.0)
+    {
+        db.m_lefDatabaseUnits = header.m_databaseUnits;
+        db.setDatabaseUnits(header.m_databaseUnits);
+    }
+
+    return true;
+}
+
+bool PadLib::write(const std::string &cacheFile,
+    const std::vector<std::string> &lefFiles,
+    const std::vector<fileState_t> &states, const PRLEFReader &db)
+{
+    if (states.size() != lefFiles.size())
+    {
+        return false;
+    }
+
+    std::string strings;
+    auto addString = [&strings](std::string_view str)
+        {
+            string_t entry;
+            entry.m_offset = static_cast<uint32_t>(strings.size());
+            entry.m_length = static_cast<uint32_t>(str.size());
+            strings += str;
+            return entry;
+        };
+
+    std::vector<fileRecord_t> files;
+    for(size_t i=0; i<lefFiles.size(); i++)
+    {
+        fileRecord_t record;
+        record.m_name  = addString(lefFiles[i]);
+        record.m_size  = states[i].m_size;
+        record.m_mtime = states[i].m_mtime;
+        record.m_hash  = states[i].m_hash;
+        files.push_back(record);
+    }
+
+    // only the geometry of the cells in the database is written,
+    // that of replaced cells is left out.
+    const LEFGeometry &geometry = db.m_geometry;
+    std::vector<string_t> layers;
+    for(uint16_t id=0; id<geometry.layerCount(); id++)
+    {
+        layers.push_back(addString(geometry.layerName(id)));
+    }
+
+    std::vector<pinRecord_t> pins;
+    std::vector<uint32_t> rects;    ///< index of each written rectangle in the geometry
+    auto addRects = [&rects](uint32_t first, uint32_t count)
+        {
+            const uint32_t written = static_cast<uint32_t>(rects.size());
+            for(uint32_t i=0; i<count; i++)
+            {
+                rects.push_back(first + i);
+            }
+            return written;
+        };
+
+    std::vector<cellRecord_t> cells;
+    cells.reserve(db.m_cells.size());
+    for(auto const &cell : db.m_cells)
+    {
+        cellRecord_t record;
+        record.m_name     = addString(cell.first);
+        record.m_foreign  = addString(cell.second->m_foreign);
+        record.m_symmetry = addString(cell.second->m_symmetry);
+        record.m_class    = addString(cell.second->m_class);
+        record.m_sx       = cell.second->m_sx;
+        record.m_sy       = cell.second->m_sy;
+        record.m_flags    = (cell.second->m_isFiller ? c_flagFiller : 0) |
+                            (cell.second->m_hasClass ? c_flagHasClass : 0) |
+                            (cell.second->m_hasForeign ? c_flagHasForeign : 0);
+        record.m_reserved = 0;
+
+        record.m_firstPin = static_cast<uint32_t>(pins.size());
+        record.m_pinCount = cell.second->m_pinCount;
+        for(uint32_t i=0; i<cell.second->m_pinCount; i++)
+        {
+            auto const &pin = geometry.pin(cell.second->m_firstPin + i);
+            pinRecord_t pinRecord;
+            pinRecord.m_name      = addString(pin.m_name);
+            pinRecord.m_rectCount = pin.m_rectCount;
+            pinRecord.m_firstRect = addRects(pin.m_firstRect, pin.m_rectCount);
+            pins.push_back(pinRecord);
+        }
+
+        record.m_obsCount = cell.second->m_obsCount;
+        record.m_firstObs = addRects(cell.second->m_firstObs, cell.second->m_obsCount);
+        cells.push_back(record);
+    }
+
+    header_t header;
+    memcpy(header.m_magic, "PADLIB\0\0", 8);
+    header.m_version       = c_version;
+    header.m_byteOrder     = c_byteOrder;
+    header.m_fileCount     = static_cast<uint32_t>(files.size());
+    header.m_cellCount     = static_cast<uint32_t>(cells.size());
+    header.m_layerCount    = static_cast<uint32_t>(layers.size());
+    header.m_pinCount      = static_cast<uint32_t>(pins.size());
+    header.m_rectCount     = static_cast<uint32_t>(rects.size());
+    header.m_reserved      = 0;
+    header.m_stringBytes   = strings.size();
+    header.m_databaseUnits = db.m_lefDatabaseUnits;
+
+    // the payload is assembled in memory so its checksum
+    // can go into the header.
+    std::string payload;
+    auto append = [&payload](const void *src, size_t bytes)
+        {
+            payload.append(static_cast<const char*>(src), bytes);
+        };
+
+    append(files.data(), files.size()*sizeof(fileRecord_t));
+    append(cells.data(), cells.size()*sizeof(cellRecord_t));
+    append(layers.data(), layers.size()*sizeof(string_t));
+    append(pins.data(), pins.size()*sizeof(pinRecord_t));
+
+    const int32_t *columns[4] = {geometry.x1(), geometry.y1(), geometry.x2(), geometry.y2()};
+    std::vector<int32_t> column(rects.size());
+    for(auto src : columns)
+    {
+        for(size_t i=0; i<rects.size(); i++)
+        {
+            column[i] = src[rects[i]];
+        }
+        append(column.data(), column.size()*sizeof(int32_t));
+    }
+
+    std::vector<uint16_t> layerColumn(rects.size());
+    for(size_t i=0; i<rects.size(); i++)
+    {
+        layerColumn[i] = geometry.layers()[rects[i]];
+    }
+    append(layerColumn.data(), layerColumn.size()*sizeof(uint16_t));
+    append(strings.data(), strings.size());
+
+    header.m_checksum = hash(payload.data(), payload.size());
+
+    // write to a temporary file first so a concurrent
+    // reader never sees a half-written cache.
+    const std::string tmpFile = tempFileName(cacheFile);
+    std::error_code ec;
+    {
+        std::ofstream os(tmpFile, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!os.good())
+        {
+            return false;
+        }
+
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(payload.data(), payload.size());
+        if (!os.good())
+        {
+            os.close();
+            std::filesystem::remove(tmpFile, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmpFile, cacheFile, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpFile, ec);
+        return false;
+    }
+    return true;
+}
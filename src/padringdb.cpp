@@ -0,0 +1,238 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include "padringdb.h"
+
+std::string_view PadringDB::locationName(std::string_view location)
+{
+    static constexpr std::string_view c_names[] =
+    {
+        "N", "E", "S", "W", "NE", "NW", "SE", "SW"
+    };
+
+    for(auto name : c_names)
+    {
+        if (name == location)
+        {
+            return name;
+        }
+    }
+    return std::string_view();
+}
+
+bool PadringDB::resolveCells()
+{
+    // each distinct cell is looked up once
+    std::vector<PRLEFReader::LEFCellInfo_t*> cells(m_cellNames.size());
+    for(size_t i=0; i<m_cellNames.size(); i++)
+    {
+        cells[i] = m_lefreader.getCellByName(m_cellNames[i]);
+    }
+
+    struct missing_t
+    {
+        size_t   m_instances = 0;
+        uint32_t m_line = 0;    ///< first line that uses the cell
+    };
+    std::vector<missing_t> missing(m_cellNames.size());
+
+    for(auto const &statement : m_statements)
+    {
+        LayoutItem *item = statement.m_item;
+        if (statement.m_cell == c_noCell)
+        {
+            placeSpace(item);
+            continue;
+        }
+
+        PRLEFReader::LEFCellInfo_t *cell = cells[statement.m_cell];
+        if (cell == nullptr)
+        {
+            missing_t &m = missing[statement.m_cell];
+            if (m.m_instances == 0)
+            {
+                m.m_line = statement.m_line;
+            }
+            m.m_instances += item->m_count;
+            delete item;
+            continue;
+        }
+
+        item->m_lefinfo  = cell;
+        item->m_cellname = cell->m_name;
+        if (item->m_ltype == LayoutItem::TYPE_CORNER)
+        {
+            placeCorner(item);
+        }
+        else
+        {
+            placePad(item);
+        }
+    }
+    m_statements.clear();
+
+    // report the missing cells in one message, by name
+    std::vector<uint32_t> missingCells;
+    size_t instances = 0;
+    for(uint32_t i=0; i<missing.size(); i++)
+    {
+        if (missing[i].m_instances > 0)
+        {
+            missingCells.push_back(i);
+            instances += missing[i].m_instances;
+        }
+    }
+
+    if (missingCells.empty())
+    {
+        return true;
+    }
+
+    std::sort(missingCells.begin(), missingCells.end(), [this](uint32_t a, uint32_t b)
+        {
+            return m_cellNames[a] < m_cellNames[b];
+        });
+
+    const size_t maxNames = 10;
+    std::string names;
+    for(size_t i=0; (i<missingCells.size()) && (i<maxNames); i++)
+    {
+        const uint32_t id = missingCells[i];
+        names += (i > 0) ? ", " : "";
+        names += std::string(m_cellNames[id]) + " (" + std::to_string(missing[id].m_instances);
+        names += (missing[id].m_instances == 1) ? " instance" : " instances";
+        // statements of an INCLUDE carry the line of the INCLUDE
+        if ((missing[id].m_line > 0) && !m_fileName.empty())
+        {
+            names += ", first in " + m_fileName + " line " + std::to_string(missing[id].m_line);
+        }
+        else if (missing[id].m_line > 0)
+        {
+            names += ", first on line " + std::to_string(missing[id].m_line);
+        }
+        names += ")";
+    }
+    if (missingCells.size() > maxNames)
+    {
+        names += " and " + std::to_string(missingCells.size() - maxNames) + " more";
+    }
+
+    doLog(LOG_ERROR, "Cannot find %zu cells, used by %zu instances, in the LEF database: %s\n",
+        missingCells.size(), instances, names.c_str());
+    return false;
+}
+
+void PadringDB::placeCorner(LayoutItem *item_x)
+{
+    const PRLEFReader::LEFCellInfo_t *cell = item_x->m_lefinfo;
+    item_x->m_size = cell->m_sx;
+
+    LayoutItem *item_y = new LayoutItem(*item_x);
+    item_y->m_size = cell->m_sy;
+
+    // Corner cells should be symmetrical
+    // i.e. width = height.
+    const std::string_view location = item_x->m_location;
+    if (location == "NE")
+    {
+        // ROT 180
+        m_north.setLastCorner(item_x);
+        m_east.setLastCorner(item_y);
+    }
+    else if (location == "NW")
+    {
+        // ROT 90
+        m_north.setFirstCorner(item_y);
+        m_west.setLastCorner(item_x);
+    }
+    else if (location == "SE")
+    {
+        // ROT 270
+        m_south.setLastCorner(item_y);
+        m_east.setFirstCorner(item_x);
+    }
+    else if (location == "SW")
+    {
+        // ROT 0
+        m_south.setFirstCorner(item_x);
+        m_west.setFirstCorner(item_y);
+    }
+    else
+    {
+        delete item_x;
+        delete item_y;
+    }
+}
+
+void PadringDB::placePad(LayoutItem *item)
+{
+    item->m_size = item->m_lefinfo->m_sx;
+
+    // the parser only accepts N,S,W and E
+    if (item->m_location == "N")
+    {
+        m_north.addItem(item);
+    }
+    else if (item->m_location == "W")
+    {
+        m_west.addItem(item);
+    }
+    else if (item->m_location == "S")
+    {
+        m_south.addItem(item);
+    }
+    else if (item->m_location == "E")
+    {
+        m_east.addItem(item);
+    }
+    else
+    {
+        doLog(LOG_ERROR, "Incorrect location on PAD %s\n", item->m_instance.c_str());
+        delete item;
+        return;
+    }
+
+    m_lastLocation = item->m_location;
+}
+
+void PadringDB::placeSpace(LayoutItem *item)
+{
+    // a SPACE goes on the edge of the pad before it
+    if (m_lastLocation == "N")
+    {
+        m_north.addItem(item);
+    }
+    else if (m_lastLocation == "W")
+    {
+        m_west.addItem(item);
+    }
+    else if (m_lastLocation == "S")
+    {
+        m_south.addItem(item);
+    }
+    else if (m_lastLocation == "E")
+    {
+        m_east.addItem(item);
+    }
+    else
+    {
+        delete item;
+    }
+}
@@ -0,0 +1,701 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include "prefetcher.h"
+#include "mappedfile.h"
+#include "decompressor.h"
+#include "threadpool.h"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+// IORING_FEAT_RW_CUR_POS arrived with the OPENAT and READ opcodes (Linux 5.6)
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define PREFETCH_IO_URING
+#endif
+
+namespace
+{
+
+constexpr uint32_t c_maxThreads  = 8;           ///< pread fallback workers
+
+// reads from the page cache complete inside io_uring_enter, so a
+// large request would delay the completions of the smaller files.
+// it is also the size of the buffer uncompressed files are read to.
+constexpr size_t   c_readSize    = 4*1024*1024;
+
+constexpr size_t   c_magicBytes  = 4;           ///< enough to recognise a compressed file
+
+double milliseconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace
+
+#ifdef __linux__
+
+#ifdef PREFETCH_IO_URING
+
+/** a minimal io_uring, driven through the raw system calls
+    so padring does not depend on liburing. */
+class Prefetcher::Ring
+{
+public:
+    Ring() : m_fd(-1), m_sq(MAP_FAILED), m_cq(MAP_FAILED), m_sqes(MAP_FAILED),
+        m_sqSize(0), m_cqSize(0), m_sqesSize(0), m_tail(0), m_submitted(0) {}
+
+    ~Ring()
+    {
+        if (m_sqes != MAP_FAILED)
+        {
+            munmap(m_sqes, m_sqesSize);
+        }
+        if ((m_cq != MAP_FAILED) && (m_cq != m_sq))
+        {
+            munmap(m_cq, m_cqSize);
+        }
+        if (m_sq != MAP_FAILED)
+        {
+            munmap(m_sq, m_sqSize);
+        }
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+    }
+
+    bool init(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0)
+        {
+            return false;   // no kernel support, or blocked by a seccomp filter
+        }
+
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0)
+        {
+            return false;   // kernel too old for IORING_OP_OPENAT
+        }
+
+        m_sqSize   = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqSize   = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+        {
+            m_sqSize = std::max(m_sqSize, m_cqSize);
+        }
+
+        m_sq = mmap(nullptr, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sq == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_cq = single ? m_sq :
+            mmap(nullptr, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cq == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (m_sqes == MAP_FAILED)
+        {
+            return false;
+        }
+
+        char *sq = static_cast<char*>(m_sq);
+        char *cq = static_cast<char*>(m_cq);
+        m_sqHead  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        m_sqTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sqMask  = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        m_cqHead  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cqTail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cqMask  = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        m_entries = params.sq_entries;
+        m_tail    = *m_sqTail;
+        m_submitted = m_tail;
+        return true;
+    }
+
+    /** number of submission queue entries */
+    unsigned entries() const
+    {
+        return m_entries;
+    }
+
+    /** a cleared submission entry, nullptr when the queue is full */
+    io_uring_sqe* nextSqe()
+    {
+        unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        if ((m_tail - head) >= m_entries)
+        {
+            return nullptr;
+        }
+
+        unsigned index = m_tail & m_sqMask;
+        m_sqArray[index] = index;
+        m_tail++;
+
+        io_uring_sqe *sqe = static_cast<io_uring_sqe*>(m_sqes) + index;
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        return sqe;
+    }
+
+    /** submit the queued entries and wait for at least one
+        completion. returns false on an unrecoverable error. */
+    bool submitAndWait()
+    {
+        __atomic_store_n(m_sqTail, m_tail, __ATOMIC_RELEASE);
+        unsigned count = m_tail - m_submitted;
+        while(true)
+        {
+            long result = syscall(__NR_io_uring_enter, m_fd, count, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result >= 0)
+            {
+                m_submitted += static_cast<unsigned>(result);
+                return true;
+            }
+
+            if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
+            {
+                return false;
+            }
+        }
+    }
+
+    /** number of queued entries the kernel has not taken yet */
+    unsigned unconsumed() const
+    {
+        return m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    }
+
+    /** wait for a completion without submitting anything.
+        Sleeps briefly instead when the kernel refuses the call. */
+    void waitForCompletion()
+    {
+        if (syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    /** take the next completion, false if there is none */
+    bool nextCqe(io_uring_cqe &cqe)
+    {
+        unsigned head = *m_cqHead;
+        if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+        {
+            return false;
+        }
+
+        cqe = m_cqes[head & m_cqMask];
+        __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+protected:
+    int             m_fd;
+    void            *m_sq;
+    void            *m_cq;
+    void            *m_sqes;
+    size_t          m_sqSize;
+    size_t          m_cqSize;
+    size_t          m_sqesSize;
+
+    unsigned        *m_sqHead;
+    unsigned        *m_sqTail;
+    unsigned        *m_sqArray;
+    unsigned        m_sqMask;
+    unsigned        *m_cqHead;
+    unsigned        *m_cqTail;
+    unsigned        m_cqMask;
+    io_uring_cqe    *m_cqes;
+    unsigned        m_entries;
+
+    unsigned        m_tail;         ///< local submission queue tail
+    unsigned        m_submitted;    ///< entries handed to the kernel
+};
+
+namespace
+{
+
+// io_uring user data: the file index shifted left, and the operation
+enum ringOp_t : uint64_t
+{
+    OP_OPEN = 0,
+    OP_READ = 1
+};
+
+constexpr unsigned c_ringEntries = 64;
+
+} // namespace
+
+bool Prefetcher::startRing()
+{
+    m_ring = std::make_unique<Ring>();
+    if (!m_ring->init(c_ringEntries))
+    {
+        m_ring.reset();
+        return false;
+    }
+    return true;
+}
+
+void Prefetcher::ringLoop()
+{
+    Ring &ring = *m_ring;
+    size_t nextOpen = 0;
+    unsigned inflight = 0;
+
+    auto queueRead = [&ring](file_t &file, uint64_t index) -> bool
+    {
+        io_uring_sqe *sqe = ring.nextSqe();
+        if (sqe == nullptr)
+        {
+            return false;
+        }
+        size_t bytes;
+        sqe->opcode    = IORING_OP_READ;
+        sqe->fd        = file.m_fd;
+        sqe->addr      = reinterpret_cast<uintptr_t>(readTarget(file, bytes));
+        sqe->len       = static_cast<uint32_t>(bytes);
+        sqe->off       = file.m_done;
+        sqe->user_data = (index << 1) | OP_READ;
+        return true;
+    };
+
+    auto close = [this](file_t &file, bool ok)
+    {
+        ::close(file.m_fd);
+        file.m_fd = -1;
+        finish(file, ok);
+    };
+
+    while(true)
+    {
+        // keep the queue filled with opens, in the order the files are needed
+        while((nextOpen < m_files.size()) && (inflight < ring.entries()))
+        {
+            io_uring_sqe *sqe = ring.nextSqe();
+            if (sqe == nullptr)
+            {
+                break;
+            }
+            sqe->opcode     = IORING_OP_OPENAT;
+            sqe->fd         = AT_FDCWD;
+            sqe->addr       = reinterpret_cast<uintptr_t>(m_files[nextOpen].m_name.c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data  = (static_cast<uint64_t>(nextOpen) << 1) | OP_OPEN;
+            nextOpen++;
+            inflight++;
+        }
+
+        if (inflight == 0)
+        {
+            break;
+        }
+
+        if (!ring.submitAndWait())
+        {
+            // the ring is unusable. The entries the kernel has
+            // taken still complete and write into the buffers, so
+            // wait for them and close the files they opened. The
+            // unfinished files are then opened directly by open().
+            unsigned owned = inflight - ring.unconsumed();
+            while(owned > 0)
+            {
+                io_uring_cqe cqe;
+                while((owned > 0) && ring.nextCqe(cqe))
+                {
+                    owned--;
+                    if (((cqe.user_data & 1) == OP_OPEN) && (cqe.res >= 0))
+                    {
+                        ::close(cqe.res);
+                    }
+                }
+
+                if (owned > 0)
+                {
+                    ring.waitForCompletion();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(auto &file : m_files)
+            {
+                if (file.m_fd >= 0)
+                {
+                    ::close(file.m_fd);
+                    file.m_fd = -1;
+                }
+
+                if (!file.m_ready)
+                {
+                    file.m_ready = true;
+                    file.m_ok = false;
+                    file.m_data.reset();
+                }
+            }
+            m_pending = 0;
+            m_allFiles = clock::now();
+            m_cv.notify_all();
+            return;
+        }
+
+        io_uring_cqe cqe;
+        while(ring.nextCqe(cqe))
+        {
+            inflight--;
+            uint64_t index = cqe.user_data >> 1;
+            file_t &file = m_files[index];
+
+            if ((cqe.user_data & 1) == OP_OPEN)
+            {
+                if (cqe.res < 0)
+                {
+                    finish(file, false);
+                    continue;
+                }
+
+                file.m_fd = cqe.res;
+                struct stat st;
+                if ((fstat(file.m_fd, &st) != 0) || !S_ISREG(st.st_mode))
+                {
+                    close(file, false);
+                    continue;
+                }
+
+                file.m_size = static_cast<size_t>(st.st_size);
+                allocate(file);
+                if (file.m_size == 0)
+                {
+                    close(file, true);
+                    continue;
+                }
+            }
+            else if (cqe.res < 0)
+            {
+                if ((cqe.res != -EINTR) && (cqe.res != -EAGAIN))
+                {
+                    close(file, false);
+                    continue;
+                }
+            }
+            else if (cqe.res == 0)
+            {
+                // the file became shorter while it was read
+                file.m_size = file.m_done;
+                close(file, true);
+                continue;
+            }
+            else
+            {
+                received(file, static_cast<size_t>(cqe.res));
+                if (file.m_done == file.m_size)
+                {
+                    close(file, true);
+                    continue;
+                }
+            }
+
+            // a completion frees a queue entry, so this cannot fail
+            if (queueRead(file, index))
+            {
+                inflight++;
+            }
+            else
+            {
+                close(file, false);
+            }
+        }
+    }
+}
+
+#else
+
+class Prefetcher::Ring
+{
+};
+
+bool Prefetcher::startRing()
+{
+    return false;
+}
+
+void Prefetcher::ringLoop()
+{
+}
+
+#endif
+#endif
+
+Prefetcher::Prefetcher() : m_method("none"), m_pending(0), m_firstFileSet(false)
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    m_pool.reset();
+#ifdef __linux__
+    m_ring.reset();
+#endif
+}
+
+void Prefetcher::start(const std::vector<std::string> &filenames, bool allowRing)
+{
+    m_start    = clock::now();
+    m_allFiles = m_start;
+
+    m_files.reserve(filenames.size());
+    for(auto const& name : filenames)
+    {
+        if (m_index.emplace(name, m_files.size()).second)
+        {
+            m_files.emplace_back();
+            m_files.back().m_name = name;
+        }
+    }
+
+    m_pending = m_files.size();
+    if (m_files.empty())
+    {
+        return;
+    }
+
+#ifdef __linux__
+    if (allowRing && startRing())
+    {
+        m_method = "io_uring";
+        m_thread = std::thread([this]() { ringLoop(); });
+        return;
+    }
+#endif
+
+    m_method = "pread";
+    m_pool = std::make_unique<ThreadPool>(std::min(static_cast<uint32_t>(m_files.size()), c_maxThreads));
+    for(auto &file : m_files)
+    {
+        file_t *f = &file;
+        m_pool->submit([this, f]() { readFile(*f); });
+    }
+}
+
+void Prefetcher::readFile(file_t &file)
+{
+#ifndef _WIN32
+    int fd = ::open(file.m_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        finish(file, false);
+        return;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        finish(file, false);
+        return;
+    }
+
+    file.m_size = static_cast<size_t>(st.st_size);
+    allocate(file);
+    bool ok = true;
+    while(file.m_done < file.m_size)
+    {
+        size_t length;
+        char *target = readTarget(file, length);
+        ssize_t bytes = pread(fd, target, length, file.m_done);
+
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        else if (bytes == 0)
+        {
+            // the file became shorter while it was read
+            file.m_size = file.m_done;
+            break;
+        }
+        received(file, static_cast<size_t>(bytes));
+    }
+
+    ::close(fd);
+    finish(file, ok);
+#else
+    // open() reads the file instead
+    finish(file, false);
+#endif
+}
+
+void Prefetcher::allocate(file_t &file)
+{
+    // one read request fits until the first bytes
+    // show whether the file is compressed.
+    file.m_capacity = std::min(file.m_size, c_readSize);
+    file.m_data.reset(new char[file.m_capacity]);
+}
+
+char* Prefetcher::readTarget(file_t &file, size_t &bytes)
+{
+    // an uncompressed file is only read into the page cache,
+    // every read overwrites the buffer.
+    const size_t offset = (file.m_known && !file.m_compressed) ? 0 : file.m_done;
+    bytes = std::min({file.m_size - file.m_done, file.m_capacity - offset, c_readSize});
+    return file.m_data.get() + offset;
+}
+
+void Prefetcher::received(file_t &file, size_t bytes)
+{
+    file.m_done += bytes;
+    if (file.m_known || ((file.m_done < c_magicBytes) && (file.m_done < file.m_size)))
+    {
+        return;
+    }
+
+    file.m_known = true;
+    file.m_compressed = (detectCompression(file.m_data.get(), file.m_done) != COMPRESSION_NONE);
+    if (file.m_compressed && (file.m_capacity < file.m_size))
+    {
+        std::unique_ptr<char[]> data(new char[file.m_size]);
+        memcpy(data.get(), file.m_data.get(), file.m_done);
+        file.m_data = std::move(data);
+        file.m_capacity = file.m_size;
+    }
+}
+
+void Prefetcher::finish(file_t &file, bool ok)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    file.m_ready = true;
+    file.m_ok = ok;
+    if (!ok || !file.m_compressed)
+    {
+        file.m_data.reset();
+    }
+
+    if (--m_pending == 0)
+    {
+        m_allFiles = clock::now();
+    }
+    m_cv.notify_all();
+}
+
+bool Prefetcher::open(const std::string &filename, MappedFile &file)
+{
+    if (!openRaw(filename, file))
+    {
+        return false;
+    }
+
+    if (detectCompression(file.data(), file.size()) != COMPRESSION_NONE)
+    {
+        std::vector<char> contents;
+        if (!decompressBuffer(file.data(), file.size(), contents))
+        {
+            return false;
+        }
+        file.assign(std::move(contents));
+    }
+    return true;
+}
+
+bool Prefetcher::openRaw(const std::string &filename, MappedFile &file)
+{
+    auto iter = m_index.find(filename);
+    if (iter == m_index.end())
+    {
+        return file.open(filename);
+    }
+
+    file_t &f = m_files[iter->second];
+    std::unique_ptr<char[]> data;
+    size_t bytes;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&f]() { return f.m_ready; });
+        if (!f.m_ok || f.m_taken)
+        {
+            // let the regular path report the problem
+            lock.unlock();
+            return file.open(filename);
+        }
+        data = std::move(f.m_data);
+        bytes = f.m_size;
+        f.m_taken = true;
+    }
+
+    // an uncompressed file is in the page cache now
+    if (data)
+    {
+        file.assign(std::move(data), bytes);
+    }
+    else if (!file.open(filename))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_firstFileSet)
+    {
+        m_firstFile = clock::now();
+        m_firstFileSet = true;
+    }
+    return true;
+}
+
+double Prefetcher::firstFileTime() const
+{
+    return m_firstFileSet ? milliseconds(m_firstFile - m_start) : -1.0;
+}
+
+double Prefetcher::allFilesTime()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return m_pending == 0; });
+    return milliseconds(m_allFiles - m_start);
+}
@@ -17,53 +17,281 @@
     
 */
 
+#include <algorithm>
+#include <cmath>
 #include "prlefreader.h"
+#include "lefscanner.h"
 #include "logging.h"
+#include "threadpool.h"
 
-PRLEFReader::PRLEFReader() : m_parseCell(nullptr)
+PRLEFReader::PRLEFReader() : m_parseCell(nullptr), m_strings(m_arena),
+    m_geomTarget(GEOM_NONE), m_geomPin(0), m_geomLayer(-1), m_deferredLog(nullptr)
 {
     m_lefDatabaseUnits = 0.0f;
+
+    // pin directions, uses, sites and technology layers are not needed
+    setCallbacks(CB_MACRO | CB_CLASS | CB_FOREIGN | CB_SYMMETRY | CB_PIN | CB_GEOMETRY);
 }
 
-void PRLEFReader::onMacro(const std::string &macroName)
+void PRLEFReader::onMacro(std::string_view macroName)
 {
-    // perform integrity checks on the previous cell
-    if (m_parseCell != nullptr)
-    {
-        doIntegrityChecks();
-    }
-
     // note: unordered_map::insert will only insert the element
     // if the key is not already present.
     // Therefore, we must first check if a cell/key is already 
     // present and handle it accordingly.
 
+    finishCell();
+    m_geomTarget = GEOM_NONE;
+    m_geomLayer  = -1;
+
+    // a parsed macro replaces an indexed one
+    const bool wasIndexed = (m_lazyMacros.erase(macroName) != 0);
+
     auto iter = m_cells.find(macroName);
+    const bool replaced = (iter != m_cells.end()) || wasIndexed;
     if (iter != m_cells.end())
     {
-        doLog(LOG_WARN,"Cell %s already in database - replaced\n", macroName.c_str());
+        // start from scratch so nothing of the
+        // previous definition survives.
         m_parseCell = iter->second;
+        *m_parseCell = LEFCellInfo_t();
+        m_parseCell->m_name = iter->first;
+    }
+    else
+    {
+        m_parseCell = createCell(macroName);
+        m_cells.insert(std::make_pair(m_parseCell->m_name, m_parseCell));
+    }
+
+    if (m_deferredLog != nullptr)
+    {
+        m_macroEvents.push_back({m_parseCell->m_name, m_deferredLog->size()});
     }
     else
     {
-        m_parseCell = new LEFCellInfo_t();
-        m_parseCell->m_name = macroName;
-        m_cells.insert(std::make_pair(macroName, m_parseCell));
+        logCellAdded(macroName, replaced);
+    }
+}
 
-        doLog(LOG_VERBOSE,"Added LEF cell %s\n", macroName.c_str());
+void PRLEFReader::logCellAdded(std::string_view macroName, bool replaced) const
+{
+    const int len = static_cast<int>(macroName.size());
+    if (replaced)
+    {
+        doLog(LOG_WARN,"Cell %.*s already in database - replaced\n", len, macroName.data());
+    }
+    else
+    {
+        doLog(LOG_VERBOSE,"Added LEF cell %.*s\n", len, macroName.data());
     }
 }
 
-PRLEFReader::LEFCellInfo_t *PRLEFReader::getCellByName(const std::string &macroName) const
+void PRLEFReader::finishCell()
+{
+    if ((m_parseCell != nullptr) && !m_parseCell->m_hasForeign)
+    {
+        m_parseCell->m_foreign = m_parseCell->m_name;
+    }
+}
+
+void PRLEFReader::onEndParse()
+{
+    finishCell();
+}
+
+void PRLEFReader::reintern(LEFCellInfo_t *cell)
+{
+    cell->m_name     = m_strings.intern(cell->m_name);
+    cell->m_foreign  = m_strings.intern(cell->m_foreign);
+    cell->m_symmetry = m_strings.intern(cell->m_symmetry);
+    cell->m_class    = m_strings.intern(cell->m_class);
+}
+
+void PRLEFReader::merge(PRLEFReader &other, const LogCapture &otherLog)
+{
+    // the cells and strings of the other reader
+    // become ours without being copied.
+    m_arena.adopt(other.m_arena);
+    m_strings.merge(other.m_strings);
+    mergeGeometry(other);
+    m_errorCount += other.m_errorCount;
+
+    size_t logPos = 0;
+    for(auto const &event : other.m_macroEvents)
+    {
+        otherLog.replay(logPos, event.m_logPos);
+        logPos = event.m_logPos;
+
+        // the other reader holds the final definition
+        // of each macro, even if it was defined twice.
+        LEFCellInfo_t *cell = other.m_cells.at(event.m_name);
+        reintern(cell);
+
+        auto iter = m_cells.find(cell->m_name);
+        if (iter != m_cells.end())
+        {
+            iter->second = cell;
+            logCellAdded(cell->m_name, true);
+        }
+        else
+        {
+            m_cells.insert(std::make_pair(cell->m_name, cell));
+            logCellAdded(cell->m_name, false);
+        }
+    }
+    otherLog.replay(logPos, otherLog.size());
+
+    if (other.m_lefDatabaseUnits > 0.0)
+    {
+        m_lefDatabaseUnits = other.m_lefDatabaseUnits;
+        setDatabaseUnits(m_lefDatabaseUnits);
+    }
+
+    other.m_cells.clear();
+    other.m_macroEvents.clear();
+    other.m_parseCell = nullptr;
+}
+
+void PRLEFReader::mergeGeometry(PRLEFReader &other)
+{
+    auto offsets = m_geometry.append(other.m_geometry, m_strings);
+    for(auto const &cell : other.m_cells)
+    {
+        cell.second->m_firstPin += offsets.m_pins;
+        cell.second->m_firstObs += offsets.m_rects;
+    }
+}
+
+PRLEFReader::LEFCellInfo_t *PRLEFReader::getCellByName(std::string_view macroName)
 {
     auto iter = m_cells.find(macroName);
     if (iter == m_cells.end())
     {
-        return nullptr;
+        return materialize(macroName);
     }
     return iter->second;
 }
 
+bool PRLEFReader::indexFile(const std::string &filename)
+{
+    // indexed macros need random access, so compressed
+    // files are decompressed into memory.
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->openDecompressed(filename))
+    {
+        return false;
+    }
+
+    indexFile(std::move(file));
+    return true;
+}
+
+void PRLEFReader::indexFile(std::unique_ptr<MappedFile> file)
+{
+    auto sections = LEFScanner::scan(file->data(), file->size());
+    indexFile(std::move(file), sections);
+}
+
+void PRLEFReader::indexFile(std::unique_ptr<MappedFile> file,
+    const std::vector<LEFScanner::section_t> &sections)
+{
+    for(auto const &section : sections)
+    {
+        if (section.m_type == LEFScanner::SEC_UNITS)
+        {
+            parse(file->data() + section.m_begin, section.m_end - section.m_begin, section.m_line);
+        }
+        else if (section.m_type == LEFScanner::SEC_MACRO)
+        {
+            std::string_view macroName = m_strings.intern(section.m_name);
+
+            // the latest definition wins, as when parsing
+            auto iter = m_cells.find(macroName);
+            bool replaced = (iter != m_cells.end());
+            if (replaced)
+            {
+                if (m_parseCell == iter->second)
+                {
+                    m_parseCell = nullptr;
+                }
+                m_cells.erase(iter);
+            }
+
+            lazyMacro_t macro;
+            macro.m_data     = file->data() + section.m_begin;
+            macro.m_bytes    = section.m_end - section.m_begin;
+            macro.m_line     = section.m_line;
+            macro.m_isFiller = (section.m_class.find("SPACER") != std::string_view::npos);
+            macro.m_databaseUnits = m_databaseUnits;
+
+            auto result = m_lazyMacros.insert(std::make_pair(macroName, macro));
+            if (!result.second)
+            {
+                result.first->second = macro;
+                replaced = true;
+            }
+
+            if (replaced)
+            {
+                logCellAdded(macroName, true);
+            }
+        }
+    }
+
+    m_lazyFiles.push_back(std::move(file));
+}
+
+void PRLEFReader::materializeFillers(const std::string &prefix)
+{
+    std::vector<std::string_view> fillers;
+    for(auto const &macro : m_lazyMacros)
+    {
+        const bool isFiller = prefix.empty() ? macro.second.m_isFiller :
+            (macro.first.rfind(prefix, 0) == 0);
+        if (isFiller)
+        {
+            fillers.push_back(macro.first);
+        }
+    }
+
+    for(auto const &name : fillers)
+    {
+        materialize(name);
+    }
+}
+
+PRLEFReader::LEFCellInfo_t *PRLEFReader::materialize(std::string_view macroName)
+{
+    auto iter = m_lazyMacros.find(macroName);
+    if (iter == m_lazyMacros.end())
+    {
+        return nullptr;
+    }
+
+    const lazyMacro_t macro = iter->second;
+    m_lazyMacros.erase(iter);
+
+    // parse the macro on its own and take its cell
+    PRLEFReader reader;
+    reader.setDatabaseUnits(macro.m_databaseUnits);
+    reader.parse(macro.m_data, macro.m_bytes, macro.m_line);
+
+    auto cellIter = reader.m_cells.find(macroName);
+    if (cellIter == reader.m_cells.end())
+    {
+        return nullptr;
+    }
+
+    mergeGeometry(reader);
+
+    // the reader and its arena go away, keep a copy
+    LEFCellInfo_t *cell = m_arena.create<LEFCellInfo_t>(*cellIter->second);
+    reintern(cell);
+
+    m_cells.insert(std::make_pair(cell->m_name, cell));
+    return cell;
+}
+
 void PRLEFReader::onSize(double sx, double sy)
 {
     if (m_parseCell == nullptr)
@@ -76,7 +304,7 @@ void PRLEFReader::onSize(double sx, double sy)
     m_parseCell->m_sy = sy;
 }
 
-void PRLEFReader::onForeign(const std::string &foreignName, double ox, double oy)
+void PRLEFReader::onForeign(std::string_view foreignName, double ox, double oy)
 {
     if (m_parseCell == nullptr)
     {
@@ -84,10 +312,11 @@ void PRLEFReader::onForeign(const std::string &foreignName, double ox, double oy
         return;
     }
 
-    m_parseCell->m_foreign = foreignName;
+    m_parseCell->m_foreign = m_strings.intern(foreignName);
+    m_parseCell->m_hasForeign = true;
 }
 
-void PRLEFReader::onSymmetry(const std::string &symmetry)
+void PRLEFReader::onSymmetry(std::string_view symmetry)
 {
     if (m_parseCell == nullptr)
     {
@@ -95,39 +324,79 @@ void PRLEFReader::onSymmetry(const std::string &symmetry)
         return;
     }
 
-    m_parseCell->m_symmetry = symmetry;
+    m_parseCell->m_symmetry = m_strings.intern(symmetry);
 }
 
-void PRLEFReader::doIntegrityChecks()
+void PRLEFReader::onPin(std::string_view pinName)
 {
-    // perform integrity checks on the current cell
     if (m_parseCell == nullptr)
     {
-        doLog(LOG_ERROR, "PRLEFReader: cannot do integrity checks on a NULL cell\n");
+        doLog(LOG_ERROR, "PRLEFReader: got pin before finding a macro\n");
         return;
     }
 
-    if (m_parseCell->m_foreign.empty())
+    m_geomPin = m_geometry.addPin(m_strings.intern(pinName));
+    if (m_parseCell->m_pinCount == 0)
     {
-        m_parseCell->m_foreign = m_parseCell->m_name;
+        m_parseCell->m_firstPin = m_geomPin;
     }
+    m_parseCell->m_pinCount++;
+    m_geomTarget = GEOM_PIN;
+    m_geomLayer  = -1;
+}
 
-    if (m_parseCell->m_name.empty())
+void PRLEFReader::onObstruction()
+{
+    if (m_parseCell == nullptr)
     {
-        doLog(LOG_ERROR, "PRLEFReader: current cell has no name!\n");
+        doLog(LOG_ERROR, "PRLEFReader: got obstruction before finding a macro\n");
         return;
     }
 
-    if ((m_parseCell->m_sx == 0.0) || (m_parseCell->m_sy == 0.0))
+    if (m_parseCell->m_obsCount == 0)
     {
-        doLog(LOG_ERROR,"PRLEFReader: cell %s has zero width or height\n",
-            m_parseCell->m_name.c_str());
+        m_parseCell->m_firstObs = m_geometry.rectCount();
     }
+    m_geomTarget = GEOM_OBS;
+    m_geomLayer  = -1;
 }
 
-void PRLEFReader::onClass(const std::string &className)
+void PRLEFReader::onGeometryLayer(std::string_view layerName)
 {
-    if (className.find("SPACER") != std::string::npos)
+    m_geomLayer = m_geometry.layerId(m_strings.intern(layerName));
+}
+
+void PRLEFReader::onRectDBU(int64_t x1, int64_t y1, int64_t x2, int64_t y2)
+{
+    if ((m_parseCell == nullptr) || (m_geomTarget == GEOM_NONE) || (m_geomLayer < 0))
+    {
+        return;
+    }
+
+    if (!m_geometry.addRect(static_cast<uint16_t>(m_geomLayer), x1, y1, x2, y2))
+    {
+        doLog(LOG_ERROR, "PRLEFReader: rectangle of cell %s is out of range\n",
+            m_parseCell->m_name.data());
+        return;
+    }
+
+    if (m_geomTarget == GEOM_PIN)
+    {
+        m_geometry.pin(m_geomPin).m_rectCount++;
+    }
+    else
+    {
+        m_parseCell->m_obsCount++;
+    }
+}
+
+void PRLEFReader::onClass(std::string_view className)
+{
+    // the reader puts a space after every word, including the last one
+    const size_t last = className.find_last_not_of(' ');
+    m_parseCell->m_hasClass = true;
+    m_parseCell->m_class    = m_strings.intern(className.substr(0, last + 1));
+    if (className.find("SPACER") != std::string_view::npos)
     {
         m_parseCell->m_isFiller = true;
     }
@@ -142,3 +411,152 @@ void PRLEFReader::onDatabaseUnitsMicrons(double unitsPerMicron)
     m_lefDatabaseUnits = unitsPerMicron;
     //doLog(LOG_INFO,"LEF database units: %f units per micron\n", unitsPerMicron);
 }
+
+PRLEFReader::integrityReport_t PRLEFReader::checkCells(double grid, uint32_t jobs,
+    const std::vector<std::string_view> &corners) const
+{
+    // the checks are not done while parsing, so the
+    // parser does not branch on them for every macro.
+    std::vector<const LEFCellInfo_t*> cells;
+    cells.reserve(m_cells.size());
+    for(auto const &cell : m_cells)
+    {
+        cells.push_back(cell.second);
+    }
+
+    if (jobs == 0)
+    {
+        jobs = ThreadPool::defaultThreadCount();
+    }
+
+    // each chunk collects the names of its offending cells
+    constexpr size_t c_chunkSize = 4096;
+    const size_t chunks = (cells.size() + c_chunkSize - 1) / c_chunkSize;
+    std::vector<integrityReport_t> partial(chunks);
+
+    auto isOnGrid = [grid](double size)
+    {
+        const double steps = size / grid;
+        return std::fabs(steps - std::round(steps)) <= 1.0e-6;
+    };
+
+    auto checkChunk = [&](size_t chunk)
+    {
+        integrityReport_t &report = partial[chunk];
+        const size_t last = std::min(cells.size(), (chunk+1)*c_chunkSize);
+        for(size_t i=chunk*c_chunkSize; i<last; i++)
+        {
+            const LEFCellInfo_t *cell = cells[i];
+            if ((cell->m_sx == 0.0) || (cell->m_sy == 0.0))
+            {
+                report.m_examples[integrityReport_t::ISSUE_ZERO_SIZE].push_back(cell->m_name);
+            }
+
+            if (!cell->m_hasForeign)
+            {
+                report.m_examples[integrityReport_t::ISSUE_NO_FOREIGN].push_back(cell->m_name);
+            }
+
+            if (!cell->m_hasClass)
+            {
+                report.m_examples[integrityReport_t::ISSUE_NO_CLASS].push_back(cell->m_name);
+            }
+
+            if ((grid > 0.0) && !isOnGrid(cell->m_sx))
+            {
+                report.m_examples[integrityReport_t::ISSUE_OFF_GRID].push_back(cell->m_name);
+            }
+        }
+    };
+
+    if ((jobs == 1) || (chunks <= 1))
+    {
+        for(size_t chunk=0; chunk<chunks; chunk++)
+        {
+            checkChunk(chunk);
+        }
+    }
+    else
+    {
+        ThreadPool pool(static_cast<uint32_t>(std::min<size_t>(jobs, chunks)));
+        pool.parallelFor(chunks, checkChunk);
+    }
+
+    // corners are placed along both edges, so their
+    // height has to be a multiple of the grid as well.
+    if (grid > 0.0)
+    {
+        integrityReport_t cornerReport;
+        std::vector<std::string_view> cornerCells(corners);
+        std::sort(cornerCells.begin(), cornerCells.end());
+        cornerCells.erase(std::unique(cornerCells.begin(), cornerCells.end()), cornerCells.end());
+        for(auto const &name : cornerCells)
+        {
+            auto iter = m_cells.find(name);
+            if ((iter != m_cells.end()) && isOnGrid(iter->second->m_sx) && !isOnGrid(iter->second->m_sy))
+            {
+                cornerReport.m_examples[integrityReport_t::ISSUE_OFF_GRID].push_back(iter->first);
+            }
+        }
+        partial.push_back(std::move(cornerReport));
+    }
+
+    // aggregate, keeping the alphabetically first few names
+    // so the report does not depend on the hash order.
+    constexpr size_t c_maxExamples = 5;
+    integrityReport_t report;
+    report.m_checked = cells.size();
+    for(size_t issue=0; issue<integrityReport_t::ISSUE_COUNT; issue++)
+    {
+        auto &names = report.m_examples[issue];
+        for(auto const &chunk : partial)
+        {
+            names.insert(names.end(), chunk.m_examples[issue].begin(), chunk.m_examples[issue].end());
+        }
+        report.m_count[issue] = names.size();
+
+        const size_t keep = std::min(names.size(), c_maxExamples);
+        std::partial_sort(names.begin(), names.begin() + keep, names.end());
+        names.resize(keep);
+    }
+    return report;
+}
+
+void PRLEFReader::logReport(const integrityReport_t &report)
+{
+    struct issueInfo_t
+    {
+        logtype_t   m_level;
+        const char *m_text;
+    };
+
+    static const issueInfo_t c_issues[integrityReport_t::ISSUE_COUNT] =
+    {
+        {LOG_ERROR,   "have zero width or height"},
+        {LOG_VERBOSE, "have no FOREIGN name, using the cell name"},
+        {LOG_WARN,    "have no CLASS and cannot be detected as filler"},
+        {LOG_WARN,    "have a width, or as a corner a height, that is not a multiple of the grid"}
+    };
+
+    for(size_t issue=0; issue<integrityReport_t::ISSUE_COUNT; issue++)
+    {
+        if (report.m_count[issue] == 0)
+        {
+            continue;
+        }
+
+        std::string names;
+        for(auto const &name : report.m_examples[issue])
+        {
+            names += names.empty() ? "" : ", ";
+            names += name;
+        }
+        if (report.m_count[issue] > report.m_examples[issue].size())
+        {
+            names += ", ...";
+        }
+
+        doLog(c_issues[issue].m_level, "%zu of %zu cells %s: %s\n", report.m_count[issue],
+            report.m_checked, c_issues[issue].m_text, names.c_str());
+    }
+}
@@ -0,0 +1,260 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+#include "shapeindex.h"
+
+namespace
+{
+
+/** position of a point along a Hilbert curve through a 65536 x 65536 grid */
+uint64_t hilbertIndex(uint32_t x, uint32_t y)
+{
+    const uint32_t n = 1u << 16;
+    uint64_t d = 0;
+    for(uint32_t s = n/2; s > 0; s /= 2)
+    {
+        const uint32_t rx = (x & s) ? 1 : 0;
+        const uint32_t ry = (y & s) ? 1 : 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+} // namespace
+
+uint32_t ShapeIndex::addItem(const LayoutItem *item, const PRLEFReader &db)
+{
+    const uint32_t itemIndex = static_cast<uint32_t>(m_items.size());
+    m_items.push_back(item);
+
+    const PRLEFReader::LEFCellInfo_t *cell = item->m_lefinfo;
+    if (cell == nullptr)
+    {
+        return itemIndex;
+    }
+
+    const LayoutItem::placement_t placement = item->getPlacement();
+    auto transform = [&placement](double x, double y, double &tx, double &ty)
+        {
+            if (placement.m_flip)
+            {
+                y = -y;
+            }
+
+            switch(placement.m_rotation)
+            {
+            case 90:
+                tx = -y;
+                ty = x;
+                break;
+            case 180:
+                tx = -x;
+                ty = -y;
+                break;
+            case 270:
+                tx = y;
+                ty = -x;
+                break;
+            default:
+                tx = x;
+                ty = y;
+            }
+            tx += placement.m_x;
+            ty += placement.m_y;
+        };
+
+    auto place = [&transform](double x1, double y1, double x2, double y2)
+        {
+            box_t box;
+            transform(x1, y1, box.m_x1, box.m_y1);
+            transform(x2, y2, box.m_x2, box.m_y2);
+            if (box.m_x1 > box.m_x2)
+            {
+                std::swap(box.m_x1, box.m_x2);
+            }
+            if (box.m_y1 > box.m_y2)
+            {
+                std::swap(box.m_y1, box.m_y2);
+            }
+            return box;
+        };
+
+    shape_t shape;
+    shape.m_item  = itemIndex;
+    shape.m_pin   = 0;
+    shape.m_layer = 0;
+    shape.m_kind  = SHAPE_OUTLINE;
+    shape.m_box   = place(0.0, 0.0, cell->m_sx, cell->m_sy);
+    m_shapes.push_back(shape);
+
+    // the geometry is only there when the LEF units are known
+    if (db.m_lefDatabaseUnits <= 0.0)
+    {
+        return itemIndex;
+    }
+
+    const double scale = 1.0 / db.m_lefDatabaseUnits;
+    const LEFGeometry &geometry = db.m_geometry;
+    auto addRect = [&](uint32_t rect, shapeKind_t kind, uint32_t pin)
+        {
+            shape.m_box = place(geometry.x1()[rect] * scale, geometry.y1()[rect] * scale,
+                geometry.x2()[rect] * scale, geometry.y2()[rect] * scale);
+            shape.m_layer = geometry.layers()[rect];
+            shape.m_kind  = kind;
+            shape.m_pin   = pin;
+            m_shapes.push_back(shape);
+        };
+
+    for(uint32_t p=cell->m_firstPin; p<cell->m_firstPin + cell->m_pinCount; p++)
+    {
+        const LEFGeometry::pin_t &pin = geometry.pin(p);
+        for(uint32_t r=pin.m_firstRect; r<pin.m_firstRect + pin.m_rectCount; r++)
+        {
+            addRect(r, SHAPE_PIN, p);
+        }
+    }
+
+    for(uint32_t r=cell->m_firstObs; r<cell->m_firstObs + cell->m_obsCount; r++)
+    {
+        addRect(r, SHAPE_OBS, 0);
+    }
+
+    return itemIndex;
+}
+
+void ShapeIndex::build()
+{
+    m_nodes.clear();
+    m_leafNodes = 0;
+    if (m_shapes.empty())
+    {
+        return;
+    }
+
+    // sort the shapes along a Hilbert curve through
+    // their centres, so nearby shapes share nodes.
+    box_t bounds = m_shapes[0].m_box;
+    for(auto const &shape : m_shapes)
+    {
+        bounds.extend(shape.m_box);
+    }
+
+    const double width  = std::max(bounds.m_x2 - bounds.m_x1, 1.0e-9);
+    const double height = std::max(bounds.m_y2 - bounds.m_y1, 1.0e-9);
+    const double scaleX = 65535.0 / width;
+    const double scaleY = 65535.0 / height;
+
+    std::vector<std::pair<uint64_t, uint32_t> > order;
+    order.reserve(m_shapes.size());
+    for(uint32_t i=0; i<m_shapes.size(); i++)
+    {
+        const box_t &box = m_shapes[i].m_box;
+        const double cx = 0.5*(box.m_x1 + box.m_x2) - bounds.m_x1;
+        const double cy = 0.5*(box.m_y1 + box.m_y2) - bounds.m_y1;
+        order.emplace_back(hilbertIndex(static_cast<uint32_t>(cx * scaleX),
+            static_cast<uint32_t>(cy * scaleY)), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<shape_t> sorted;
+    sorted.reserve(m_shapes.size());
+    for(auto const &entry : order)
+    {
+        sorted.push_back(m_shapes[entry.second]);
+    }
+    m_shapes.swap(sorted);
+
+    // leaf nodes over runs of shapes
+    const uint32_t shapeCount = static_cast<uint32_t>(m_shapes.size());
+    for(uint32_t i=0; i<shapeCount; i+=c_nodeSize)
+    {
+        node_t node;
+        node.m_first = i;
+        node.m_count = std::min(c_nodeSize, shapeCount - i);
+        node.m_box   = m_shapes[i].m_box;
+        for(uint32_t j=i+1; j<i+node.m_count; j++)
+        {
+            node.m_box.extend(m_shapes[j].m_box);
+        }
+        m_nodes.push_back(node);
+    }
+    m_leafNodes = static_cast<uint32_t>(m_nodes.size());
+
+    // parent levels until a single root remains
+    uint32_t levelBegin = 0;
+    uint32_t levelEnd = m_leafNodes;
+    while(levelEnd - levelBegin > 1)
+    {
+        for(uint32_t i=levelBegin; i<levelEnd; i+=c_nodeSize)
+        {
+            node_t node;
+            node.m_first = i;
+            node.m_count = std::min(c_nodeSize, levelEnd - i);
+            node.m_box   = m_nodes[i].m_box;
+            for(uint32_t j=i+1; j<i+node.m_count; j++)
+            {
+                node.m_box.extend(m_nodes[j].m_box);
+            }
+            m_nodes.push_back(node);
+        }
+        levelBegin = levelEnd;
+        levelEnd = static_cast<uint32_t>(m_nodes.size());
+    }
+}
+
+std::vector<std::pair<uint32_t, uint32_t> > ShapeIndex::findOverlaps(double tolerance) const
+{
+    std::vector<std::pair<uint32_t, uint32_t> > overlaps;
+    for(auto const &shape : m_shapes)
+    {
+        if (shape.m_kind != SHAPE_OUTLINE)
+        {
+            continue;
+        }
+
+        query(shape.m_box, [&](const shape_t &other)
+            {
+                if ((other.m_kind == SHAPE_OUTLINE) && (other.m_item > shape.m_item))
+                {
+                    const box_t &a = shape.m_box;
+                    const box_t &b = other.m_box;
+                    const double dx = std::min(a.m_x2, b.m_x2) - std::max(a.m_x1, b.m_x1);
+                    const double dy = std::min(a.m_y2, b.m_y2) - std::max(a.m_y1, b.m_y1);
+                    if ((dx > tolerance) && (dy > tolerance))
+                    {
+                        overlaps.emplace_back(shape.m_item, other.m_item);
+                    }
+                }
+                return true;
+            });
+    }
+
+    std::sort(overlaps.begin(), overlaps.end());
+    return overlaps;
+}
@@ -0,0 +1,170 @@
+#!/usr/bin/python3
+
+#
+# Feed truncated and mutated LEF files to padring and check that
+# every one of them is read, and that reading time grows linearly
+# with the file size. Run from the tests directory, like run_tests.py.
+#
+# usage: fuzz_lef.py [--quick] [--padring <executable>] [seed]
+#
+# --quick runs fewer mutations and truncations, it is used by run_tests.py.
+#
+
+import argparse
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+TIMEOUT = 20        # seconds for a single run, anything longer is a hang
+SMALL_COPIES = 100  # macro blocks in the small variant of each input
+SCALE = 8           # the large variant holds SCALE times as many blocks
+SLACK = 4.0         # allowed deviation from linear scaling
+MARGIN = 0.25       # seconds, absorbs timer and scheduling noise
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--quick", action="store_true", help="run a reduced set of cases")
+parser.add_argument("--padring", default="../build/padring", help="padring executable")
+parser.add_argument("seed", nargs="?", type=int, default=1)
+args = parser.parse_args()
+
+PADRING = args.padring
+MUTATIONS = 10 if args.quick else 30
+TRUNCATIONS = 3 if args.quick else 10
+
+rng = random.Random(args.seed)
+
+# split the example LEF into its header and the macro block
+lef = open("iocells.lef").read()
+lef = lef[:lef.rfind("END LIBRARY")]
+first = lef.find("\nMACRO ") + 1
+header = lef[:first]
+block = lef[first:]
+names = re.findall(r"^MACRO (\w+)", block, re.M)
+
+def renamed(text, index):
+    for name in names:
+        text = re.sub(r"\b" + name + r"\b", name + "_" + str(index), text)
+    return text
+
+def mutate(text):
+    lines = text.split("\n")
+    kind = rng.randrange(7)
+    pos = rng.randrange(len(lines))
+    if kind == 0:       # drop a line, often an END
+        del lines[pos]
+    elif kind == 1:     # repeat a line
+        lines.insert(pos, lines[pos])
+    elif kind == 2:     # drop every END line after pos
+        lines = lines[:pos] + [l for l in lines[pos:] if not l.strip().startswith("END")]
+    elif kind == 3:     # characters the tokenizer does not accept
+        lines[pos] = lines[pos] + " $%&"
+    elif kind == 4:     # cut a line short
+        lines[pos] = lines[pos][:rng.randrange(len(lines[pos]) + 1)]
+    elif kind == 5:     # random bytes
+        junk = "".join(chr(rng.randrange(32, 127)) for i in range(rng.randrange(1, 40)))
+        lines[pos] = lines[pos] + junk
+    else:               # join two lines
+        if pos + 1 < len(lines):
+            lines[pos] = lines[pos] + " " + lines.pop(pos + 1)
+    return "\n".join(lines)
+
+def build(blocks, copies, truncate):
+    parts = [header]
+    for i in range(copies):
+        parts.append(renamed(blocks[i % len(blocks)], i))
+    text = "".join(parts)
+    if truncate is not None:
+        text = text[:int(len(text) * truncate)]
+    return text
+
+def timed_run(filename):
+    # the configuration does not exist: padring stops after reading the LEF
+    best = None
+    for run in range(3):
+        start = time.monotonic()
+        try:
+            subprocess.run([PADRING, "-q", "-j", "1", "--lef", filename, "missing.config"],
+                stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, timeout=TIMEOUT)
+        except subprocess.TimeoutExpired:
+            return None
+        elapsed = time.monotonic() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+def run_file(text, filename):
+    with open(filename, "w") as f:
+        f.write(text)
+    return timed_run(filename)
+
+workdir = tempfile.mkdtemp()
+small_name = os.path.join(workdir, "small.lef")
+large_name = os.path.join(workdir, "large.lef")
+
+baseline = run_file(header, small_name)
+
+cases = []
+for i in range(MUTATIONS):
+    mutations = rng.randrange(1, 4)
+    mutated = block
+    for m in range(mutations):
+        mutated = mutate(mutated)
+    cases.append(("mutation " + str(i), [mutated, block], None))
+for i in range(TRUNCATIONS):
+    cases.append(("truncation " + str(i), [block], rng.random()))
+
+failed = 0
+
+# cut a single block short at every line, and within every line:
+# each input must be read without hanging
+text = build([block], 1, None)
+cuts = []
+pos = text.find("\n")
+while pos >= 0:
+    cuts.append(pos)
+    cuts.append(pos - 2)
+    pos = text.find("\n", pos + 1)
+hangs = 0
+for cut in cuts:
+    with open(small_name, "w") as f:
+        f.write(text[:cut])
+    try:
+        subprocess.run([PADRING, "-q", "-j", "1", "--lef", small_name, "missing.config"],
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, timeout=TIMEOUT)
+    except subprocess.TimeoutExpired:
+        hangs = hangs + 1
+name = "every line cut"
+spaces = 30 - len(name)
+if hangs > 0:
+    failed = failed + 1
+    print(name + (' '*spaces) + "*** FAIL *** (%d of %d inputs hang)" % (hangs, len(cuts)))
+else:
+    print(name + (' '*spaces) + "OK!")
+
+for name, blocks, truncate in cases:
+    t_small = run_file(build(blocks, SMALL_COPIES, truncate), small_name)
+    t_large = run_file(build(blocks, SMALL_COPIES * SCALE, truncate), large_name)
+
+    spaces = 30 - len(name)
+    if (t_small is None) or (t_large is None):
+        failed = failed + 1
+        print(name + (' '*spaces) + "*** FAIL *** (timeout)")
+        continue
+
+    limit = SCALE * SLACK * max(t_small - baseline, 0.0) + MARGIN
+    if (t_large - baseline) > limit:
+        failed = failed + 1
+        print(name + (' '*spaces) + "*** FAIL *** (%.3fs for %dx the input, limit %.3fs)"
+            % (t_large - baseline, SCALE, limit))
+    else:
+        print(name + (' '*spaces) + "OK!")
+
+os.remove(small_name)
+os.remove(large_name)
+os.rmdir(workdir)
+
+print("\nFailed tests: " + str(failed))
+sys.exit(1 if failed > 0 else 0)
@@ -0,0 +1,99 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+/*
+    Parses the test pad library through LEFStringReader, the
+    adapter for readers written against the std::string callbacks.
+    Run from the tests directory, like run_tests.py.
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "logging.h"
+#include "lefstringreader.h"
+
+namespace
+{
+
+uint32_t gs_failed = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  *** FAIL *** %s\n", what);
+        gs_failed++;
+    }
+}
+
+/** a reader that only overrides some of the std::string callbacks */
+class MacroLister : public LEFStringReader
+{
+public:
+    using LEFStringReader::onMacro;
+    using LEFStringReader::onPin;
+    using LEFStringReader::onForeign;
+
+    void onMacro(const std::string &macroName) override
+    {
+        m_macros.push_back(macroName);
+    }
+
+    void onPin(const std::string &pinName) override
+    {
+        m_pins.push_back(m_macros.back() + "/" + pinName);
+    }
+
+    void onForeign(const std::string &foreignName, double x, double y) override
+    {
+        m_foreign.push_back(foreignName);
+    }
+
+    std::vector<std::string> m_macros;
+    std::vector<std::string> m_pins;
+    std::vector<std::string> m_foreign;
+};
+
+} // namespace
+
+int main()
+{
+    setLogLevel(LOG_ERROR);
+
+    MacroLister reader;
+    if (!reader.parseFile("iocells.lef"))
+    {
+        printf("Cannot read iocells.lef\n");
+        return 1;
+    }
+
+    const std::vector<std::string> macros = {"IOPAD", "PWRPAD", "CORNER", "FILLER01",
+        "FILLER02", "FILLER05", "FILLER10", "FILLER25", "FILLER50"};
+    check(reader.m_macros == macros, "every MACRO reaches onMacro in file order");
+    check((reader.m_pins.size() == 6) && (reader.m_pins.front() == "IOPAD/EN") &&
+        (reader.m_pins.back() == "PWRPAD/PAD"), "pins reach onPin within their macro");
+    check((reader.m_foreign.size() == macros.size()) && (reader.m_foreign.front() == "IOPAD"),
+        "every FOREIGN reaches onForeign");
+    check(reader.errorCount() == 0, "iocells.lef parses without errors");
+
+    printf("\nFailed checks: %u\n", gs_failed);
+    return (gs_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*
+    PADRING -- a padring generator for ASICs.
+
+    Copyright (c) 2019, Niels Moseley <niels@symbioticeda.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+*/
+
+/*
+    Checks LibraryManager with two revisions of the test pad
+    library, which differ in the width of the IOPAD cell.
+    Run from the tests directory, like run_tests.py.
+*/
+
+#include <cstdio>
+
+#include "logging.h"
+#include "librarymanager.h"
+
+namespace
+{
+
+uint32_t gs_failed = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  *** FAIL *** %s\n", what);
+        gs_failed++;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    setLogLevel(LOG_ERROR);
+
+    PRLEFReader store;
+    LibraryManager manager(store);
+    if (!manager.load("rev1", {"iocells.lef"}, 1) || !manager.load("rev2", {"iocells_rev2.lef"}, 1))
+    {
+        printf("Cannot load iocells.lef and iocells_rev2.lef\n");
+        return 1;
+    }
+
+    // only IOPAD differs, the other eight cells are shared
+    check(manager.recordCount() == 10, "one record per distinct cell");
+    check(manager.sharedCellCount("rev1") == 8, "rev1 shares its unchanged cells");
+    check(manager.sharedCellCount("rev2") == 8, "rev2 shares its unchanged cells");
+
+    check(manager.activate("rev1"), "activate rev1");
+    const PRLEFReader::LEFCellInfo_t *iopad1  = store.m_cells.at("IOPAD");
+    const PRLEFReader::LEFCellInfo_t *corner1 = store.m_cells.at("CORNER");
+    check(iopad1->m_sx == 84.0, "rev1 has its own IOPAD");
+
+    check(manager.activate("rev2"), "activate rev2");
+    const PRLEFReader::LEFCellInfo_t *iopad2  = store.m_cells.at("IOPAD");
+    const PRLEFReader::LEFCellInfo_t *corner2 = store.m_cells.at("CORNER");
+    check(iopad2->m_sx == 80.0, "rev2 has its own IOPAD");
+    check(iopad1 != iopad2, "changed cells are not shared");
+    check(corner1 == corner2, "unchanged cells are shared");
+    check(store.m_cells.size() == 9, "the active library has all its cells");
+
+    // copy on write: a change to a shared cell of rev2 leaves rev1 alone
+    PRLEFReader::LEFCellInfo_t *edited = manager.editCell("CORNER");
+    check((edited != nullptr) && (edited != corner1), "editCell copies a shared record");
+    if (edited != nullptr)
+    {
+        edited->m_sy = 160.0;
+    }
+    check(manager.editCell("CORNER") == edited, "editCell does not copy an unshared record");
+    check(store.m_cells.at("CORNER")->m_sy == 160.0, "rev2 sees the change");
+    check(manager.recordCount() == 11, "the copy is a new record");
+    check(manager.sharedCellCount("rev2") == 7, "the copy is not shared");
+
+    check(manager.activate("rev1"), "activate rev1 again");
+    check(store.m_cells.at("CORNER") == corner1, "rev1 keeps the original record");
+    check(corner1->m_sy == 150.0, "the original record is unchanged");
+    check(store.m_cells.at("IOPAD") == iopad1, "rev1 gets its IOPAD back");
+
+    check(!manager.activate("rev3"), "an unknown library cannot be activated");
+    check(manager.active() == "rev1", "a failed activation keeps the active library");
+
+    printf("\nFailed checks: %u\n", gs_failed);
+    return (gs_failed == 0) ? 0 : 1;
+}
@@ -1,29 +1,205 @@
 #!/usr/bin/python3
 
+#
+# usage: run_tests.py [padring executable]
+#
+
+import filecmp
+import gzip
 import os
 import subprocess
+import sys
+
+PADRING = sys.argv[1] if len(sys.argv) > 1 else "../build/padring"
 
-# define all tests, the LEF library used and expected return value (1 = fail)
+# define all tests, the LEF library used, expected return value (1 = fail)
+# and optionally the DEF file the test must produce
 tests = [["noarea.config", "iocells.lef", 1],
          ["syntax.config", "iocells.lef", 1],
          ["threecorners.config", "iocells.lef", 0],
          ["fillerexit.config", "iocells_nofiller1.lef", 1],
          ["nonsquarecorners.config", "nonsquarecorners.lef", 0],
-         ["dummy.config", "foreign.lef", 0]
+         ["dummy.config", "foreign.lef", 0],
+         ["busrange.config", "iocells.lef", 0, "busrange.def"],
+         ["busrange_overflow.config", "iocells.lef", 1],
+         ["include.config", "iocells.lef", 0],
+         ["include_cycle_a.cfg", "iocells.lef", 1],
+         ["include_bad.config", "iocells.lef", 1]
 ]
 
 
 FNULL = open(os.devnull, 'w')
 
 failed = 0
+skipped = 0
+
+def report(name, ok, note=""):
+    global failed
+    spaces = 30 - len(name)
+    if ok:
+        print(name + (' '*spaces) + "OK!")
+    else:
+        failed = failed + 1
+        print(name + (' '*spaces) + "*** FAIL ***" + note)
+
 for test in tests:
-    retval = subprocess.call(["../build/padring", "--svg", "padring.svg", "--def", "padring.def", "--lef", test[1], "-o","padring.gds", test[0]], stdout=FNULL)
-    if (retval == test[2]):
+    if not (os.path.exists(test[0]) and os.path.exists(test[1])):
+        skipped = skipped + 1
         spaces = 30 - len(test[0])
-        print(test[0] + (' '*spaces) + "OK!")
+        print(test[0] + (' '*spaces) + "SKIPPED (missing input files)")
+        continue
+
+    # padring exits with a nonzero value on any failure
+    if os.path.exists("padring.def"):
+        os.remove("padring.def")
+    retval = subprocess.call([PADRING, "--svg", "padring.svg", "--def", "padring.def", "--lef", test[1], "-o","padring.gds", test[0]], stdout=FNULL, stderr=FNULL)
+    ok = (retval != 0) == (test[2] == 1)
+    if ok and len(test) > 3:
+        if not filecmp.cmp("padring.def", test[3], shallow=False):
+            report(test[0], False, " (padring.def differs from " + test[3] + ")")
+            continue
+    report(test[0], ok)
+
+# a library selected with --use-library gives the same padring as its LEF file
+def readDEF(args):
+    if os.path.exists("padring.def"):
+        os.remove("padring.def")
+    retval = subprocess.call([PADRING, "--def", "padring.def"] + args + ["busrange.config"], stdout=FNULL, stderr=FNULL)
+    if retval != 0 or not os.path.exists("padring.def"):
+        return None
+    with open("padring.def") as f:
+        return f.read()
+
+libraries = ["--library", "rev1=iocells.lef", "--library", "rev2=iocells_rev2.lef"]
+expected = readDEF(["--lef", "iocells_rev2.lef"])
+actual = readDEF(libraries + ["--use-library", "rev2"])
+report("--use-library", expected is not None and actual == expected)
+retval = subprocess.call([PADRING] + libraries + ["--use-library", "rev3", "busrange.config"], stdout=FNULL, stderr=FNULL)
+report("--use-library unknown", retval != 0)
+
+# a compiled configuration decompiles to text that compiles to the same
+# file, and gives the same padring as the configuration it came from
+def compileConfig(option, infile, outfile):
+    return subprocess.call([PADRING, option, infile, outfile], stdout=FNULL, stderr=FNULL) == 0
+
+ok = compileConfig("--compile-config", "busrange.config", "padring.padcfg") and \
+     compileConfig("--decompile-config", "padring.padcfg", "padring.config") and \
+     compileConfig("--compile-config", "padring.config", "padring2.padcfg") and \
+     filecmp.cmp("padring.padcfg", "padring2.padcfg", shallow=False)
+if ok:
+    retval = subprocess.call([PADRING, "--def", "padring.def", "--lef", "iocells.lef", "padring.padcfg"], stdout=FNULL, stderr=FNULL)
+    ok = (retval == 0) and filecmp.cmp("padring.def", "busrange.def", shallow=False)
+report("--compile-config", ok)
+
+# a damaged compiled configuration is rejected
+with open("padring.padcfg", "r+b") as f:
+    f.seek(-1, os.SEEK_END)
+    last = f.read(1)
+    f.seek(-1, os.SEEK_END)
+    f.write(bytes([last[0] ^ 1]))
+retval = subprocess.call([PADRING, "--lef", "iocells.lef", "padring.padcfg"], stdout=FNULL, stderr=FNULL)
+report("damaged .padcfg", retval != 0)
+for name in ["padring.padcfg", "padring2.padcfg", "padring.config"]:
+    if os.path.exists(name):
+        os.remove(name)
+
+# --lef-diff exits with 1 and lists the changed cells when the files differ
+result = subprocess.run([PADRING, "--lef-diff", "iocells.lef", "iocells_rev2.lef"],
+    stdout=subprocess.PIPE, stderr=FNULL, universal_newlines=True)
+report("--lef-diff", result.returncode == 1 and
+    any(line.startswith("~ IOPAD: size ") for line in result.stdout.splitlines()))
+retval = subprocess.call([PADRING, "--lef-diff", "iocells.lef", "iocells.lef"], stdout=FNULL, stderr=FNULL)
+report("--lef-diff unchanged", retval == 0)
+
+# the sidecar index is written once and reused while the LEF file is
+# unchanged; a touched file is only reindexed when its contents differ
+def indexRun():
+    if os.path.exists("padring.def"):
+        os.remove("padring.def")
+    result = subprocess.run([PADRING, "--index", "--def", "padring.def", "--lef", "padring_index.lef", "busrange.config"],
+        stdout=subprocess.PIPE, stderr=FNULL, universal_newlines=True)
+    ok = (result.returncode == 0) and filecmp.cmp("padring.def", "busrange.def", shallow=False)
+    return ok, "Wrote LEF index" in result.stdout
+
+def touch(seconds):
+    st = os.stat("padring_index.lef")
+    os.utime("padring_index.lef", (st.st_atime, st.st_mtime + seconds))
+
+with open("iocells.lef") as f:
+    lef = f.read()
+with open("padring_index.lef", "w") as f:
+    f.write(lef)
+runs = [indexRun(), indexRun()]
+touch(10)
+runs.append(indexRun())
+# same size, different contents
+with open("padring_index.lef", "w") as f:
+    f.write(lef.replace("fake I/O", "mock I/O"))
+touch(20)
+runs.append(indexRun())
+report("--index", all(ok for ok, _ in runs) and [wrote for _, wrote in runs] == [True, False, False, True])
+for name in ["padring_index.lef", "padring_index.lef.pidx"]:
+    if os.path.exists(name):
+        os.remove(name)
+
+# loading LEF files in parallel gives the same cells, geometry and
+# messages as loading them one after the other, also when a file
+# without UNITS follows a compressed file that has them
+def units(text, keep):
+    begin = text.index("UNITS")
+    end = text.index("END UNITS") + len("END UNITS")
+    return text if keep else text[:begin] + text[end:]
+
+with open("iocells_rev2.lef") as f:
+    rev2 = f.read()
+with gzip.open("padring_jobs1.lef.gz", "wt") as f:
+    f.write(units(lef, True))
+with open("padring_jobs2.lef", "w") as f:
+    f.write(units(rev2, False))
+with gzip.open("padring_jobs3.lef.gz", "wt") as f:
+    f.write(units(lef, False))
+with open("padring_jobs4.lef", "w") as f:
+    f.write(units(rev2, False))
+lefs = []
+for name in ["padring_jobs1.lef.gz", "padring_jobs2.lef", "padring_jobs3.lef.gz", "padring_jobs4.lef"]:
+    lefs += ["--lef", name]
+
+def jobsRun(jobs):
+    for name in ["padring.def", "padring.padlib"]:
+        if os.path.exists(name):
+            os.remove(name)
+    result = subprocess.run([PADRING, "-j", str(jobs), "--cache", "padring.padlib", "--def", "padring.def"] + lefs + ["busrange.config"],
+        stdout=subprocess.PIPE, stderr=FNULL, universal_newlines=True)
+    if result.returncode != 0:
+        return None
+    with open("padring.def") as f:
+        defText = f.read()
+    with open("padring.padlib", "rb") as f:
+        cells = f.read()
+    return defText, cells, [line for line in result.stdout.splitlines() if "replaced" in line]
+
+serial = jobsRun(1)
+parallel = jobsRun(4)
+report("-j 1 / -j 4", serial is not None and len(serial[2]) > 0 and serial == parallel)
+for name in ["padring_jobs1.lef.gz", "padring_jobs2.lef", "padring_jobs3.lef.gz", "padring_jobs4.lef", "padring.padlib"]:
+    if os.path.exists(name):
+        os.remove(name)
+
+# unit tests, built next to padring
+for name in ["padring_librarytest", "padring_lefstringtest"]:
+    program = os.path.join(os.path.dirname(PADRING), name)
+    if os.path.exists(program):
+        retval = subprocess.call([program], stdout=FNULL)
+        report(name, retval == 0, " (run " + program + " for details)")
     else:
-        failed = failed + 1
-        print(test[0] + (' '*spaces) + "*** FAIL ***")
+        skipped = skipped + 1
+        print(name + (' '*(30 - len(name))) + "SKIPPED (not built)")
 
-print("\nFailed tests: " + str(failed))
+# no damaged LEF file may hang the reader
+retval = subprocess.call([sys.executable, "fuzz_lef.py", "--quick", "--padring", PADRING], stdout=FNULL)
+report("fuzz_lef.py --quick", retval == 0, " (run fuzz_lef.py for details)")
 
+print("\nFailed tests: " + str(failed))
+if skipped > 0:
+    print("Skipped tests: " + str(skipped))
+sys.exit(1 if failed > 0 else 0)